@@ -0,0 +1,382 @@
+/*
+ * main.cpp (dispatcher_bench)
+ *
+ * Хостовый стресс-бенчмарк EventDispatcher: несколько потоков-производителей публикуют
+ * заданную смесь событий в threaded-режиме диспетчера (std::thread вместо задач FreeRTOS).
+ * Итог - одна строка JSON (последняя строка stdout и, если задан --out, файл):
+ * пропускная способность, p50/p99/p99.9/max задержки доставки по полосам, потери.
+ *
+ * Задержка доставки = EventDispatcher::nowUs() в обработчике - Event::postTimeUs
+ * (то же время, что пишут гистограммы и самописец), разрешение 1 мкс.
+ *
+ * Сборка и запуск:
+ *   pio run -e native_bench
+ *   .pio/build/native_bench/program --producers 4 --mix sensor_flood,note_burst --loops 2
+ *
+ * Соответствует: docs/modules/core_event_dispatcher.md
+ */
+#include "core/EventDispatcher.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// --- Параметры запуска ---
+
+enum class Mix {
+    SENSOR_FLOOD, // SENSOR_VALUE_CHANGED без пауз (8 сенсоров)
+    NOTE_BURST,   // Пачка маска + 8 нот, затем пауза 2 мс (быстрая игра)
+    VIBRATO,      // VIBRATO_DETECTED каждые ~100 мкс
+    MIXED         // 16 значений сенсоров + маска + нота + вибрато за итерацию
+};
+
+struct BenchConfig {
+    int producers = 3;
+    int durationMs = 1000;
+    std::vector<Mix> mixes{Mix::MIXED}; // Производитель i играет mixes[i % size]
+    bool dualLoop = false;
+    QueueConfig realtime{(int)EventDispatcher::REALTIME_QUEUE_CAPACITY, OverflowPolicy::BLOCK_TIMEOUT};
+    QueueConfig bulk{(int)EventDispatcher::BULK_QUEUE_CAPACITY, OverflowPolicy::BLOCK_TIMEOUT};
+    int blockTimeoutMs = 10;
+    size_t maxSamples = 2000000; // На полосу; дальше события считаются, но не сэмплируются
+    const char* outPath = nullptr;
+};
+
+static const char* mixName(Mix mix) {
+    switch (mix) {
+        case Mix::SENSOR_FLOOD: return "sensor_flood";
+        case Mix::NOTE_BURST:   return "note_burst";
+        case Mix::VIBRATO:      return "vibrato";
+        case Mix::MIXED:        return "mixed";
+    }
+    return "?";
+}
+
+static bool parseMix(const std::string& str, Mix& out) {
+    for (Mix mix : {Mix::SENSOR_FLOOD, Mix::NOTE_BURST, Mix::VIBRATO, Mix::MIXED}) {
+        if (str == mixName(mix)) {
+            out = mix;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Имена политик - как в settings.cfg ([queues])
+static const char* policyName(OverflowPolicy policy) {
+    switch (policy) {
+        case OverflowPolicy::BLOCK_TIMEOUT: return "block";
+        case OverflowPolicy::DROP_NEWEST:   return "drop_newest";
+        case OverflowPolicy::DROP_OLDEST:   return "drop_oldest";
+        case OverflowPolicy::COALESCE:      return "coalesce";
+    }
+    return "?";
+}
+
+static bool parsePolicy(const std::string& str, OverflowPolicy& out) {
+    for (OverflowPolicy policy : {OverflowPolicy::BLOCK_TIMEOUT, OverflowPolicy::DROP_NEWEST,
+                                  OverflowPolicy::DROP_OLDEST, OverflowPolicy::COALESCE}) {
+        if (str == policyName(policy)) {
+            out = policy;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void printUsage(const char* program) {
+    std::fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --producers N         producer threads (default 3)\n"
+        "  --duration-ms N       run time (default 1000)\n"
+        "  --mix a[,b...]        sensor_flood | note_burst | vibrato | mixed (default mixed);\n"
+        "                        producer i plays mix[i %% count]\n"
+        "  --loops 1|2           one loop for both lanes or one loop per lane (default 1)\n"
+        "  --rt-capacity N       REALTIME lane capacity, 1..%u (default %u)\n"
+        "  --bulk-capacity N     BULK lane capacity, 1..%u (default %u)\n"
+        "  --rt-policy P         block | drop_newest | drop_oldest | coalesce (default block)\n"
+        "  --bulk-policy P       same as --rt-policy (default block)\n"
+        "  --block-timeout-ms N  producer wait for the block policy (default 10)\n"
+        "  --max-samples N       latency samples kept per lane (default 2000000)\n"
+        "  --out PATH            also write the JSON result to PATH\n",
+        program,
+        (unsigned)EventDispatcher::MAX_QUEUE_CAPACITY, (unsigned)EventDispatcher::REALTIME_QUEUE_CAPACITY,
+        (unsigned)EventDispatcher::MAX_QUEUE_CAPACITY, (unsigned)EventDispatcher::BULK_QUEUE_CAPACITY);
+}
+
+static bool parseArgs(int argc, char** argv, BenchConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") return false;
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "missing value for %s\n", arg.c_str());
+            return false;
+        }
+        std::string value = argv[++i];
+        int number = std::atoi(value.c_str());
+
+        if (arg == "--producers" && number > 0) config.producers = number;
+        else if (arg == "--duration-ms" && number > 0) config.durationMs = number;
+        else if (arg == "--loops" && (number == 1 || number == 2)) config.dualLoop = (number == 2);
+        else if (arg == "--rt-capacity" && number > 0 && number <= (int)EventDispatcher::MAX_QUEUE_CAPACITY) config.realtime.capacity = number;
+        else if (arg == "--bulk-capacity" && number > 0 && number <= (int)EventDispatcher::MAX_QUEUE_CAPACITY) config.bulk.capacity = number;
+        else if (arg == "--rt-policy" && parsePolicy(value, config.realtime.policy)) {}
+        else if (arg == "--bulk-policy" && parsePolicy(value, config.bulk.policy)) {}
+        else if (arg == "--block-timeout-ms" && number >= 0) config.blockTimeoutMs = number;
+        else if (arg == "--max-samples" && number >= 0) config.maxSamples = (size_t)number;
+        else if (arg == "--out") config.outPath = argv[i];
+        else if (arg == "--mix") {
+            config.mixes.clear();
+            size_t start = 0;
+            while (start <= value.size()) {
+                size_t comma = value.find(',', start);
+                if (comma == std::string::npos) comma = value.size();
+                Mix mix;
+                if (!parseMix(value.substr(start, comma - start), mix)) {
+                    std::fprintf(stderr, "unknown mix in '%s'\n", value.c_str());
+                    return false;
+                }
+                config.mixes.push_back(mix);
+                start = comma + 1;
+            }
+        } else {
+            std::fprintf(stderr, "bad option %s %s\n", arg.c_str(), value.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- Потребитель ---
+
+/**
+ * @brief Подписан на все типы: считает доставки и копит задержки по полосам.
+ * Полосу в каждый момент вычерпывает один поток, поэтому данные полосы без блокировок.
+ */
+class BenchSink : public IEventHandler {
+public:
+    struct LaneSamples {
+        std::vector<uint32_t> latencyUs;
+        uint64_t delivered = 0;
+    };
+
+    BenchSink(EventDispatcher& dispatcher, size_t maxSamples)
+        : m_dispatcher(dispatcher), m_maxSamples(maxSamples) {
+        for (LaneSamples& lane : m_lanes) {
+            lane.latencyUs.reserve(maxSamples);
+        }
+    }
+
+    virtual void handleEvent(const Event& event) override {
+        LaneSamples& lane = m_lanes[static_cast<size_t>(m_dispatcher.getEventLane(event.type))];
+        lane.delivered++;
+        if (lane.latencyUs.size() < m_maxSamples) {
+            lane.latencyUs.push_back(EventDispatcher::nowUs() - event.postTimeUs);
+        }
+    }
+
+    LaneSamples& lane(EventLane lane) {
+        return m_lanes[static_cast<size_t>(lane)];
+    }
+
+private:
+    EventDispatcher& m_dispatcher;
+    size_t m_maxSamples;
+    LaneSamples m_lanes[EVENT_LANE_COUNT];
+};
+
+// --- Производители ---
+
+struct ProducerStats {
+    uint64_t posted[EVENT_LANE_COUNT] = {0, 0};
+    uint64_t rejected[EVENT_LANE_COUNT] = {0, 0}; // postEvent() вернул false
+};
+
+static void post(EventDispatcher& dispatcher, const Event& event, ProducerStats& stats) {
+    size_t lane = static_cast<size_t>(dispatcher.getEventLane(event.type));
+    stats.posted[lane]++;
+    if (!dispatcher.postEvent(event)) {
+        stats.rejected[lane]++;
+    }
+}
+
+static void runProducer(EventDispatcher& dispatcher, Mix mix, const std::atomic<bool>& running,
+                        ProducerStats& stats) {
+    int step = 0;
+    while (running.load(std::memory_order_relaxed)) {
+        switch (mix) {
+            case Mix::SENSOR_FLOOD:
+                post(dispatcher, Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{step & 7, step & 0x3FF}), stats);
+                break;
+            case Mix::NOTE_BURST:
+                post(dispatcher, Event(EventType::SENSOR_MASK_CHANGED, SensorMaskPayload{(HoleMask)(step & 0xFF)}), stats);
+                for (int n = 0; n < 8; ++n) {
+                    post(dispatcher, Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{60 + ((step + n) % 12)}), stats);
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                break;
+            case Mix::VIBRATO:
+                post(dispatcher, Event(EventType::VIBRATO_DETECTED, VibratoPayload{step & 7, 0.25f}), stats);
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                break;
+            case Mix::MIXED:
+                for (int s = 0; s < 16; ++s) {
+                    post(dispatcher, Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{s & 7, (step + s) & 0x3FF}), stats);
+                }
+                post(dispatcher, Event(EventType::SENSOR_MASK_CHANGED, SensorMaskPayload{(HoleMask)(step & 0xFF)}), stats);
+                post(dispatcher, Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{60 + (step % 12)}), stats);
+                post(dispatcher, Event(EventType::VIBRATO_DETECTED, VibratoPayload{step & 7, 0.5f}), stats);
+                std::this_thread::yield();
+                break;
+        }
+        ++step;
+    }
+}
+
+// --- Отчет ---
+
+struct LatencySummary {
+    uint32_t p50 = 0;
+    uint32_t p99 = 0;
+    uint32_t p999 = 0;
+    uint32_t max = 0;
+    double mean = 0.0;
+};
+
+static uint32_t percentile(const std::vector<uint32_t>& sorted, double fraction) {
+    if (sorted.empty()) return 0;
+    size_t index = (size_t)(fraction * (double)(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static LatencySummary summarize(std::vector<uint32_t>& samples) {
+    LatencySummary summary;
+    if (samples.empty()) return summary;
+    std::sort(samples.begin(), samples.end());
+    uint64_t sum = 0;
+    for (uint32_t us : samples) sum += us;
+    summary.p50 = percentile(samples, 0.50);
+    summary.p99 = percentile(samples, 0.99);
+    summary.p999 = percentile(samples, 0.999);
+    summary.max = samples.back();
+    summary.mean = (double)sum / (double)samples.size();
+    return summary;
+}
+
+static void appendf(std::string& out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+static void appendf(std::string& out, const char* format, ...) {
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    out += buffer;
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    if (!parseArgs(argc, argv, config)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    static EventDispatcher dispatcher; // Статически: снимки подписчиков и очереди - несколько КБ
+    dispatcher.init(DispatchLoopConfig{config.dualLoop, {NO_CORE_AFFINITY, NO_CORE_AFFINITY}});
+    dispatcher.configureLane(EventLane::REALTIME, config.realtime);
+    dispatcher.configureLane(EventLane::BULK, config.bulk);
+    dispatcher.setBlockTimeoutMs((uint32_t)config.blockTimeoutMs);
+
+    BenchSink sink(dispatcher, config.maxSamples);
+    for (size_t i = 0; i < EVENT_TYPE_COUNT; ++i) {
+        dispatcher.subscribe(static_cast<EventType>(i), &sink);
+    }
+    if (!dispatcher.startLoopThread()) {
+        std::fprintf(stderr, "failed to start dispatch loops\n");
+        return 1;
+    }
+
+    // 1. Нагрузка
+    std::atomic<bool> running{true};
+    std::vector<ProducerStats> stats(config.producers);
+    std::vector<std::thread> producers;
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < config.producers; ++i) {
+        Mix mix = config.mixes[i % config.mixes.size()];
+        producers.emplace_back(runProducer, std::ref(dispatcher), mix, std::cref(running), std::ref(stats[i]));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(config.durationMs));
+    running.store(false);
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+
+    // 2. Досчитываем хвост очередей: время включает доставку всего принятого
+    dispatcher.waitIdle();
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    dispatcher.stopLoopThread();
+
+    // 3. JSON (одна строка)
+    uint64_t posted = 0;
+    uint64_t delivered = 0;
+    std::string json;
+    appendf(json, "{\"bench\":\"event_dispatcher\",\"config\":{\"producers\":%d,\"duration_ms\":%d,\"mix\":[",
+            config.producers, config.durationMs);
+    for (size_t i = 0; i < config.mixes.size(); ++i) {
+        appendf(json, "%s\"%s\"", i ? "," : "", mixName(config.mixes[i]));
+    }
+    appendf(json, "],\"loops\":%u,\"block_timeout_ms\":%d,"
+            "\"realtime\":{\"capacity\":%d,\"policy\":\"%s\"},\"bulk\":{\"capacity\":%d,\"policy\":\"%s\"}},",
+            (unsigned)dispatcher.getLoopCount(), config.blockTimeoutMs,
+            config.realtime.capacity, policyName(config.realtime.policy),
+            config.bulk.capacity, policyName(config.bulk.policy));
+
+    json += "\"lanes\":{";
+    for (size_t l = 0; l < EVENT_LANE_COUNT; ++l) {
+        EventLane lane = static_cast<EventLane>(l);
+        uint64_t lanePosted = 0;
+        uint64_t laneRejected = 0;
+        for (const ProducerStats& s : stats) {
+            lanePosted += s.posted[l];
+            laneRejected += s.rejected[l];
+        }
+        BenchSink::LaneSamples& samples = sink.lane(lane);
+        size_t sampled = samples.latencyUs.size();
+        LatencySummary latency = summarize(samples.latencyUs);
+        posted += lanePosted;
+        delivered += samples.delivered;
+
+        appendf(json, "%s\"%s\":{\"posted\":%llu,\"delivered\":%llu,\"rejected\":%llu,\"dropped\":%lu,"
+                "\"evicted\":%lu,\"high_water\":%lu,\"samples\":%zu,"
+                "\"latency_us\":{\"p50\":%lu,\"p99\":%lu,\"p999\":%lu,\"max\":%lu,\"mean\":%.2f}}",
+                l ? "," : "", lane == EventLane::REALTIME ? "realtime" : "bulk",
+                (unsigned long long)lanePosted, (unsigned long long)samples.delivered,
+                (unsigned long long)laneRejected,
+                (unsigned long)dispatcher.getDroppedCount(lane), (unsigned long)dispatcher.getEvictedCount(lane),
+                (unsigned long)dispatcher.getHighWaterMark(lane), sampled,
+                (unsigned long)latency.p50, (unsigned long)latency.p99, (unsigned long)latency.p999,
+                (unsigned long)latency.max, latency.mean);
+    }
+    appendf(json, "},\"elapsed_ms\":%.1f,\"posted\":%llu,\"delivered\":%llu,\"throughput_eps\":%.0f,"
+            "\"coalesced\":%lu,\"preemptions\":%lu}",
+            elapsedMs, (unsigned long long)posted, (unsigned long long)delivered,
+            elapsedMs > 0.0 ? (double)delivered * 1000.0 / elapsedMs : 0.0,
+            (unsigned long)dispatcher.getCoalescedCount(), (unsigned long)dispatcher.getPreemptionCount());
+
+    std::printf("%s\n", json.c_str());
+    if (config.outPath != nullptr) {
+        FILE* file = std::fopen(config.outPath, "w");
+        if (file == nullptr) {
+            std::fprintf(stderr, "cannot write %s\n", config.outPath);
+            return 1;
+        }
+        std::fprintf(file, "%s\n", json.c_str());
+        std::fclose(file);
+    }
+    return 0;
+}
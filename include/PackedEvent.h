@@ -0,0 +1,144 @@
+/*
+ * PackedEvent.h
+ *
+ * Компактное 8-байтное представление Event для хранения в очередях:
+ *   тип (u8) | ID (u8) | значение или глубина (u16) | время публикации, мкс (u32).
+ *
+ * Event со всеми полями занимает 52 байта (из-за SensorFramePayload), а почти все
+ * события укладываются в одно машинное слово: упакованная очередь при том же объеме
+ * RAM вмещает вдвое больше событий, а слот очереди не пересекает строку кэша.
+ *
+ * Упаковываемые диапазоны:
+ *   SENSOR_VALUE_CHANGED - id 0..255, value 0..65535 (сырые и отфильтрованные значения АЦП);
+ *   SENSOR_MASK_CHANGED  - mask 0..65535 (HOLE_MASK_BITS = 16 - всегда);
+ *   HALF_HOLE_DETECTED   - id 0..255;
+ *   NOTE_PITCH_SELECTED  - pitch 0..65535 (MIDI 0..127);
+ *   VIBRATO_DETECTED     - id 0..255, depth 0.0..65535/32768 (меньше 2.0);
+ *   события без данных   - всегда.
+ * Все поля, кроме глубины вибрато, передаются точно. Глубина КВАНТУЕТСЯ: округляется до
+ * ближайшего кратного 1/32768 (Q1.15, ошибка до 1/65536 - точнее 14-битного MIDI Pitch Bend);
+ * двоичные дроби (0, 1.0, 0.25 и т.п.) передаются точно.
+ * Остальное (SENSOR_FRAME, значения вне диапазонов) pack() не упаковывает - такие события
+ * очередь хранит целиком в отдельном пуле (см. EventQueue).
+ *
+ * Соответствует: docs/modules/core_event_dispatcher.md
+ */
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include "events.h"
+
+struct PackedEvent {
+    uint8_t type;    // EventType (старший бит - флаг WIDE)
+    uint8_t id;      // ID сенсора/отверстия или индекс ячейки пула (WIDE)
+    uint16_t value;  // Значение, маска, нота или глубина вибрато (Q1.15)
+    uint32_t postTimeUs;
+
+    // Данные события лежат целиком в пуле очереди, id - номер ячейки
+    static constexpr uint8_t WIDE_FLAG = 0x80;
+    static constexpr float DEPTH_SCALE = 32768.0f;
+
+    /**
+     * @brief Упаковывает событие (Event::seq не переносится - его хранит очередь).
+     * @return false, если событие вне упаковываемых диапазонов (см. выше). Глубина вибрато
+     *         в пределах диапазона упаковывается с округлением до Q1.15.
+     */
+    static bool pack(const Event& event, PackedEvent& out) {
+        out.type = (uint8_t)event.type;
+        out.id = 0;
+        out.value = 0;
+        out.postTimeUs = event.postTimeUs;
+
+        switch (event.type) {
+            case EventType::SENSOR_VALUE_CHANGED:
+                if (!fitsId(event.payload.sensorValue.id) || !fitsValue(event.payload.sensorValue.value)) return false;
+                out.id = (uint8_t)event.payload.sensorValue.id;
+                out.value = (uint16_t)event.payload.sensorValue.value;
+                return true;
+            case EventType::SENSOR_MASK_CHANGED:
+#if HOLE_MASK_BITS > 16
+                if (event.payload.sensorMask.mask > 0xFFFF) return false;
+#endif
+                out.value = (uint16_t)event.payload.sensorMask.mask;
+                return true;
+            case EventType::HALF_HOLE_DETECTED:
+                if (!fitsId(event.payload.halfHole.id)) return false;
+                out.id = (uint8_t)event.payload.halfHole.id;
+                return true;
+            case EventType::VIBRATO_DETECTED: {
+                float scaled = event.payload.vibrato.depth * DEPTH_SCALE;
+                // !(a >= b) отсекает и NaN
+                if (!fitsId(event.payload.vibrato.id) || !(scaled >= 0.0f) || scaled > 65535.0f) return false;
+                out.id = (uint8_t)event.payload.vibrato.id;
+                out.value = (uint16_t)std::lround(scaled);
+                return true;
+            }
+            case EventType::NOTE_PITCH_SELECTED:
+                if (!fitsValue(event.payload.notePitch.pitch)) return false;
+                out.value = (uint16_t)event.payload.notePitch.pitch;
+                return true;
+            case EventType::BLE_CONNECTED:
+            case EventType::BLE_DISCONNECTED:
+            case EventType::MUTE_ENABLED:
+            case EventType::MUTE_DISABLED:
+            case EventType::SYSTEM_IDLE_TIMEOUT:
+                return true;
+            default:
+                // SENSOR_FRAME и неизвестные типы
+                return false;
+        }
+    }
+
+    /**
+     * @brief Ссылка на событие, которое хранится целиком в ячейке slot пула очереди.
+     */
+    static PackedEvent wide(const Event& event, uint8_t slot) {
+        PackedEvent out;
+        out.type = (uint8_t)((uint8_t)event.type | WIDE_FLAG);
+        out.id = slot;
+        out.value = 0;
+        out.postTimeUs = event.postTimeUs;
+        return out;
+    }
+
+    bool isWide() const {
+        return (type & WIDE_FLAG) != 0;
+    }
+
+    /**
+     * @brief Восстанавливает событие (только для !isWide()). Event::seq = 0.
+     */
+    Event unpack() const {
+        const EventType eventType = static_cast<EventType>(type);
+        Event event(eventType);
+        switch (eventType) {
+            case EventType::SENSOR_VALUE_CHANGED:
+                event = Event(eventType, SensorValuePayload{id, value});
+                break;
+            case EventType::SENSOR_MASK_CHANGED:
+                event = Event(eventType, SensorMaskPayload{(HoleMask)value});
+                break;
+            case EventType::HALF_HOLE_DETECTED:
+                event = Event(eventType, HalfHolePayload{id});
+                break;
+            case EventType::VIBRATO_DETECTED:
+                event = Event(eventType, VibratoPayload{id, (float)value / DEPTH_SCALE});
+                break;
+            case EventType::NOTE_PITCH_SELECTED:
+                event = Event(eventType, NotePitchPayload{value});
+                break;
+            default:
+                break;
+        }
+        event.postTimeUs = postTimeUs;
+        return event;
+    }
+
+private:
+    static bool fitsId(int id) { return id >= 0 && id <= 0xFF; }
+    static bool fitsValue(int value) { return value >= 0 && value <= 0xFFFF; }
+};
+
+static_assert(sizeof(PackedEvent) == 8, "PackedEvent must stay one 8-byte queue word");
+static_assert(EVENT_TYPE_COUNT < PackedEvent::WIDE_FLAG, "EventType must fit in 7 bits");
@@ -0,0 +1,23 @@
+/*
+ * QueuePolicy.h
+ *
+ * Политики переполнения очередей событий и их настройки из settings.cfg.
+ *
+ * Соответствует: docs/CONFIG_SCHEMA.md
+ */
+#pragma once
+
+#include <cstdint>
+
+enum class OverflowPolicy {
+    BLOCK_TIMEOUT = 0, // Производитель ждет до block_timeout_ms, затем событие теряется
+    DROP_NEWEST = 1,   // Новое событие сразу теряется
+    DROP_OLDEST = 2,   // Самое старое событие вытесняется новым
+    COALESCE = 3       // SENSOR_VALUE_CHANGED: одна ячейка на сенсор (новое значение заменяет
+                       // недоставленное); остальные события при переполнении теряются
+};
+
+struct QueueConfig {
+    int capacity;
+    OverflowPolicy policy;
+};
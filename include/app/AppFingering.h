@@ -9,7 +9,10 @@
 #include "interfaces/IHalStorage.h"
 #include "core/EventDispatcher.h"
 #include "interfaces/IEventHandler.h"
+#include "app/AppPipeline.h"
 #include <map>
+#include <unordered_map>
+#include <vector>
 #include <string>
 #include <cstdint>
 
@@ -30,6 +33,14 @@ public:
      */
     bool init(IHalStorage* storage);
 
+    /**
+     * @brief Режим fused_pipeline: выбранная нота публикуется в типизированную шину
+     * (прямой вызов AppMidi, затем NOTE_PITCH_SELECTED наблюдателям), а маска и
+     * полузакрытие приходят из AppLogic через ту же шину. nullptr - обычный режим
+     * через события. Вызывать до subscribe().
+     */
+    void setFusedPipeline(AppPipelineBus* pipeline);
+
     /**
      * @brief Подписывает модуль на события от EventDispatcher.
      */
@@ -40,6 +51,24 @@ public:
      */
     virtual void handleEvent(const Event& event) override;
 
+    /**
+     * @brief Есть ли для маски правило в fingering.cfg (без учета полузакрытия).
+     */
+    bool isKnownMask(HoleMask mask) const;
+
+    /**
+     * @brief Все маски с правилами (в произвольном порядке).
+     */
+    std::vector<HoleMask> knownMasks() const;
+
+    // --- Прямые вызовы (fused_pipeline и handleEvent) ---
+    void onMaskChanged(HoleMask mask);
+    void onHalfHoleDetected(int sensorId);
+
+    // --- Маршруты типизированной шины (AppPipelineBus) ---
+    void onEvent(EventTag<EventType::SENSOR_MASK_CHANGED>, const SensorMaskPayload& p) { onMaskChanged(p.mask); }
+    void onEvent(EventTag<EventType::HALF_HOLE_DETECTED>, const HalfHolePayload& p) { onHalfHoleDetected(p.id); }
+
 private:
     /**
      * @brief Внутренний метод парсинга fingering.cfg.
@@ -49,7 +78,7 @@ private:
     /**
      * @brief Ищет ноту в m_fingeringMap по маске и (опционально) ID сенсора полузакрытия.
      */
-    int findNote(uint8_t mask, int halfHoleSensorId = -1);
+    int findNote(HoleMask mask, int halfHoleSensorId = -1);
 
     /**
      * @brief Публикует событие NOTE_PITCH_SELECTED, если нота изменилась.
@@ -57,10 +86,12 @@ private:
     void publishNote(int note);
 
     EventDispatcher* m_dispatcher;
-    std::map<uint8_t, FingeringRule> m_fingeringMap;
+    AppPipelineBus* m_pipeline; // Не nullptr в режиме fused_pipeline
+    // Поиск по маске за O(1): ключ - маска шириной HOLE_MASK_BITS
+    std::unordered_map<HoleMask, FingeringRule> m_fingeringMap;
 
     // Переменные состояния
-    uint8_t m_currentMask; // Последняя активная маска
+    HoleMask m_currentMask; // Последняя активная маска
     int m_lastPublishedNote; // Последняя отправленная нота (для защиты от "дребезга")
     int m_currentHalfHoleId; // <-- ДОБАВЛЕНО: ID текущего полузакрытого сенсора (-1 если нет)
 };
\ No newline at end of file
@@ -8,28 +8,123 @@
 
 #include "core/ConfigManager.h"
 #include "core/EventDispatcher.h"
+#include "core/EventQueue.h"
 #include "interfaces/IEventHandler.h"
+#include "app/AppPipeline.h"
+#include "app/VibratoWindow.h"
+#include "app/SlidingDftBank.h"
+#include "app/SensorFrameKernel.h"
 #include <vector>
+#include <unordered_set>
 #include <cstdint>
 
-// Forward-declare FreeRTOS типы
-typedef void* QueueHandle_t;
+class AppFingering;
 
-// (Определение SensorState и SensorContext)
 enum class SensorState { OPEN, HALF_HOLE, CLOSED };
 
-struct SensorContext {
-    SensorState state;
-    // (Буфер истории значений для анализа вибрато)
-    std::vector<int> valueHistory; 
-    // (Другие переменные для DSP...)
+// Максимум истории на сенсор (1 с при sample_rate_hz <= 128; выше - окно короче секунды)
+constexpr size_t MAX_SENSOR_HISTORY = 128;
+// Значения насыщаются в 0..65535 (как в SensorFramePayload)
+using SensorHistory = VibratoWindow<MAX_SENSOR_HISTORY>;
 
-    SensorContext() : state(SensorState::OPEN) {}
+// Логические ID игровых сенсоров и Mute: 0..15
+constexpr int MAX_SENSOR_IDS = 16;
+// Полоса = позиция в hole_sensor_ids = бит маски отверстий
+constexpr size_t MAX_HOLE_SENSORS = SensorFrameKernel::MAX_LANES;
+static_assert(MAX_HOLE_SENSORS <= HOLE_MASK_BITS, "every hole lane needs a mask bit");
+
+/**
+ * @brief Состояние игровых сенсоров - структура массивов, индекс - полоса.
+ * Значения и пороги, которые ядро кадра сравнивает разом для всех полос, лежат подряд;
+ * история и бины вибрато - отдельными блоками после них.
+ */
+struct HoleSensorLanes {
+    // --- Читает SensorFrameKernel ---
+    alignas(32) int32_t values[MAX_HOLE_SENSORS];          // Последнее значение (0..65535)
+    alignas(32) int32_t closedLevel[MAX_HOLE_SENSORS];     // Порог CLOSED с гистерезисом от текущего состояния
+    alignas(32) int32_t halfLevel[MAX_HOLE_SENSORS];       // Порог HALF_HOLE с гистерезисом
+    alignas(32) int32_t closedThreshold[MAX_HOLE_SENSORS]; // Голые пороги полосы
+    alignas(32) int32_t halfThreshold[MAX_HOLE_SENSORS];
+
+    // --- Автомат состояний ---
+    SensorState state[MAX_HOLE_SENSORS];
+    // Кандидат в новое состояние и сколько значений подряд он держится (state_dwell_samples)
+    SensorState pendingState[MAX_HOLE_SENSORS];
+    uint16_t pendingCount[MAX_HOLE_SENSORS];
+    // Предсказанное закрытие (predict_onset_ms): состояние до предсказания и его возраст в значениях
+    SensorState predictedFrom[MAX_HOLE_SENSORS];
+    uint16_t predictAge[MAX_HOLE_SENSORS];
+
+    // --- Адаптивные пороги (adaptive_thresholds) ---
+    float baseline[MAX_HOLE_SENSORS];           // Уровень открытого отверстия
+    float closedPeak[MAX_HOLE_SENSORS];         // Уровень закрытого отверстия
+    uint32_t calibrationSum[MAX_HOLE_SENSORS];
+    uint16_t calibrationLeft[MAX_HOLE_SENSORS]; // Значений до конца калибровки (0 - откалиброван)
+
+    // --- DSP ---
+    // Окно значений и его статистика для анализа вибрато, емкость = sample_rate_hz
+    SensorHistory history[MAX_HOLE_SENSORS];
+    // Бины детектора vibrato_detector = goertzel (окно - хвост history)
+    SlidingDftBank::State vibratoBins[MAX_HOLE_SENSORS];
+
+    int id[MAX_HOLE_SENSORS]; // Логический ID сенсора полосы
+    size_t count;             // Полос (позиций hole_sensor_ids, не больше MAX_HOLE_SENSORS)
+
+    // --- Битовые наборы (бит = полоса) ---
+    uint32_t live;      // Полосы с валидным ID (повтор ID и Mute - не игровые)
+    uint32_t closed;    // state == CLOSED
+    uint32_t held;      // state != OPEN - биты маски отверстий
+    uint32_t rawClosed; // По голым порогам - для счетчика подавленных переходов
+    uint32_t rawHeld;
+    uint32_t pending;   // pendingCount > 0
+    uint32_t predicted; // Предсказанное закрытие ждет подтверждения
+};
+
+
+/**
+ * @brief Статистика выдержки маски (mask_settle_ms).
+ */
+struct MaskSettleStats {
+    uint32_t suppressedMasks; // Промежуточные маски, замененные до публикации (несыгранные ноты-"глитчи")
+    uint32_t immediateMasks;  // Опубликованы сразу (выдержка выключена или известная аппликатура в один бит)
+    uint32_t heldMasks;       // Опубликованы после выдержки
+    uint32_t totalDelayMs;    // Суммарная добавленная задержка опубликованных после выдержки масок
+    uint32_t maxDelayMs;
+};
+
+/**
+ * @brief Метрики предсказания закрытия отверстия (predict_onset_ms).
+ */
+struct OnsetPredictionStats {
+    uint32_t horizonMs;   // Горизонт (predict_onset_ms, округлен до периода опроса); 0 - выключено
+    uint32_t predictions; // Закрытий объявлено раньше порога
+    uint32_t confirmed;   // Порог пересечен в пределах горизонта
+    uint32_t corrected;   // Ложные: порог не пересечен, маска исправлена
+    uint32_t totalLeadMs; // Суммарный выигрыш по подтвержденным
+
+    float falsePositiveRate() const {
+        uint32_t decided = confirmed + corrected;
+        return decided ? (float)corrected / (float)decided : 0.0f;
+    }
 };
 
+/**
+ * @brief Адаптивные пороги сенсора (adaptive_thresholds).
+ */
+struct SensorCalibration {
+    bool calibrated;     // Калибровка при старте завершена
+    float baseline;      // Уровень открытого отверстия
+    float range;         // Размах "открыт - закрыт"
+    int closedThreshold; // baseline + hole_closed_ratio * range
+    int halfThreshold;   // baseline + half_hole_ratio * range
+};
 
 class AppLogic : public IEventHandler {
 public:
+    // Емкость хранилища внутренней очереди (рабочая емкость - app_logic_queue_capacity)
+    static constexpr size_t MAX_SENSOR_QUEUE_CAPACITY = 128;
+    using SensorQueue = EventQueue<MAX_SENSOR_QUEUE_CAPACITY>;
+
     AppLogic();
     
     /**
@@ -37,21 +132,75 @@ public:
      */
     bool init(ConfigManager* configManager, EventDispatcher* dispatcher);
 
+    /**
+     * @brief Режим fused_pipeline: маска/полузакрытие/mute/вибрато публикуются в
+     * типизированную шину (прямые вызовы AppFingering/AppMidi из задачи appLogicTask).
+     * Шина затем публикует события в EventDispatcher для наблюдателей.
+     * nullptr - обычный режим через EventDispatcher.
+     */
+    void setFusedPipeline(AppPipelineBus* pipeline);
+
+    /**
+     * @brief Известные аппликатуры (маски из fingering.cfg) для выдержки маски: смена одного
+     * бита, дающая известную маску, публикуется без выдержки. Маски копируются (вызывать после
+     * AppFingering::init). nullptr - известных масок нет, выдерживается любая смена.
+     */
+    void setKnownFingerings(const AppFingering* fingering);
+
     /**
      * @brief Запускает задачу FreeRTOS `appLogicTask`.
+     * @param core Ядро задачи (при dual_core_dispatch - ядро цикла BULK) или NO_CORE_AFFINITY.
      */
-    void startTask();
+    void startTask(int core = NO_CORE_AFFINITY);
 
     /**
-     * @brief Подписывает модуль на SENSOR_VALUE_CHANGED.
+     * @brief Подписывает модуль на SENSOR_VALUE_CHANGED (только игровые сенсоры и Mute,
+     * фильтр диспетчера) и SENSOR_FRAME. Вызывать после init().
      */
     void subscribe(EventDispatcher* dispatcher);
 
+    /**
+     * @brief Фильтр подписки: ID из hole_sensor_ids и mute_sensor_id.
+     */
+    EventFilter sensorFilter() const;
+
     /**
      * @brief БЫСТРЫЙ обработчик. Только кладет событие во внутреннюю очередь.
      */
     virtual void handleEvent(const Event& event) override;
 
+    /**
+     * @brief Внутренняя очередь (для статистики: потери, high-water mark, пропуски).
+     */
+    const SensorQueue& getSensorQueue() const;
+
+    /**
+     * @brief Переходы OPEN/HALF_HOLE/CLOSED и Mute, которые подавили гистерезис и выдержка
+     * (переходы по голым порогам минус состоявшиеся, с момента init).
+     */
+    uint32_t getSuppressedTransitionCount() const;
+
+    /**
+     * @brief Состоявшиеся переходы (с момента init).
+     */
+    uint32_t getTransitionCount() const;
+
+    /**
+     * @brief Сколько промежуточных масок подавила выдержка и какую задержку она добавила.
+     */
+    const MaskSettleStats& getMaskSettleStats() const;
+
+    /**
+     * @brief Горизонт, выигрыш и доля ложных предсказаний закрытия.
+     */
+    const OnsetPredictionStats& getOnsetPredictionStats() const;
+
+    /**
+     * @brief База, размах и текущие пороги игрового сенсора.
+     * @return false, если ID не игровой.
+     */
+    bool getSensorCalibration(int id, SensorCalibration& out) const;
+
 private:
     /**
      * @brief Статическая обертка для задачи FreeRTOS.
@@ -66,19 +215,128 @@ private:
     // Объявление метода обработки
     void processSensorEvent(const Event& event);
 
+    /**
+     * @brief Обрабатывает кадр опроса целиком: маска пересчитывается один раз за кадр.
+     */
+    void processSensorFrame(const SensorFramePayload& frame);
+
+    /**
+     * @brief Логика сенсора Mute (публикует MUTE_ENABLED/MUTE_DISABLED).
+     */
+    void processMuteValue(int value);
+
+    /**
+     * @brief Сбрасывает полосы и строит таблицу ID -> полоса (по hole_sensor_ids).
+     */
+    void resetLanes(size_t historySize);
+
+    /**
+     * @brief Пороги полосы с гистерезисом относительно ее текущего состояния
+     * (при неподтвержденном предсказании - относительно состояния до него).
+     */
+    void refreshLaneLevels(size_t lane);
+
+    void setLaneState(size_t lane, SensorState state);
+
+    /**
+     * @brief Состояние игрового сенсора по ID (OPEN, если ID не игровой).
+     */
+    SensorState holeState(int id) const;
+
+    /**
+     * @brief Калибровка базы при старте и медленное слежение за базой (уверенно открыт)
+     * и уровнем закрытия (уверенно закрыт). O(1) на значение.
+     */
+    void adaptLaneThresholds(size_t lane, int sample);
+
+    /**
+     * @brief Пороги полосы относительно ее базы и размаха.
+     */
+    void applyLaneThresholds(size_t lane);
+
+    float laneRange(size_t lane) const;
+
+    /**
+     * @brief Учитывает переходы по голым порогам в полосах lanes.
+     */
+    void trackRawStates(const SensorFrameKernel::Bits& raw, uint32_t lanes);
+
+    /**
+     * @brief Пересечет ли значение hole_closed_threshold в пределах горизонта
+     * (экстраполяция по наклону и ускорению последних трех значений истории).
+     */
+    bool predictsClosing(const SensorHistory::View& history, int32_t closedThreshold) const;
+
+    /**
+     * @brief История и вибрато полосы.
+     */
+    void recordLaneValue(size_t lane, int value);
+
+    /**
+     * @brief Предсказание, выдержка и смена состояния полосы.
+     * @param classified Состояние по порогам с гистерезисом (refreshLaneLevels).
+     * @return true, если состояние изменилось (маску нужно пересчитать).
+     */
+    bool stepLane(size_t lane, SensorState classified);
+
+    /**
+     * @brief Значение одиночного игрового сенсора: полоса по таблице ID, история, вибрато, состояние.
+     * @return true, если состояние сенсора изменилось.
+     */
+    bool processHoleValue(int id, int value);
+
     void updateMaskAndPublish();
 
     /**
-     * @brief Реализация алгоритма детекции вибрато (Zero-Crossing).
+     * @brief Выдержка маски: публикует сразу или держит до стабильности mask_settle_ms.
+     */
+    void settleMask(HoleMask newMask);
+
+    /**
+     * @brief Публикует удерживаемую маску, если она простояла mask_settle_ms (на каждом значении
+     * и по таймауту ожидания задачи).
+     */
+    void pollMaskSettle();
+
+    /**
+     * @brief Публикует маску и затем отложенные на время выдержки события полузакрытия.
+     */
+    void commitMask(HoleMask mask);
+
+    /**
+     * @brief HALF_HOLE_DETECTED - сразу или после удерживаемой маски (маска сбрасывает полузакрытие).
+     */
+    void publishHalfHole(int id);
+
+    /**
+     * @brief Публикует результат в шину fused_pipeline (если включена) или в EventDispatcher.
+     */
+    template <EventType T>
+    void publish(const EventPayload<T>& payload);
+
+    /**
+     * @brief Реализация алгоритма детекции вибрато (Zero-Crossing) по статистике окна.
      * @return float Глубина вибрато (0.0 - 1.0). Если 0.0 - вибрато нет.
      */
-    float analyzeVibrato(const std::vector<int>& history);
+    float analyzeVibrato(SensorHistory& history);
+
+    /**
+     * @brief Детекция вибрато банком скользящих бинов DFT (vibrato_detector = goertzel).
+     * @return float Глубина вибрато (0.0 - 1.0). Если 0.0 - вибрато нет.
+     */
+    float analyzeVibratoBins(const SlidingDftBank::State& bins);
 
     EventDispatcher* m_dispatcher;
     ConfigManager* m_configManager;
 
+    // Типизированная шина fused_pipeline (nullptr - только события)
+    AppPipelineBus* m_pipeline;
+
     // Внутренняя очередь для буферизации событий от hal_sensors
-    QueueHandle_t m_sensorQueue;
+    SensorQueue m_sensorQueue;
+    // ESP32: TaskHandle_t задачи appLogicTask (void*, чтобы не тянуть FreeRTOS.h в заголовок)
+    void* m_task;
+    uint32_t m_reportedGaps; // Пропуски, о которых уже предупредили
 
     // --- Параметры из ConfigManager ---
     int m_muteSensorId;
@@ -86,13 +344,43 @@ private:
     int m_muteThreshold;
     int m_holeClosedThreshold;
     int m_halfHoleThreshold;
+    int m_hysteresis;   // threshold_hysteresis: на сколько значение должно уйти ниже порога, чтобы "отпустить"
+    int m_dwellSamples; // state_dwell_samples: сколько значений подряд новое состояние должно продержаться
+    int m_sampleRateHz;
+    int m_predictSamples; // Горизонт предсказания закрытия в значениях (0 - выключено)
+    // Адаптивные пороги: база и размах по умолчанию дают глобальные пороги
+    bool m_adaptive;
+    float m_closedRatio;
+    float m_halfRatio;
+    float m_defaultBaseline;
+    float m_defaultRange;
+    uint16_t m_calibrationSamples;
+    float m_driftAlpha; // Шаг EMA слежения за базой (1 / baseline_tau в значениях)
     // (и параметры вибрато)
     float m_vibratoFreqMin;
     float m_vibratoFreqMax;
     int m_vibratoAmplitudeMin;
+    VibratoDetector m_vibratoDetector;
+    SlidingDftBank m_vibratoBank; // Коэффициенты бинов (общие для всех сенсоров)
 
     // --- Состояние (State) ---
     bool m_isMuted;
-    uint8_t m_currentMask; // 8-битная маска (только CLOSED)
-    SensorContext m_sensorContexts[16]; // Макс. 16 сенсоров
+    bool m_muteRaw;             // Mute по голому порогу
+    bool m_mutePending;
+    uint16_t m_mutePendingCount;
+    uint32_t m_rawTransitions;  // Переходы по голым порогам
+    uint32_t m_transitions;     // Состоявшиеся переходы
+    HoleMask m_currentMask; // Маска отверстий (CLOSED и HALF_HOLE), HOLE_MASK_BITS бит
+
+    // --- Выдержка маски (mask_settle_ms) ---
+    int m_maskSettleMs;
+    std::unordered_set<HoleMask> m_knownMasks; // Маски известных аппликатур (копия, поиск за O(1))
+    bool m_maskPending;
+    HoleMask m_pendingMask;
+    uint32_t m_pendingSinceMs;
+    uint32_t m_deferredHalfHoles; // Биты ID, чье полузакрытие ждет публикации маски
+    MaskSettleStats m_settleStats;
+    OnsetPredictionStats m_predictionStats;
+    HoleSensorLanes m_lanes;
+    int8_t m_laneOfId[MAX_SENSOR_IDS]; // ID -> полоса (-1 - не игровой)
 };
\ No newline at end of file
@@ -6,10 +6,12 @@
  */
 #pragma once
 
+#include <atomic>
 #include "interfaces/IHalBle.h"
 #include "interfaces/IHalLed.h"
 #include "core/EventDispatcher.h"
 #include "interfaces/IEventHandler.h"
+#include "core/TypedEventBus.h"
 
 class AppMidi : public IEventHandler {
 public:
@@ -20,6 +22,14 @@ public:
      */
     bool init(IHalBle* halBle, IHalLed* halLed, float basePitchHz);
 
+    /**
+     * @brief Включает режим прямых вызовов (fused_pipeline).
+     * Ноты, вибрато и mute приходят через AppPipelineBus из задачи AppLogic,
+     * а subscribe() подписывает модуль только на BLE_CONNECTED.
+     * Вызывать до subscribe().
+     */
+    void setFusedMode(bool fused);
+
     /**
      * @brief Подписывает модуль на события от EventDispatcher.
      */
@@ -30,6 +40,17 @@ public:
      */
     virtual void handleEvent(const Event& event) override;
 
+    // --- Прямые вызовы (fused_pipeline и handleEvent) ---
+    void onNoteSelected(int note);
+    void onVibrato(float depth);
+    void onMuteChanged(bool muted);
+
+    // --- Маршруты типизированной шины (AppPipelineBus) ---
+    void onEvent(EventTag<EventType::NOTE_PITCH_SELECTED>, const NotePitchPayload& p) { onNoteSelected(p.pitch); }
+    void onEvent(EventTag<EventType::VIBRATO_DETECTED>, const VibratoPayload& p) { onVibrato(p.depth); }
+    void onEvent(EventTag<EventType::MUTE_ENABLED>, const EmptyPayload&) { onMuteChanged(true); }
+    void onEvent(EventTag<EventType::MUTE_DISABLED>, const EmptyPayload&) { onMuteChanged(false); }
+
 private:
     /**
      * @brief Реализует логику (NoteOff -> NoteOn) для предотвращения "залипания".
@@ -42,6 +63,8 @@ private:
     
     // Переменные состояния
     int m_currentNote; // Последняя нота, которую мы отправили (0 = Note Off)
-    bool m_isMuted;
+    // Атомарно: при dual_core_dispatch вибрато (BULK) читает его в другом цикле, чем mute (REALTIME)
+    std::atomic<bool> m_isMuted;
     float m_basePitchHz;
+    bool m_fusedMode;
 };
\ No newline at end of file
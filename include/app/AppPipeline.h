@@ -0,0 +1,25 @@
+/*
+ * AppPipeline.h
+ *
+ * Типизированная шина "горячего" пути (fused_pipeline):
+ * AppLogic -> AppFingering -> AppMidi.
+ * Таблица маршрутов известна при компиляции; обработчики получают
+ * конкретные структуры данных через прямые вызовы onEvent().
+ *
+ * Соответствует: docs/modules/core_scheduler.md
+ */
+#pragma once
+
+#include "core/TypedEventBus.h"
+
+class AppFingering;
+class AppMidi;
+
+using AppPipelineBus = TypedEventBus<
+    TypedRoute<EventType::SENSOR_MASK_CHANGED, AppFingering>,
+    TypedRoute<EventType::HALF_HOLE_DETECTED, AppFingering>,
+    TypedRoute<EventType::NOTE_PITCH_SELECTED, AppMidi>,
+    TypedRoute<EventType::VIBRATO_DETECTED, AppMidi>,
+    TypedRoute<EventType::MUTE_ENABLED, AppMidi>,
+    TypedRoute<EventType::MUTE_DISABLED, AppMidi>
+>;
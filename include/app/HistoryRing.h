@@ -0,0 +1,86 @@
+/*
+ * HistoryRing.h
+ *
+ * Кольцевой буфер последних значений фиксированной емкости (история сенсора для DSP).
+ *
+ * - Без кучи: хранилище - массив на 2 * MaxCapacity элементов внутри объекта.
+ * - Рабочая емкость задается в рантайме (setCapacity, напр. из sample_rate_hz), не больше MaxCapacity.
+ * - push() - O(1): значение пишется дважды (в слот и в его "зеркало" через capacity), поэтому
+ *   история от старого к новому всегда лежит подряд и view() отдает ее без копирования.
+ * - Однопоточный (принадлежит задаче appLogicTask).
+ *
+ * Соответствует: docs/modules/app_logic.md
+ */
+#pragma once
+
+#include <cstddef>
+
+template <typename T, size_t MaxCapacity>
+class HistoryRing {
+    static_assert(MaxCapacity >= 1, "HistoryRing needs at least one slot");
+
+public:
+    /**
+     * @brief Непрерывный вид истории (от старого значения к новому). Действителен до следующего push().
+     */
+    struct View {
+        const T* first;
+        size_t count;
+
+        const T* data() const { return first; }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        const T* begin() const { return first; }
+        const T* end() const { return first + count; }
+        const T& operator[](size_t i) const { return first[i]; }
+    };
+
+    HistoryRing() : m_capacity(MaxCapacity), m_write(0), m_size(0) {}
+
+    /**
+     * @brief Задает рабочую емкость (1..MaxCapacity, значения вне диапазона насыщаются) и очищает историю.
+     */
+    void setCapacity(size_t capacity) {
+        if (capacity < 1) capacity = 1;
+        if (capacity > MaxCapacity) capacity = MaxCapacity;
+        m_capacity = capacity;
+        clear();
+    }
+
+    void clear() {
+        m_write = 0;
+        m_size = 0;
+    }
+
+    /**
+     * @brief Добавляет значение; при заполненной истории вытесняет самое старое.
+     */
+    void push(const T& value) {
+        m_data[m_write] = value;
+        m_data[m_write + m_capacity] = value;
+        if (++m_write == m_capacity) m_write = 0;
+        if (m_size < m_capacity) ++m_size;
+    }
+
+    View view() const {
+        // Окно [m_write + capacity - size, m_write + capacity) всегда внутри зеркального массива
+        return View{m_data + m_write + m_capacity - m_size, m_size};
+    }
+
+    /**
+     * @brief Самое старое значение (только для !empty()) - то, которое вытеснит следующий push().
+     */
+    const T& oldest() const { return view()[0]; }
+    const T& newest() const { return m_data[m_write + m_capacity - 1]; }
+
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_capacity; }
+    bool empty() const { return m_size == 0; }
+    bool full() const { return m_size == m_capacity; }
+
+private:
+    T m_data[2 * MaxCapacity];
+    size_t m_capacity;
+    size_t m_write; // Слот следующей записи (0..capacity-1)
+    size_t m_size;
+};
@@ -0,0 +1,49 @@
+/*
+ * SensorFrameKernel.h
+ *
+ * Ядро кадра: сравнивает значения всех игровых сенсоров с их порогами разом и отдает
+ * результат битовыми наборами (бит = полоса = бит маски отверстий).
+ *
+ * - Данные - структура массивов (int32 на полосу, до MAX_LANES полос подряд).
+ * - Host: AVX2 (8 полос за сравнение) или SSE2 (4 полосы); ESP32-S3: PIE (4 полосы, массивы
+ *   выровнены по 16 байт, иначе скалярный путь); иначе - скалярный вариант без ветвлений.
+ * - Стоимость - ceil(lanes / ширину вектора) сравнений, маска собирается из битов без прохода по сенсорам.
+ * - Без состояния, потокобезопасно.
+ *
+ * Соответствует: docs/modules/app_logic.md
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class SensorFrameKernel {
+public:
+    static constexpr size_t MAX_LANES = 16;
+
+    /**
+     * @brief Результат классификации кадра (бит i - полоса i).
+     */
+    struct Bits {
+        uint32_t closed; // value > closedLevel
+        uint32_t held;   // value > halfLevel или closed: HALF_HOLE либо CLOSED (бит маски отверстий)
+    };
+
+    /**
+     * @brief Классифицирует полосы [0, lanes) векторным вариантом сборки.
+     * Массивы - не меньше MAX_LANES элементов: векторный проход читает полосы до кратного
+     * ширине вектора, лишние биты отбрасываются.
+     */
+    static Bits classify(const int32_t* values, const int32_t* closedLevels, const int32_t* halfLevels, size_t lanes);
+
+    /**
+     * @brief Эталонный скалярный вариант (тот же результат, что и classify()).
+     */
+    static Bits classifyScalar(const int32_t* values, const int32_t* closedLevels, const int32_t* halfLevels,
+                               size_t lanes);
+
+    /**
+     * @brief Вариант, выбранный при сборке: "avx2", "sse2", "pie" или "scalar".
+     */
+    static const char* implementation();
+};
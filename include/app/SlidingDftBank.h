@@ -0,0 +1,90 @@
+/*
+ * SlidingDftBank.h
+ *
+ * Детектор вибрато на банке скользящих бинов DFT (sliding Goertzel), vibrato_detector = goertzel.
+ *
+ * - Окно - последние vibrato_window_ms значений (короче секундного окна zero-crossing),
+ *   каждый бин обновляется за O(1) на значение: стоимость O(бинов), без прохода по окну.
+ * - До MAX_BANDS бинов равномерно покрывают vibrato_freq_min_hz..vibrato_freq_max_hz;
+ *   сторожевые бины ниже и выше полосы отсекают ступеньки (палец закрыл отверстие) и медленный дрейф.
+ * - Среднее окна (DC) вычитается точно: его вклад в каждый бин известен заранее.
+ * - Коэффициенты общие для всех сенсоров (SlidingDftBank), состояние - на сенсор (State).
+ * - Однопоточный (задача appLogicTask).
+ *
+ * Соответствует: docs/modules/app_logic.md
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class SlidingDftBank {
+public:
+    static constexpr size_t MAX_BANDS = 8;  // Бины в полосе вибрато
+    static constexpr size_t GUARD_BINS = 3; // 0.5 и 0.75 * freq_min, 1.15 * freq_max
+    static constexpr size_t MAX_BINS = MAX_BANDS + GUARD_BINS;
+    static constexpr size_t MIN_WINDOW = 4;
+
+    // Доля энергии окна (без DC) в доминирующем бине: 1.0 - чистая синусоида
+    static constexpr float MIN_TONALITY = 0.7f;
+    // Затухание рекурсии: ошибки округления float не накапливаются (постоянная ~2000 значений)
+    static constexpr float DAMPING = 0.9995f;
+
+    /**
+     * @brief Состояние бинов одного сенсора.
+     */
+    struct State {
+        float re[MAX_BINS];
+        float im[MAX_BINS];
+        int64_t sum;
+        uint64_t sumSq;
+        uint32_t count; // Значений в окне (до windowSize())
+    };
+
+    struct Result {
+        bool detected;
+        float frequencyHz; // Доминирующая частота (интерполяция между соседними бинами)
+        float depth;       // Глубина 0.0 - 1.0 (размах / 500, как у zero-crossing)
+        int amplitude;     // Оценка размаха доминирующей составляющей
+        float tonality;
+    };
+
+    SlidingDftBank();
+
+    /**
+     * @brief Рассчитывает коэффициенты бинов. Частоты не ниже Найквиста (sampleRateHz / 2) отбрасываются.
+     * @param windowSamples Длина окна в значениях (насыщается снизу до MIN_WINDOW).
+     */
+    void configure(float sampleRateHz, float freqMinHz, float freqMaxHz, size_t windowSamples);
+
+    size_t windowSize() const { return m_window; }
+    size_t bandCount() const { return m_bandCount; }
+
+    void reset(State& state) const;
+
+    /**
+     * @brief Добавляет значение в окно. O(бинов).
+     * @param evicted Значение, покидающее окно (windowSize() значений назад); пока окно
+     *                не заполнено - игнорируется.
+     */
+    void update(State& state, int value, int evicted) const;
+
+    /**
+     * @brief Доминирующая частота, глубина и решение "вибрато/нет". Только при заполненном окне.
+     */
+    Result analyze(const State& state, int amplitudeMin) const;
+
+private:
+    struct Bin {
+        float freqHz;
+        float rotRe, rotIm;   // r * e^{jw}
+        float tailRe, tailIm; // (r * e^{jw})^N - множитель вытесняемого значения
+        float dcRe, dcIm;     // Отклик бина на постоянную 1.0 по всему окну
+    };
+
+    Bin m_bins[MAX_BINS];
+    size_t m_bandCount;
+    size_t m_binCount; // Бины полосы [0, m_bandCount), далее - сторожевые
+    size_t m_window;
+    float m_gain; // Сумма r^(m+1) по окну: |бин| = амплитуда * gain / 2 для синусоиды
+};
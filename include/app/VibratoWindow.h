@@ -0,0 +1,328 @@
+/*
+ * VibratoWindow.h
+ *
+ * Скользящее окно значений сенсора со статистикой для детектора вибрато.
+ *
+ * - История - HistoryRing (без кучи, емкость задается в рантайме).
+ * - Сумма, минимум и максимум обновляются при каждом push() за O(1) (минимум/максимум -
+ *   монотонные деки, амортизированно O(1)), поэтому порог амплитуды проверяется без прохода по окну.
+ * - Пересечения среднего: у каждого значения окна хранится сторона относительно порога счетчика,
+ *   push/вытеснение правят счетчик за O(1). Значения возле порога (сетка CROSSING_BUCKETS
+ *   корзин на полосе +-размах/CROSSING_BAND_DIVISOR) связаны списками по корзинам, поэтому
+ *   сдвиг порога к новому среднему меняет сторону только значений между старым и новым
+ *   порогом - O(корзин + перешедших значений), без прохода по окну. Среднее смещается за
+ *   значение не больше чем на размах/емкость, и каждое значение пересекается им за O(1).
+ * - Проход по окну (новая сетка) - только если среднее вышло за полосу, т.е. сместилось
+ *   больше чем на четверть размаха (ступенька, смена ноты); для вибрато - один раз.
+ * - crossings() совпадает с полным проходом по истории (та же целочисленная арифметика).
+ * - Однопоточный (принадлежит задаче appLogicTask).
+ *
+ * Соответствует: docs/modules/app_logic.md
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "app/HistoryRing.h"
+
+template <size_t MaxCapacity>
+class VibratoWindow {
+    static_assert(MaxCapacity < 255, "Slot indices are stored as uint8_t");
+
+public:
+    using History = HistoryRing<uint16_t, MaxCapacity>;
+    using View = typename History::View;
+
+    // Полуширина полосы сетки - доля размаха окна
+    static constexpr int CROSSING_BAND_DIVISOR = 4;
+    // Корзин сетки на всю полосу (2 * полуширина + 1 значений)
+    static constexpr int CROSSING_BUCKETS = 64;
+
+    VibratoWindow() { clear(); }
+
+    /**
+     * @brief Задает рабочую емкость окна (1..MaxCapacity) и очищает его.
+     */
+    void setCapacity(size_t capacity) {
+        m_history.setCapacity(capacity);
+        clear();
+    }
+
+    void clear() {
+        m_history.clear();
+        m_sum = 0;
+        m_seq = 0;
+        m_newest = 0;
+        m_min.clear();
+        m_max.clear();
+        m_crossings = 0;
+        m_crossThreshold = 0;
+        m_gridCenter = 0;
+        m_gridBand = 0;
+        m_gridLow = 0;
+        m_bucketWidth = 1;
+        m_crossingsValid = false;
+        m_gridBuilds = 0;
+        m_thresholdFlips = 0;
+    }
+
+    /**
+     * @brief Добавляет значение; при заполненном окне вытесняет самое старое. O(1) амортизированно.
+     */
+    void push(uint16_t value) {
+        const size_t capacity = m_history.capacity();
+        const size_t size = m_history.size();
+        if (m_history.full()) {
+            m_sum -= m_history.view()[0];
+            const size_t oldest = oldestSlot();
+            if (size >= 2) uncountPair(oldest, nextSlot(oldest));
+            unlinkSlot(oldest);
+        }
+        const size_t previous = m_newest;
+        m_newest = size == 0 ? 0 : nextSlot(m_newest);
+
+        m_history.push(value);
+        m_sum += value;
+        if (m_crossingsValid) {
+            setAbove(m_newest, value > m_crossThreshold);
+            linkSlot(m_newest, value);
+            if (size >= 1 && capacity >= 2) countPair(previous, m_newest);
+        }
+
+        // Номер значения в потоке; в окне - номера (m_seq - capacity, m_seq]
+        ++m_seq;
+        const uint32_t expired = m_seq - (uint32_t)capacity;
+        m_min.expire(expired);
+        m_max.expire(expired);
+        m_min.pushMin(value, m_seq);
+        m_max.pushMax(value, m_seq);
+    }
+
+    View view() const { return m_history.view(); }
+    size_t size() const { return m_history.size(); }
+    size_t capacity() const { return m_history.capacity(); }
+    bool empty() const { return m_history.empty(); }
+
+    /**
+     * @brief Минимум/максимум окна (только для !empty()).
+     */
+    int minValue() const { return m_min.front(); }
+    int maxValue() const { return m_max.front(); }
+
+    long sum() const { return m_sum; }
+
+    /**
+     * @brief Целое среднее (сумма / размер, с отбрасыванием дробной части). Только для !empty().
+     */
+    int mean() const { return (int)(m_sum / (long)m_history.size()); }
+
+    /**
+     * @brief Количество смен стороны относительно mean() между соседними значениями
+     * ("выше среднего" - строго больше). Порог счетчика сдвигается к среднему по сетке.
+     */
+    int crossings() {
+        if (m_history.size() < 2) return 0;
+        const int threshold = mean();
+        const int offset = threshold - m_gridCenter;
+        if (!m_crossingsValid || offset > m_gridBand || -offset > m_gridBand) {
+            buildGrid(threshold);
+        } else if (threshold != m_crossThreshold) {
+            moveThreshold(threshold);
+        }
+        return m_crossings;
+    }
+
+    /**
+     * @brief Сколько раз сетка строилась проходом по окну (с последнего clear()).
+     */
+    uint32_t gridBuilds() const { return m_gridBuilds; }
+
+    /**
+     * @brief Сколько значений сменили сторону при сдвигах порога (с последнего clear()).
+     */
+    uint32_t thresholdFlips() const { return m_thresholdFlips; }
+
+private:
+    static constexpr uint8_t NO_SLOT = 0xFF;
+
+    // Дек номеров/значений на кольце MaxCapacity (в окне не больше capacity значений)
+    struct MonotonicDeque {
+        uint16_t values[MaxCapacity];
+        uint32_t seqs[MaxCapacity];
+        size_t head;
+        size_t count;
+
+        void clear() {
+            head = 0;
+            count = 0;
+        }
+
+        int front() const { return values[head]; }
+
+        void expire(uint32_t lastExpiredSeq) {
+            // Разность номеров, а не сравнение: номер переполняется через 2^32 значений
+            while (count > 0 && (int32_t)(seqs[head] - lastExpiredSeq) <= 0) {
+                head = (head + 1) % MaxCapacity;
+                --count;
+            }
+        }
+
+        void pushMin(uint16_t value, uint32_t seq) {
+            while (count > 0 && values[back()] >= value) --count;
+            pushBack(value, seq);
+        }
+
+        void pushMax(uint16_t value, uint32_t seq) {
+            while (count > 0 && values[back()] <= value) --count;
+            pushBack(value, seq);
+        }
+
+    private:
+        size_t back() const { return (head + count - 1) % MaxCapacity; }
+
+        void pushBack(uint16_t value, uint32_t seq) {
+            const size_t slot = (head + count) % MaxCapacity;
+            values[slot] = value;
+            seqs[slot] = seq;
+            ++count;
+        }
+    };
+
+    // Слоты окна идут по кругу capacity, как в HistoryRing
+    size_t nextSlot(size_t slot) const { return slot + 1 < m_history.capacity() ? slot + 1 : 0; }
+    size_t prevSlot(size_t slot) const { return slot > 0 ? slot - 1 : m_history.capacity() - 1; }
+    size_t oldestSlot() const {
+        const size_t capacity = m_history.capacity();
+        return (m_newest + capacity + 1 - m_history.size()) % capacity;
+    }
+    int slotValue(size_t slot) const {
+        const size_t capacity = m_history.capacity();
+        return m_history.view()[(slot + capacity - oldestSlot()) % capacity];
+    }
+
+    bool above(size_t slot) const { return (m_above[slot / 32] >> (slot % 32)) & 1u; }
+    void setAbove(size_t slot, bool value) {
+        if (value) {
+            m_above[slot / 32] |= 1u << (slot % 32);
+        } else {
+            m_above[slot / 32] &= ~(1u << (slot % 32));
+        }
+    }
+
+    void countPair(size_t a, size_t b) {
+        if (above(a) != above(b)) ++m_crossings;
+    }
+
+    void uncountPair(size_t a, size_t b) {
+        if (m_crossingsValid && above(a) != above(b)) --m_crossings;
+    }
+
+    // Корзина сетки (-1 - вне полосы)
+    int bucketOf(int value) const {
+        if (value < m_gridLow) return -1;
+        const int bucket = (value - m_gridLow) / m_bucketWidth;
+        return bucket < CROSSING_BUCKETS ? bucket : -1;
+    }
+
+    void linkSlot(size_t slot, int value) {
+        const int bucket = bucketOf(value);
+        m_bucketOfSlot[slot] = bucket < 0 ? NO_SLOT : (uint8_t)bucket;
+        if (bucket < 0) return;
+        m_prev[slot] = NO_SLOT;
+        m_next[slot] = m_bucketHead[bucket];
+        if (m_next[slot] != NO_SLOT) m_prev[m_next[slot]] = (uint8_t)slot;
+        m_bucketHead[bucket] = (uint8_t)slot;
+    }
+
+    void unlinkSlot(size_t slot) {
+        if (!m_crossingsValid || m_bucketOfSlot[slot] == NO_SLOT) return;
+        if (m_prev[slot] != NO_SLOT) {
+            m_next[m_prev[slot]] = m_next[slot];
+        } else {
+            m_bucketHead[m_bucketOfSlot[slot]] = m_next[slot];
+        }
+        if (m_next[slot] != NO_SLOT) m_prev[m_next[slot]] = m_prev[slot];
+        m_bucketOfSlot[slot] = NO_SLOT;
+    }
+
+    /**
+     * @brief Меняет сторону значения: правятся только две пары с его соседями. O(1).
+     */
+    void flipSlot(size_t slot) {
+        const bool hasPrev = slot != oldestSlot();
+        const bool hasNext = slot != m_newest;
+        if (hasPrev) uncountPair(prevSlot(slot), slot);
+        if (hasNext) uncountPair(slot, nextSlot(slot));
+        setAbove(slot, !above(slot));
+        ++m_thresholdFlips;
+        if (hasPrev) countPair(prevSlot(slot), slot);
+        if (hasNext) countPair(slot, nextSlot(slot));
+    }
+
+    /**
+     * @brief Сдвигает порог счетчика внутри сетки: сторону меняют только значения из корзин
+     * между старым и новым порогом.
+     */
+    void moveThreshold(int threshold) {
+        const int low = threshold < m_crossThreshold ? threshold : m_crossThreshold;
+        const int high = threshold < m_crossThreshold ? m_crossThreshold : threshold;
+        m_crossThreshold = threshold;
+        for (int bucket = bucketOf(low); bucket <= bucketOf(high); ++bucket) {
+            for (uint8_t slot = m_bucketHead[bucket]; slot != NO_SLOT; slot = m_next[slot]) {
+                if (above(slot) != (slotValue(slot) > threshold)) flipSlot(slot);
+            }
+        }
+    }
+
+    /**
+     * @brief Новая сетка вокруг порога: проход по окну (стороны, пары, списки корзин).
+     */
+    void buildGrid(int threshold) {
+        m_crossThreshold = threshold;
+        m_gridCenter = threshold;
+        m_gridBand = (maxValue() - minValue()) / CROSSING_BAND_DIVISOR;
+        if (m_gridBand < 1) m_gridBand = 1;
+        m_gridLow = threshold - m_gridBand;
+        m_bucketWidth = (2 * m_gridBand + CROSSING_BUCKETS) / CROSSING_BUCKETS;
+        for (int i = 0; i < CROSSING_BUCKETS; ++i) {
+            m_bucketHead[i] = NO_SLOT;
+        }
+        m_crossings = 0;
+        m_crossingsValid = true;
+        ++m_gridBuilds;
+
+        const View window = m_history.view();
+        size_t slot = oldestSlot();
+        for (size_t i = 0; i < window.size(); ++i) {
+            setAbove(slot, window[i] > threshold);
+            linkSlot(slot, window[i]);
+            if (i > 0) countPair(prevSlot(slot), slot);
+            slot = nextSlot(slot);
+        }
+    }
+
+    History m_history;
+    long m_sum;
+    uint32_t m_seq;  // Номер последнего добавленного значения
+    size_t m_newest; // Слот последнего значения
+    MonotonicDeque m_min;
+    MonotonicDeque m_max;
+
+    // Счетчик пересечений действителен для порога m_crossThreshold
+    int m_crossings;
+    int m_crossThreshold;
+    bool m_crossingsValid;
+    uint32_t m_above[(MaxCapacity + 31) / 32]; // Бит слота: значение > m_crossThreshold
+
+    // Сетка корзин [m_gridLow, m_gridLow + CROSSING_BUCKETS * m_bucketWidth) вокруг m_gridCenter
+    int m_gridCenter;
+    int m_gridBand;
+    int m_gridLow;
+    int m_bucketWidth;
+    uint8_t m_bucketHead[CROSSING_BUCKETS];
+    uint8_t m_next[MaxCapacity];
+    uint8_t m_prev[MaxCapacity];
+    uint8_t m_bucketOfSlot[MaxCapacity]; // NO_SLOT - значение вне сетки
+    uint32_t m_gridBuilds;
+    uint32_t m_thresholdFlips;
+};
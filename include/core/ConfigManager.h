@@ -10,6 +10,13 @@
 #include <string>
 #include "interfaces/IHalStorage.h" // Для init()
 #include "LogLevel.h"
+#include "QueuePolicy.h"
+
+// Алгоритм детекции вибрато ([gestures] vibrato_detector)
+enum class VibratoDetector {
+    ZERO_CROSSING = 0, // Пересечения среднего за секундное окно
+    GOERTZEL = 1       // Банк скользящих бинов DFT (окно vibrato_window_ms)
+};
 
 class ConfigManager {
 public:
@@ -41,17 +48,41 @@ public:
     float getFilterAlpha() const;
     int getMuteThreshold() const;
     int getHoleClosedThreshold() const;
+    bool getSensorFrameMode() const;
+    int getThresholdHysteresis() const;
+    int getStateDwellSamples() const;
+    bool getAdaptiveThresholds() const;
+    float getHoleClosedRatio() const;
+    float getHalfHoleRatio() const;
+    int getBaselineCalibrationMs() const;
+    int getBaselineTauMs() const;
 
     // --- [app_logic] ---
     int getMuteSensorId() const;
     const std::vector<int>& getHoleSensorIds() const;
+    bool getFusedPipeline() const;
+    int getMaskSettleMs() const;
+    int getPredictOnsetMs() const;
     
     // --- [gestures] ---
     float getVibratoFreqMin() const;
     float getVibratoFreqMax() const;
     int getVibratoAmplitudeMin() const;
+    VibratoDetector getVibratoDetector() const;
+    int getVibratoWindowMs() const;
     int getHalfHoleThreshold() const;
 
+    // --- [queues] ---
+    QueueConfig getRealtimeQueueConfig() const;
+    QueueConfig getBulkQueueConfig() const;
+    QueueConfig getAppLogicQueueConfig() const;
+    int getQueueBlockTimeoutMs() const;
+
+    // --- [dispatch] ---
+    bool getDualCoreDispatch() const;
+    int getRealtimeCore() const; // -1 - без привязки к ядру
+    int getBulkCore() const;
+
 private:
     /**
      * @brief Внутренний метод парсинга.
@@ -77,10 +108,30 @@ private:
     float m_filterAlpha;
     int m_muteThreshold;
     int m_holeClosedThreshold;
+    bool m_sensorFrameMode;
+    int m_thresholdHysteresis;
+    int m_stateDwellSamples;
+    bool m_adaptiveThresholds;
+    float m_holeClosedRatio;
+    float m_halfHoleRatio;
+    int m_baselineCalibrationMs;
+    int m_baselineTauMs;
     int m_muteSensorId;
     std::vector<int> m_holeSensorIds;
+    bool m_fusedPipeline;
+    int m_maskSettleMs;
+    int m_predictOnsetMs;
     float m_vibratoFreqMin;
     float m_vibratoFreqMax;
     int m_vibratoAmplitudeMin;
+    VibratoDetector m_vibratoDetector;
+    int m_vibratoWindowMs;
     int m_halfHoleThreshold;
+    QueueConfig m_realtimeQueue;
+    QueueConfig m_bulkQueue;
+    QueueConfig m_appLogicQueue;
+    int m_queueBlockTimeoutMs;
+    bool m_dualCoreDispatch;
+    int m_realtimeCore;
+    int m_bulkCore;
 };
\ No newline at end of file
@@ -6,53 +6,648 @@
  */
 #pragma once
 
-#include <vector>
-#include <map>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
 #include "events.h"
 #include "interfaces/IEventHandler.h"
+#include "core/EventQueue.h"
+#include "core/FlightRecorder.h"
+#include "core/LatencyHistogram.h"
+#include "core/TimerWheel.h"
 
-// Forward-declare FreeRTOS типы, чтобы не включать FreeRTOS.h в .h файл
-// (Это хорошая практика, чтобы уменьшить зависимости заголовков)
-typedef void* QueueHandle_t;
+#if defined(NATIVE_TEST)
+    #include <thread>
+    #include <mutex>
+    #include <condition_variable>
+#endif
+
+/**
+ * @brief Полосы приоритета диспетчера.
+ * REALTIME всегда вычерпывается раньше BULK (строгий приоритет).
+ */
+enum class EventLane : uint8_t {
+    REALTIME = 0, // Маска, полузакрытие, нота, mute
+    BULK = 1      // Сырые значения сенсоров, вибрато, таймауты, BLE
+};
+
+constexpr size_t EVENT_LANE_COUNT = 2;
+
+// Цикл доставки не закреплен за ядром
+constexpr int NO_CORE_AFFINITY = -1;
+
+/**
+ * @brief Циклы доставки (секция [dispatch] settings.cfg).
+ * - dualLoop = false: один цикл вычерпывает обе полосы (строгий приоритет REALTIME),
+ *   закрепляется за ядром laneCore[REALTIME].
+ * - dualLoop = true: у каждой полосы свой цикл (задача FreeRTOS на ядре laneCore[полоса],
+ *   Native - поток с привязкой к CPU). Тип события попадает в цикл своей полосы (setEventLane),
+ *   поэтому путь "палец -> нота" не ждет вибрато, BLE и логирование.
+ */
+struct DispatchLoopConfig {
+    bool dualLoop;
+    int laneCore[EVENT_LANE_COUNT];
+};
+
+/**
+ * @brief Фильтр подписки по содержимому события: проверяется циклом диспетчера до вызова
+ * handleEvent(), поэтому обработчик (и его внутренняя очередь) не платит за ненужный трафик.
+ * - ID (битовый набор, id 0..31): SENSOR_VALUE_CHANGED, HALF_HOLE_DETECTED, VIBRATO_DETECTED.
+ * - Значение (диапазон включительно): SENSOR_VALUE_CHANGED (value), SENSOR_MASK_CHANGED (mask),
+ *   NOTE_PITCH_SELECTED (pitch).
+ * Условие, неприменимое к типу события (и SENSOR_FRAME целиком), событие пропускает.
+ */
+struct EventFilter {
+    static constexpr uint32_t ANY_ID = 0xFFFFFFFFu; // Все ID, включая >= 32
+
+    uint32_t idMask;
+    int32_t minValue;
+    int32_t maxValue;
+
+    static constexpr EventFilter all() { return EventFilter{ANY_ID, INT32_MIN, INT32_MAX}; }
+    static constexpr EventFilter ids(uint32_t mask) { return EventFilter{mask, INT32_MIN, INT32_MAX}; }
+    static constexpr EventFilter valueRange(int32_t minValue, int32_t maxValue) {
+        return EventFilter{ANY_ID, minValue, maxValue};
+    }
+    // Бит для ID (0, если ID не помещается в набор)
+    static constexpr uint32_t idBit(int id) { return id >= 0 && id < 32 ? (1u << id) : 0; }
+
+    bool passesAll() const {
+        return idMask == ANY_ID && minValue == INT32_MIN && maxValue == INT32_MAX;
+    }
+
+    bool matches(const Event& event) const {
+        switch (event.type) {
+            case EventType::SENSOR_VALUE_CHANGED:
+                return matchesId(event.payload.sensorValue.id) && matchesValue(event.payload.sensorValue.value);
+            case EventType::HALF_HOLE_DETECTED:
+                return matchesId(event.payload.halfHole.id);
+            case EventType::VIBRATO_DETECTED:
+                return matchesId(event.payload.vibrato.id);
+            case EventType::SENSOR_MASK_CHANGED:
+                return matchesValue((int32_t)event.payload.sensorMask.mask);
+            case EventType::NOTE_PITCH_SELECTED:
+                return matchesValue(event.payload.notePitch.pitch);
+            default:
+                return true;
+        }
+    }
+
+private:
+    bool matchesId(int id) const {
+        return idMask == ANY_ID || (idMask & idBit(id)) != 0;
+    }
+    bool matchesValue(int32_t value) const {
+        return value >= minValue && value <= maxValue;
+    }
+};
+
+/**
+ * @brief Набор подписчиков (значение): по списку обработчиков на каждый EventType, без кучи.
+ * Диспетчер публикует неизменяемые копии набора (см. EventDispatcher::replaceSubscribers).
+ */
+class SubscriberSet {
+public:
+    // Максимум подписчиков на один тип события
+    static constexpr size_t MAX_HANDLERS_PER_TYPE = 8;
+
+    SubscriberSet();
+
+    /**
+     * @brief Добавляет обработчик в конец списка типа. @return false, если список заполнен.
+     */
+    bool add(EventType type, IEventHandler* handler, const EventFilter& filter = EventFilter::all());
+
+    /**
+     * @brief Удаляет первое вхождение обработчика из списка типа (порядок остальных сохраняется).
+     */
+    bool remove(EventType type, IEventHandler* handler);
+
+    /**
+     * @brief Удаляет обработчик из всех списков. @return Количество удаленных подписок.
+     */
+    size_t removeAll(IEventHandler* handler);
+
+    void clear();
+
+    size_t count(EventType type) const;
+    IEventHandler* at(EventType type, size_t slot) const;
+    EventFilter filterAt(EventType type, size_t slot) const;
+
+private:
+    // Цикл доставки читает списки напрямую
+    friend class EventDispatcher;
+
+    // Список подписчиков одного типа события
+    struct HandlerList {
+        IEventHandler* handlers[MAX_HANDLERS_PER_TYPE];
+        EventFilter filters[MAX_HANDLERS_PER_TYPE];
+        // Гистограмма времени подписки: закреплена за ней при add() и не меняется при сдвигах
+        uint8_t statSlots[MAX_HANDLERS_PER_TYPE];
+        uint8_t count;
+        uint8_t filtered; // Бит i - у подписчика i есть фильтр (остальных цикл не проверяет)
+    };
+
+    HandlerList m_lists[EVENT_TYPE_COUNT];
+};
 
 class EventDispatcher {
 public:
+    // Емкость полос по умолчанию (настраивается в [queues] settings.cfg)
+    static constexpr size_t REALTIME_QUEUE_CAPACITY = 16;
+    static constexpr size_t BULK_QUEUE_CAPACITY = 32;
+    // Максимальная емкость полосы (размер статического хранилища, степень двойки)
+    static constexpr size_t MAX_QUEUE_CAPACITY = 128;
+    // Максимум подписчиков на один тип события (таблица фиксированного размера)
+    static constexpr size_t MAX_HANDLERS_PER_TYPE = SubscriberSet::MAX_HANDLERS_PER_TYPE;
+    // Файл дампа самописца по умолчанию
+    static constexpr const char* FLIGHT_RECORDER_PATH = "/flight.bin";
+    // Максимум циклов доставки (по одному на полосу)
+    static constexpr size_t MAX_DISPATCH_LOOPS = EVENT_LANE_COUNT;
+
     EventDispatcher();
-    
+    ~EventDispatcher();
+
     /**
-     * @brief Создает очередь и запускает задачу-обработчик.
+     * @brief Очищает буфер и запускает задачу-обработчик.
+     * - ESP32: задача FreeRTOS `evtLoop` (или `evtRt` + `evtBulk` в режиме двух циклов).
+     * - Native: синхронный режим (событие обрабатывается прямо в postEvent).
+     *   Настоящие потоки включаются через startLoopThread().
      */
     bool init();
+    bool init(const DispatchLoopConfig& loops);
+
+    /**
+     * @brief Количество циклов доставки (1 или 2, задается в init()).
+     */
+    size_t getLoopCount() const;
+
+    /**
+     * @brief Номер цикла, который доставляет события типа (0 - REALTIME или единственный).
+     */
+    size_t getLoopIndex(EventType type) const;
 
     /**
      * @brief Подписывает объект (handler) на получение событий типа (type).
+     * Можно вызывать в любой момент из любой задачи (см. replaceSubscribers()).
      * @param type Тип события (e.g., EventType::SENSOR_VALUE_CHANGED)
      * @param handler Указатель (this) на объект, реализующий IEventHandler
+     * @return false, если список подписчиков типа заполнен.
      */
     bool subscribe(EventType type, IEventHandler* handler);
-    
+
+    /**
+     * @brief Подписка с фильтром по содержимому (ID сенсора, диапазон значения).
+     * Событие, не прошедшее фильтр, этому обработчику не доставляется.
+     */
+    bool subscribe(EventType type, IEventHandler* handler, const EventFilter& filter);
+
+    /**
+     * @brief Отписывает обработчик от типа события.
+     * Вне обработчиков после возврата handler больше не вызывается (его можно удалять);
+     * из обработчика - ожидание не выполняется, текущая доставка завершается как была начата.
+     * @return false, если handler не был подписан на type.
+     */
+    bool unsubscribe(EventType type, IEventHandler* handler);
+
+    /**
+     * @brief Отписывает обработчик от всех типов (выгрузка модуля).
+     * @return Количество снятых подписок.
+     */
+    size_t unsubscribeAll(IEventHandler* handler);
+
+    /**
+     * @brief Копия текущего набора подписчиков (для правки и replaceSubscribers()).
+     */
+    void getSubscribers(SubscriberSet& out) const;
+
+    /**
+     * @brief Атомарно заменяет весь набор подписчиков (перезагрузка модулей/профиля).
+     * Набор копируется в свободный снимок и публикуется одной записью указателя: цикл видит
+     * либо старый набор, либо новый целиком. Старый снимок освобождается, когда все циклы
+     * пройдут точку покоя (между событиями или сон). Как и unsubscribe(), вне обработчиков
+     * дожидается, пока старый набор перестанет использоваться.
+     * @return false, если вызвано из обработчика, а все снимки еще заняты циклами.
+     */
+    bool replaceSubscribers(const SubscriberSet& subscribers);
+
+    /**
+     * @brief Номер опубликованного набора подписчиков (растет с каждым изменением).
+     */
+    uint32_t getSubscriberGeneration() const;
+
+    /**
+     * @brief Замораживает назначение полос (конец фазы подписок в Application::init).
+     * После этого setEventLane() отклоняется: postEvent читает таблицу полос без синхронизации.
+     * Подписки по-прежнему можно менять (снимки, см. replaceSubscribers()).
+     */
+    void freezeSubscriptions();
+
+    /**
+     * @brief Назначает полосу приоритета для типа события (до freezeSubscriptions()).
+     * @return false, если назначение полос заморожено.
+     */
+    bool setEventLane(EventType type, EventLane lane);
+
+    /**
+     * @brief Возвращает полосу приоритета, назначенную типу события.
+     */
+    EventLane getEventLane(EventType type) const;
+
+    /**
+     * @brief Задает емкость и политику переполнения полосы.
+     * Можно вызывать в любой момент (обычно сразу после init() из Application).
+     */
+    void configureLane(EventLane lane, const QueueConfig& config);
+
+    /**
+     * @brief Сколько производитель ждет места при политике BLOCK_TIMEOUT (все полосы).
+     */
+    void setBlockTimeoutMs(uint32_t timeoutMs);
+
+    /**
+     * @brief Режим склейки SENSOR_VALUE_CHANGED по ID сенсора (политика COALESCE его полосы).
+     * Если для сенсора уже есть ожидающее значение, новое заменяет его на месте
+     * (одна ячейка на сенсор, без очереди). При перегрузке цикл всегда получает
+     * самое свежее значение, а производители не блокируются и ничего не теряют.
+     * false возвращает полосе политику BLOCK_TIMEOUT.
+     */
+    void setSensorCoalescing(bool enabled);
+    bool isSensorCoalescing() const;
+
     /**
      * @brief Публикует событие в системе. Безопасно для вызова из любого потока/задачи.
      * @param event Структура события.
+     * @return false, если событие потеряно по политике переполнения своей полосы.
      */
     bool postEvent(const Event& event);
 
+    /**
+     * @brief Обрабатывает все ожидающие события в вызывающем потоке.
+     * Если фоновый цикл запущен - эквивалентно waitIdle().
+     * @return Количество доставленных событий.
+     */
+    size_t drain();
+
+    /**
+     * @brief Блокирует вызывающего до тех пор, пока все опубликованные события
+     * (включая порожденные обработчиками) не будут доставлены.
+     * Нельзя вызывать из обработчика событий.
+     */
+    void waitIdle();
+
+    /**
+     * @brief Количество событий, ожидающих доставки.
+     */
+    size_t pendingCount() const;
+
+    // --- Статистика полос приоритета ---
+
+    /**
+     * @brief Сколько раз событие REALTIME было доставлено раньше ожидающих событий BULK.
+     */
+    uint32_t getPreemptionCount() const;
+
+    /**
+     * @brief Количество событий, доставленных из полосы.
+     */
+    uint32_t getLaneDispatchedCount(EventLane lane) const;
+
+    /**
+     * @brief Сколько устаревших значений сенсоров было заменено на месте (режим склейки).
+     */
+    uint32_t getCoalescedCount() const;
+
+    // --- Учет потерь по полосам (см. EventQueue) ---
+    uint32_t getDroppedCount(EventLane lane) const;   // Потеряно новых событий
+    uint32_t getEvictedCount(EventLane lane) const;   // Вытеснено старых (DROP_OLDEST)
+    uint32_t getHighWaterMark(EventLane lane) const;  // Максимальная глубина
+    uint32_t getGapCount(EventLane lane) const;       // "Дыры" в Event::seq у потребителя
+    size_t getLaneCapacity(EventLane lane) const;
+    OverflowPolicy getLanePolicy(EventLane lane) const;
+
+    /**
+     * @brief Обнуляет статистику полос.
+     */
+    void resetStats();
+
+    // --- Гистограммы задержек (мкс) ---
+    // Время ожидания в очереди: от postEvent() до начала доставки.
+    // Время обработчика: длительность handleEvent() каждого подписчика.
+
+    const LatencyHistogram& getQueueWaitHistogram(EventType type) const;
+
+    /**
+     * @param slot Порядковый номер подписчика в текущем наборе (порядок subscribe()).
+     * Гистограмма следует за подпиской при отписке соседей; новая подписка начинает с пустой.
+     */
+    const LatencyHistogram& getHandlerHistogram(EventType type, size_t slot) const;
+
+    /**
+     * @brief Количество подписчиков типа события.
+     */
+    size_t getSubscriberCount(EventType type) const;
+
+    /**
+     * @brief Обнуляет гистограммы задержек (дамп: Logger::dumpLatencyStats()).
+     */
+    void resetLatencyStats();
+
+    /**
+     * @brief Монотонное время (мкс), которым штампуются события.
+     */
+    static uint32_t nowUs();
+
+    /**
+     * @brief Время таймеров (мс). Native: steady_clock или виртуальные часы (setVirtualClock).
+     */
+    uint32_t nowMs() const;
+
+    /**
+     * @brief Запускает таймер: через delayMs (и затем каждые periodMs, если > 0)
+     * цикл диспетчера публикует event. Можно вызывать из любой задачи.
+     * @return ID таймера или INVALID_TIMER_ID, если все TimerWheel::MAX_TIMERS заняты.
+     */
+    TimerId startTimer(uint32_t delayMs, const Event& event, uint32_t periodMs = 0);
+
+    /**
+     * @brief Отменяет таймер. @return false, если он уже сработал или отменен.
+     */
+    bool cancelTimer(TimerId id);
+
+    /**
+     * @brief Переносит срабатывание активного таймера на nowMs() + delayMs.
+     * @return false, если таймер уже не активен (однократный успел сработать).
+     */
+    bool restartTimer(TimerId id, uint32_t delayMs);
+
+    bool isTimerActive(TimerId id) const;
+
+    /**
+     * @brief Публикует события таймеров, срок которых наступил к nowMs().
+     * Вызывается циклом диспетчера; Native в синхронном режиме - тестами/advanceVirtualTime().
+     * @return Количество опубликованных событий.
+     */
+    size_t pollTimers();
+
+    /**
+     * @brief "Бортовой самописец": последние FlightRecorder::CAPACITY доставленных событий.
+     * Включен по умолчанию (стоимость - 4 атомарные записи на событие).
+     */
+    FlightRecorder& getFlightRecorder();
+    const FlightRecorder& getFlightRecorder() const;
+
+    /**
+     * @brief Сохраняет двоичный дамп самописца через IHalStorage::writeFile.
+     * Можно вызывать из любой задачи, пока цикл работает.
+     */
+    bool dumpFlightRecorder(IHalStorage* storage, const std::string& path = FLIGHT_RECORDER_PATH) const;
+
+    #if defined(NATIVE_TEST)
+    /**
+     * @brief Native: запускает циклы диспетчера в отдельных std::thread
+     * (эмуляция задач FreeRTOS для измерения реальной межпоточной задержки).
+     * Потоки привязываются к CPU из DispatchLoopConfig (Linux, номер по модулю числа CPU).
+     */
+    bool startLoopThread();
+
+    /**
+     * @brief Native: останавливает потоки (оставшиеся события доставляются) и
+     * возвращает диспетчер в синхронный режим.
+     */
+    void stopLoopThread();
+
+    /**
+     * @brief Native: переключает таймеры на виртуальные часы (время стоит, пока
+     * его не продвинет advanceVirtualTime()). Сбрасывает все таймеры.
+     */
+    void setVirtualClock(bool enabled);
+
+    /**
+     * @brief Native: продвигает виртуальное время и сразу публикует сработавшие таймеры.
+     */
+    void advanceVirtualTime(uint32_t ms);
+    #endif
+
     // Для тестов
     void reset();
 
 private:
+    using LaneQueue = EventQueue<MAX_QUEUE_CAPACITY>;
+
+    // Битовые маски полос для циклов доставки
+    static constexpr uint8_t ALL_LANES = (1u << EVENT_LANE_COUNT) - 1;
+    static constexpr uint8_t laneBit(EventLane lane) { return (uint8_t)(1u << static_cast<size_t>(lane)); }
+
+    // Состояние одного цикла доставки
+    struct DispatchLoop {
+        EventDispatcher* owner;
+        // Номер набора подписчиков, который цикл читает сейчас (0 - точка покоя).
+        // Native в синхронном режиме доставку выполняет вызывающий поток через m_loops[0].
+        std::atomic<uint32_t> readerGeneration;
+        uint8_t laneMask; // Полосы, которые вычерпывает цикл
+        int core;         // Ядро/CPU или NO_CORE_AFFINITY
+        // true, пока цикл спит (производители будят его только в этом случае)
+        std::atomic<bool> sleeping;
+        // ESP32: TaskHandle_t задачи (void*, чтобы не тянуть FreeRTOS.h в заголовок)
+        void* task;
+        #if defined(ESP32_TARGET)
+        std::atomic<bool> taskActive; // Сбрасывает сама задача перед vTaskDelete
+        #endif
+        #if defined(NATIVE_TEST)
+        std::thread thread;
+        std::atomic<std::thread::id> threadId; // Пишет сам поток цикла
+        std::mutex wakeMutex;
+        std::condition_variable wakeCv;
+        bool wakePending;
+        #endif
+    };
+
     /**
-     * @brief Статический метод-обертка для запуска задачи FreeRTOS.
+     * @brief Статический метод-обертка для запуска задачи FreeRTOS (params - DispatchLoop*).
      */
     static void eventLoopTask(void* params);
-    
+
     /**
-     * @brief Внутренний цикл обработки событий.
+     * @brief Внутренний цикл обработки событий. Таймеры продвигает цикл полосы BULK.
      */
-    void eventLoop();
+    void eventLoop(DispatchLoop& loop);
+
+    /**
+     * @brief Раскладывает полосы по циклам (не потокобезопасно: циклы не работают).
+     */
+    void configureLoops(const DispatchLoopConfig& config);
+
+    #if defined(ESP32_TARGET)
+    /**
+     * @brief Создает задачи всех m_loopCount циклов. Если какая-то не создалась, уже
+     * запущенные останавливаются: либо работают все циклы, либо ни одного.
+     */
+    bool startLoopTasks();
+
+    /**
+     * @brief Останавливает задачи первых count циклов и дожидается их завершения.
+     */
+    void stopLoopTasks(size_t count);
+    #endif
+
+    DispatchLoop& loopFor(EventLane lane) { return m_loops[m_loopCount > 1 ? static_cast<size_t>(lane) : 0]; }
+
+    /**
+     * @brief Рассылает одно событие всем подписчикам текущего снимка.
+     * @param reader Цикл, от имени которого идет доставка (объявляет, какой снимок читает).
+     * @param queueDepth Глубина очереди полосы после извлечения (для самописца).
+     */
+    void dispatch(DispatchLoop& reader, const Event& event, size_t queueDepth);
+
+    /**
+     * @brief Забирает и рассылает все события из полос laneMask (только потребитель полос).
+     * Если в маске обе полосы, перед каждым событием BULK проверяется полоса REALTIME.
+     */
+    size_t dispatchPending(DispatchLoop& reader, uint8_t laneMask);
+    // Синхронный режим / drain(): все полосы от имени m_loops[0]
+    size_t dispatchPending() { return dispatchPending(m_loops[0], ALL_LANES); }
+
+    /**
+     * @brief true, если полосы laneMask (и их ячейки склейки) пусты.
+     */
+    bool lanesEmpty(uint8_t laneMask = ALL_LANES) const;
+
+    /**
+     * @brief Кладет событие в очередь его полосы по ее политике переполнения.
+     * Поддерживает счетчик m_postedCount для waitIdle().
+     */
+    LaneQueue::PushResult pushToLane(const Event& event, size_t typeIndex);
+
+    LaneQueue& laneQueue(EventLane lane) { return m_queues[static_cast<size_t>(lane)]; }
+    const LaneQueue& laneQueue(EventLane lane) const { return m_queues[static_cast<size_t>(lane)]; }
+
+    /**
+     * @brief Возвращает назначение полос к значениям по умолчанию.
+     */
+    void resetLanes();
+    // Емкости/политики по умолчанию, буферы пусты (не потокобезопасно)
+    void resetQueues();
+
+    /**
+     * @brief Будит цикл, если он спит в ожидании событий.
+     */
+    void wakeLoop(DispatchLoop& loop);
+
+    /**
+     * @brief Будит цикл, только если он спит (после публикации в его полосу или смены таймеров).
+     */
+    void wakeIfSleeping(DispatchLoop& loop);
+
+    /**
+     * @brief Усыпляет цикл до следующего wakeLoop() (и ближайшего таймера, если withTimers).
+     */
+    void sleepLoop(DispatchLoop& loop, bool withTimers);
+
+    /**
+     * @brief Оповещает ожидающих в waitIdle().
+     */
+    void notifyIdle();
+
+    // Lock-free очереди событий с политикой переполнения, по одной на полосу
+    LaneQueue m_queues[EVENT_LANE_COUNT];
+
+    // Полоса для каждого EventType
+    EventLane m_laneOf[EVENT_TYPE_COUNT];
+
+    // Статистика полос (пишут циклы доставки)
+    std::atomic<uint32_t> m_preemptionCount;
+    std::atomic<uint32_t> m_laneDispatched[EVENT_LANE_COUNT];
+
+    // Счетчики для waitIdle(): принятые в буфер и доставленные события
+    std::atomic<uint32_t> m_postedCount;
+    std::atomic<uint32_t> m_dispatchedCount;
+
+    // true, пока работают фоновые циклы (задачи FreeRTOS / std::thread)
+    std::atomic<bool> m_loopRunning;
+
+    // Циклы доставки: m_loopCount активных (меняется только в init())
+    DispatchLoop m_loops[MAX_DISPATCH_LOOPS];
+    size_t m_loopCount;
+
+    #if defined(NATIVE_TEST)
+    std::mutex m_idleMutex;
+    std::condition_variable m_idleCv;
+    // Защита от рекурсии в синхронном режиме (обработчик публикует событие)
+    bool m_inlineDispatching;
+    // Виртуальные часы таймеров (детерминированные тесты)
+    std::atomic<bool> m_virtualClock;
+    std::atomic<uint32_t> m_virtualNowMs;
+    #endif
+
+    // Отложенные и периодические события (продвигает цикл полосы BULK)
+    TimerWheel m_timers;
+
+    // --- Подписчики: неизменяемые снимки (copy-on-write) ---
+    // Цикл берет текущий снимок одной атомарной загрузкой, без блокировок. Изменение:
+    // копия в свободный снимок -> правка -> публикация указателя; прежний снимок
+    // освобождается, когда все циклы прошли точку покоя (quiescent-state reclamation).
+    // Снимков: текущий + два ожидающих освобождения + запас для правки.
+    static constexpr size_t SUBSCRIBER_SNAPSHOT_COUNT = 4;
+
+    struct SubscriberSnapshot {
+        SubscriberSet set;
+        // Номер набора, который заменил этот снимок (0 - снимок текущий или свободен)
+        uint32_t retiredAt;
+        bool inUse;
+    };
+
+    /**
+     * @brief Захватывает право записи и свободный снимок с копией текущего набора.
+     * @return nullptr, если из обработчика все снимки еще заняты (право записи не захвачено).
+     */
+    SubscriberSnapshot* beginSubscriberUpdate();
+
+    /**
+     * @brief Публикует next (если publish) и освобождает право записи.
+     * Вне обработчиков дожидается, пока прежний снимок перестанет читаться.
+     */
+    void endSubscriberUpdate(SubscriberSnapshot* next, bool publish);
+
+    /**
+     * @brief Обнуляет гистограммы обработчиков, которые в next закреплены за другой подпиской,
+     * чем в текущем наборе (под правом записи, до публикации next).
+     */
+    void resetReassignedHandlerStats(const SubscriberSet& next);
+
+    /**
+     * @brief Возвращает в пул снимки, которые больше не читает ни один цикл (под правом записи).
+     */
+    void reclaimSubscriberSnapshots();
+    bool isSnapshotReleased(uint32_t retiredAt) const;
+
+    /**
+     * @brief Цикл, из обработчика которого идет вызов (nullptr - вне доставки).
+     */
+    const DispatchLoop* currentReader() const;
+
+    // Право записи подписчиков: короткие критические секции, ожидание циклов - вне их
+    void lockSubscriberWriter() const;
+    void unlockSubscriberWriter() const;
+    // Пауза писателя в ожидании (права записи или точки покоя циклов)
+    static void writerPause();
+
+    /**
+     * @brief Публикует пустой набор подписчиков и снимает заморозку полос.
+     */
+    void clearSubscribers();
+
+    SubscriberSnapshot m_snapshots[SUBSCRIBER_SNAPSHOT_COUNT];
+    std::atomic<SubscriberSnapshot*> m_activeSnapshot;
+    std::atomic<uint32_t> m_subscriberGeneration; // Номер текущего набора (с 1)
+    mutable std::atomic_flag m_subscriberWriter = ATOMIC_FLAG_INIT; // Писатели по одному
+    bool m_subscriptionsFrozen;
+
+    // Гистограммы задержек (пишет цикл, доставляющий тип события)
+    LatencyHistogram m_queueWait[EVENT_TYPE_COUNT];
+    LatencyHistogram m_handlerTime[EVENT_TYPE_COUNT][MAX_HANDLERS_PER_TYPE]; // По statSlots подписки
 
-    QueueHandle_t m_eventQueue;
-    
-    // Карта подписчиков (EventType -> список IEventHandler*)
-    std::map<EventType, std::vector<IEventHandler*>> m_subscribers;
-};
\ No newline at end of file
+    // Последние доставленные события (пишут все циклы)
+    FlightRecorder m_flightRecorder;
+};
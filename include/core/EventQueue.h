@@ -0,0 +1,397 @@
+/*
+ * EventQueue.h
+ *
+ * Очередь событий с политикой переполнения и учетом потерь.
+ * Используется полосами EventDispatcher и внутренней очередью AppLogic.
+ *
+ * - Хранилище: EventRing на MaxCapacity слотов (без кучи); рабочая емкость
+ *   (capacity из settings.cfg) задается в пределах 1..MaxCapacity.
+ * - В кольце лежат упакованные события (PackedEvent, 8 байт + номер очереди).
+ *   События, которые не упаковываются без потерь (SENSOR_FRAME), хранятся целиком
+ *   в пуле из WideCapacity ячеек, а в кольце - ссылка на ячейку (порядок FIFO сохраняется).
+ *   Пул заполнен - событие обрабатывается политикой переполнения, как при полной очереди.
+ * - Политика переполнения: BLOCK_TIMEOUT / DROP_NEWEST / DROP_OLDEST / COALESCE (QueuePolicy.h).
+ * - Каждое событие получает порядковый номер очереди (Event::seq). Номер расходуется
+ *   и потерянными событиями, поэтому потребитель видит "дыры" (getGapCount()).
+ * - Счетчики: потерянные новые, вытесненные старые, склеенные, максимум глубины.
+ *
+ * Емкость - "мягкий" предел: одновременные производители могут превысить ее
+ * на несколько событий (но никогда не превысят MaxCapacity).
+ *
+ * Соответствует: docs/modules/core_event_dispatcher.md
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "events.h"
+#include "PackedEvent.h"
+#include "QueuePolicy.h"
+#include "core/EventRing.h"
+
+#if defined(ESP32_TARGET)
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/task.h"
+#elif defined(NATIVE_TEST)
+    #include <chrono>
+    #include <thread>
+#endif
+
+template <size_t MaxCapacity, size_t WideCapacity = (MaxCapacity >= 64 ? MaxCapacity / 8 : 8)>
+class EventQueue {
+    static_assert(WideCapacity >= 1 && WideCapacity <= 32, "Wide pool is tracked by a 32-bit mask");
+
+public:
+    // Количество ячеек "последнего значения" для политики COALESCE (по ID сенсора)
+    static constexpr int MAX_COALESCED_SENSORS = 16;
+    static constexpr uint32_t DEFAULT_BLOCK_TIMEOUT_MS = 10;
+
+    enum class PushResult : uint8_t {
+        QUEUED,    // Новое ожидающее событие
+        COALESCED, // Заменило недоставленное значение того же сенсора
+        DROPPED    // Потеряно
+    };
+
+    EventQueue() {
+        m_capacity.store(MaxCapacity, std::memory_order_relaxed);
+        m_policy.store(OverflowPolicy::BLOCK_TIMEOUT, std::memory_order_relaxed);
+        m_blockTimeoutMs.store(DEFAULT_BLOCK_TIMEOUT_MS, std::memory_order_relaxed);
+        reset();
+    }
+
+    void configure(const QueueConfig& config) {
+        setCapacity(config.capacity);
+        setPolicy(config.policy);
+    }
+
+    /**
+     * @brief Рабочая емкость (ограничивается диапазоном 1..MaxCapacity).
+     */
+    void setCapacity(int capacity) {
+        if (capacity < 1) capacity = 1;
+        if ((size_t)capacity > MaxCapacity) capacity = (int)MaxCapacity;
+        m_capacity.store((uint32_t)capacity, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const {
+        return m_capacity.load(std::memory_order_relaxed);
+    }
+
+    void setPolicy(OverflowPolicy policy) {
+        m_policy.store(policy, std::memory_order_relaxed);
+    }
+
+    OverflowPolicy policy() const {
+        return m_policy.load(std::memory_order_relaxed);
+    }
+
+    void setBlockTimeoutMs(uint32_t timeoutMs) {
+        m_blockTimeoutMs.store(timeoutMs, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Очищает очередь, нумерацию и статистику (настройки сохраняются).
+     * НЕ потокобезопасно: вызывать, когда нет ни производителей, ни потребителя.
+     */
+    void reset() {
+        m_ring.reset();
+        for (int i = 0; i < MAX_COALESCED_SENSORS; ++i) {
+            m_latestValue[i].store(COALESCE_EMPTY, std::memory_order_relaxed);
+            m_latestPostUs[i].store(0, std::memory_order_relaxed);
+            m_latestSeq[i].store(0, std::memory_order_relaxed);
+        }
+        m_coalescePending.store(0, std::memory_order_relaxed);
+        m_coalesceScan = 0;
+        m_wideBusy.store(0, std::memory_order_relaxed);
+        m_nextSeq.store(1, std::memory_order_relaxed);
+        m_lastSeq = 0;
+        resetStats();
+    }
+
+    /**
+     * @brief Кладет событие по политике очереди. Безопасно для нескольких производителей.
+     * @param mayBlock false - не ждать даже при BLOCK_TIMEOUT (ждать некого).
+     * @param evicted Сюда прибавляется количество вытесненных старых событий (DROP_OLDEST).
+     */
+    PushResult push(const Event& event, bool mayBlock, uint32_t* evicted = nullptr) {
+        Event item = event;
+        item.seq = m_nextSeq.fetch_add(1, std::memory_order_relaxed);
+        const OverflowPolicy policy = m_policy.load(std::memory_order_relaxed);
+
+        if (policy == OverflowPolicy::COALESCE && isCoalescable(item)) {
+            return storeLatest(item);
+        }
+
+        if (tryPushLimited(item)) {
+            return PushResult::QUEUED;
+        }
+
+        if (policy == OverflowPolicy::DROP_OLDEST) {
+            // Вытесняем самое старое событие (обычно хватает одного)
+            for (size_t attempt = 0; attempt < MaxCapacity; ++attempt) {
+                if (evictOldest()) {
+                    m_evictedCount.fetch_add(1, std::memory_order_relaxed);
+                    if (evicted) ++(*evicted);
+                }
+                if (tryPushLimited(item)) {
+                    return PushResult::QUEUED;
+                }
+            }
+        } else if (policy == OverflowPolicy::BLOCK_TIMEOUT && mayBlock) {
+            // Даем потребителю время на разгрузку (как xQueueSend(..., timeout))
+            uint32_t ticks = timeoutTicks(m_blockTimeoutMs.load(std::memory_order_relaxed));
+            for (uint32_t tick = 0; tick < ticks; ++tick) {
+                waitOneTick();
+                if (tryPushLimited(item)) {
+                    return PushResult::QUEUED;
+                }
+            }
+        }
+
+        m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return PushResult::DROPPED;
+    }
+
+    /**
+     * @brief Забирает следующее событие (сначала FIFO, затем ячейки склейки).
+     * Вызывать только из потока-потребителя.
+     */
+    bool pop(Event& event) {
+        Slot slot;
+        if (m_ring.tryPop(slot)) {
+            if (slot.event.isWide()) {
+                takeWide(slot.event.id, event);
+            } else {
+                event = slot.event.unpack();
+            }
+            event.seq = slot.seq;
+        } else if (!popLatest(event)) {
+            return false;
+        }
+        noteSequence(event.seq);
+        return true;
+    }
+
+    /**
+     * @brief true, если ожидающих событий нет (вызывать из потока-потребителя).
+     */
+    bool empty() const {
+        return m_ring.empty() && m_coalesceScan == 0 &&
+               m_coalescePending.load(std::memory_order_acquire) == 0;
+    }
+
+    /**
+     * @brief Количество ожидающих событий (приблизительно при конкурентном доступе).
+     */
+    size_t size() const {
+        size_t coalesced = 0;
+        for (int i = 0; i < MAX_COALESCED_SENSORS; ++i) {
+            if (m_latestValue[i].load(std::memory_order_relaxed) != COALESCE_EMPTY) ++coalesced;
+        }
+        return m_ring.size() + coalesced;
+    }
+
+    /**
+     * @brief Глубина FIFO без ячеек склейки (дешево: две атомарные загрузки).
+     */
+    size_t fifoSize() const {
+        return m_ring.size();
+    }
+
+    // --- Статистика ---
+    uint32_t getDroppedCount() const { return m_droppedCount.load(std::memory_order_relaxed); }
+    uint32_t getEvictedCount() const { return m_evictedCount.load(std::memory_order_relaxed); }
+    uint32_t getCoalescedCount() const { return m_coalescedCount.load(std::memory_order_relaxed); }
+    // Максимальная глубина FIFO с момента resetStats()
+    uint32_t getHighWaterMark() const { return m_highWater.load(std::memory_order_relaxed); }
+    // Номера, которые потребитель так и не увидел (потерянные, вытесненные и склеенные)
+    uint32_t getGapCount() const { return m_gapCount.load(std::memory_order_relaxed); }
+    // Сколько ячеек пула занято неупакованными событиями
+    size_t wideInUse() const { return (size_t)__builtin_popcount(m_wideBusy.load(std::memory_order_relaxed)); }
+
+    void resetStats() {
+        m_droppedCount.store(0, std::memory_order_relaxed);
+        m_evictedCount.store(0, std::memory_order_relaxed);
+        m_coalescedCount.store(0, std::memory_order_relaxed);
+        m_highWater.store(0, std::memory_order_relaxed);
+        m_gapCount.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr int32_t COALESCE_EMPTY = INT32_MIN;
+
+    static bool isCoalescable(const Event& event) {
+        return event.type == EventType::SENSOR_VALUE_CHANGED &&
+               event.payload.sensorValue.id >= 0 && event.payload.sensorValue.id < MAX_COALESCED_SENSORS &&
+               event.payload.sensorValue.value != COALESCE_EMPTY;
+    }
+
+    // Элемент кольца: 8 байт события + номер очереди
+    struct Slot {
+        PackedEvent event;
+        uint32_t seq;
+    };
+
+    bool tryPushLimited(const Event& item) {
+        if (m_ring.size() >= m_capacity.load(std::memory_order_relaxed)) return false;
+
+        Slot slot;
+        slot.seq = item.seq;
+        int wideIndex = -1;
+        if (!PackedEvent::pack(item, slot.event)) {
+            wideIndex = allocWide();
+            if (wideIndex < 0) return false;
+            // Ячейка публикуется потребителю вместе со слотом кольца (release в tryPush)
+            std::memcpy(m_wide[wideIndex], &item, sizeof(Event));
+            slot.event = PackedEvent::wide(item, (uint8_t)wideIndex);
+        }
+        if (!m_ring.tryPush(slot)) {
+            if (wideIndex >= 0) freeWide((uint8_t)wideIndex);
+            return false;
+        }
+
+        uint32_t depth = (uint32_t)m_ring.size();
+        uint32_t highWater = m_highWater.load(std::memory_order_relaxed);
+        while (depth > highWater &&
+               !m_highWater.compare_exchange_weak(highWater, depth, std::memory_order_relaxed)) {
+        }
+        return true;
+    }
+
+    PushResult storeLatest(const Event& item) {
+        int id = item.payload.sensorValue.id;
+        // Время и номер пишутся до значения (при гонке двух производителей пара приблизительна)
+        m_latestPostUs[id].store(item.postTimeUs, std::memory_order_relaxed);
+        m_latestSeq[id].store(item.seq, std::memory_order_relaxed);
+        int32_t previous = m_latestValue[id].exchange(item.payload.sensorValue.value, std::memory_order_acq_rel);
+        if (previous != COALESCE_EMPTY) {
+            // Старое значение еще не доставлено - оно просто перезаписано
+            m_coalescedCount.fetch_add(1, std::memory_order_relaxed);
+            return PushResult::COALESCED;
+        }
+        m_coalescePending.fetch_or(1u << id, std::memory_order_release);
+        return PushResult::QUEUED;
+    }
+
+    bool evictOldest() {
+        Slot victim;
+        if (!m_ring.tryPop(victim)) return false;
+        if (victim.event.isWide()) {
+            freeWide(victim.event.id);
+        }
+        return true;
+    }
+
+    // --- Пул неупакованных событий (несколько производителей, освобождают читатели) ---
+
+    int allocWide() {
+        uint32_t busy = m_wideBusy.load(std::memory_order_relaxed);
+        for (;;) {
+            uint32_t freeBits = ~busy & WIDE_MASK;
+            if (freeBits == 0) return -1;
+            int index = __builtin_ctz(freeBits);
+            // acquire: предыдущий читатель ячейки закончил копирование (release в freeWide)
+            if (m_wideBusy.compare_exchange_weak(busy, busy | (1u << index),
+                                                 std::memory_order_acquire, std::memory_order_relaxed)) {
+                return index;
+            }
+        }
+    }
+
+    void freeWide(uint8_t index) {
+        m_wideBusy.fetch_and(~(1u << index), std::memory_order_release);
+    }
+
+    void takeWide(uint8_t index, Event& event) {
+        std::memcpy(static_cast<void*>(&event), m_wide[index], sizeof(Event));
+        freeWide(index);
+    }
+
+    bool popLatest(Event& event) {
+        for (;;) {
+            if (m_coalesceScan == 0) {
+                m_coalesceScan = m_coalescePending.exchange(0, std::memory_order_acq_rel);
+                if (m_coalesceScan == 0) return false;
+            }
+
+            // Берем сенсор с наименьшим ID из взятой маски
+            int id = 0;
+            while (!(m_coalesceScan & (1u << id))) ++id;
+            m_coalesceScan &= ~(1u << id);
+
+            int32_t value = m_latestValue[id].exchange(COALESCE_EMPTY, std::memory_order_acq_rel);
+            if (value == COALESCE_EMPTY) continue;
+
+            event = Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{id, (int)value});
+            event.postTimeUs = m_latestPostUs[id].load(std::memory_order_relaxed);
+            event.seq = m_latestSeq[id].load(std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    /**
+     * @brief Учет "дыр" в нумерации. Номер больше ожидаемого открывает дыры,
+     * запоздавший номер (гонка производителей) закрывает одну из них.
+     */
+    void noteSequence(uint32_t seq) {
+        int32_t diff = (int32_t)(seq - m_lastSeq);
+        uint32_t gaps = m_gapCount.load(std::memory_order_relaxed);
+        if (diff > 0) {
+            m_gapCount.store(gaps + (uint32_t)(diff - 1), std::memory_order_relaxed);
+            m_lastSeq = seq;
+        } else if (gaps > 0) {
+            m_gapCount.store(gaps - 1, std::memory_order_relaxed);
+        }
+    }
+
+    static uint32_t timeoutTicks(uint32_t timeoutMs) {
+        #if defined(ESP32_TARGET)
+            uint32_t ticks = pdMS_TO_TICKS(timeoutMs);
+            return (ticks == 0 && timeoutMs > 0) ? 1 : ticks;
+        #else
+            return timeoutMs; // Native: тик = 1 мс
+        #endif
+    }
+
+    static void waitOneTick() {
+        #if defined(ESP32_TARGET)
+            vTaskDelay(1);
+        #elif defined(NATIVE_TEST)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        #endif
+    }
+
+    static constexpr uint32_t WIDE_MASK = WideCapacity >= 32 ? 0xFFFFFFFFu : ((1u << WideCapacity) - 1);
+
+    EventRing<Slot, MaxCapacity> m_ring;
+
+    // Пул целых событий (SENSOR_FRAME и значения вне диапазонов PackedEvent).
+    // Сырые байты: Event не имеет конструктора по умолчанию (как в EventRing)
+    alignas(Event) unsigned char m_wide[WideCapacity][sizeof(Event)];
+    std::atomic<uint32_t> m_wideBusy; // Бит = ячейка занята
+
+    // Настройки (можно менять на лету)
+    std::atomic<uint32_t> m_capacity;
+    std::atomic<OverflowPolicy> m_policy;
+    std::atomic<uint32_t> m_blockTimeoutMs;
+
+    // Ячейки склейки SENSOR_VALUE_CHANGED: значение или COALESCE_EMPTY
+    std::atomic<int32_t> m_latestValue[MAX_COALESCED_SENSORS];
+    std::atomic<uint32_t> m_latestPostUs[MAX_COALESCED_SENSORS];
+    std::atomic<uint32_t> m_latestSeq[MAX_COALESCED_SENSORS];
+    std::atomic<uint32_t> m_coalescePending; // Битовая маска непустых ячеек
+    uint32_t m_coalesceScan;                 // Маска, взятая потребителем в обработку
+
+    // Нумерация: m_nextSeq - производители, m_lastSeq - потребитель
+    std::atomic<uint32_t> m_nextSeq;
+    uint32_t m_lastSeq;
+
+    // Статистика
+    std::atomic<uint32_t> m_droppedCount;
+    std::atomic<uint32_t> m_evictedCount;
+    std::atomic<uint32_t> m_coalescedCount;
+    std::atomic<uint32_t> m_highWater;
+    std::atomic<uint32_t> m_gapCount;
+};
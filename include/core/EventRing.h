@@ -0,0 +1,140 @@
+/*
+ * EventRing.h
+ *
+ * Lock-free кольцевой буфер фиксированной емкости для EventDispatcher.
+ *
+ * Алгоритм: ограниченная очередь Д. Вьюкова с порядковым номером в каждом слоте.
+ * - Производители (любые задачи/потоки) резервируют слот через CAS по m_head.
+ * - Читатели забирают элементы через CAS по m_tail. Обычно читатель один (цикл
+ *   диспетчера), но производитель тоже может забрать самый старый элемент
+ *   (политика DROP_OLDEST), поэтому pop безопасен для нескольких потоков.
+ * Ни одной блокировки и ни одного вызова ядра на пути push/pop.
+ *
+ * Соответствует: docs/modules/core_event_dispatcher.md
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+template <typename T, size_t Capacity>
+class EventRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "EventRing copies items as raw bytes (like a FreeRTOS queue)");
+
+public:
+    EventRing() {
+        reset();
+    }
+
+    /**
+     * @brief Очищает буфер. НЕ потокобезопасно: вызывать только когда нет ни
+     * производителей, ни потребителя.
+     */
+    void reset() {
+        for (size_t i = 0; i < Capacity; ++i) {
+            m_slots[i].seq.store((uint32_t)i, std::memory_order_relaxed);
+        }
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Кладет элемент в буфер. Безопасно для вызова из нескольких потоков.
+     * @return false, если буфер полон.
+     */
+    bool tryPush(const T& item) {
+        uint32_t pos = m_head.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &m_slots[pos & MASK];
+            uint32_t seq = slot->seq.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(seq - pos);
+            if (diff == 0) {
+                // Слот свободен -> пытаемся его зарезервировать
+                if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // Потребитель еще не освободил слот -> буфер полон
+                return false;
+            } else {
+                // Другой производитель успел раньше -> перечитываем голову
+                pos = m_head.load(std::memory_order_relaxed);
+            }
+        }
+
+        std::memcpy(&slot->data, &item, sizeof(T));
+        // Публикуем данные для потребителя
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Забирает самый старый элемент. Безопасно для вызова из нескольких потоков.
+     * @return false, если буфер пуст.
+     */
+    bool tryPop(T& item) {
+        uint32_t pos = m_tail.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &m_slots[pos & MASK];
+            uint32_t seq = slot->seq.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(seq - (pos + 1));
+            if (diff == 0) {
+                // Элемент опубликован -> пытаемся его забрать
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // Производитель еще не записал этот слот -> буфер пуст
+                return false;
+            } else {
+                // Другой читатель успел раньше -> перечитываем хвост
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        std::memcpy(static_cast<void*>(&item), &slot->data, sizeof(T));
+        // Освобождаем слот для следующего "круга" производителей
+        slot->seq.store(pos + (uint32_t)Capacity, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Приблизительное количество элементов (точное, если нет конкурентных push/pop).
+     */
+    size_t size() const {
+        // Сначала хвост: голова не бывает меньше уже прочитанного хвоста
+        uint32_t tail = m_tail.load(std::memory_order_acquire);
+        uint32_t head = m_head.load(std::memory_order_acquire);
+        return (size_t)(head - tail);
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    static constexpr size_t capacity() {
+        return Capacity;
+    }
+
+private:
+    static constexpr uint32_t MASK = (uint32_t)Capacity - 1;
+
+    struct Slot {
+        std::atomic<uint32_t> seq;
+        // Сырые байты вместо T: Event не имеет конструктора по умолчанию
+        alignas(T) unsigned char data[sizeof(T)];
+    };
+
+    Slot m_slots[Capacity];
+
+    // Разносим голову и хвост по разным строкам кэша, чтобы
+    // производители и потребитель не "толкались" на одной строке.
+    alignas(64) std::atomic<uint32_t> m_head;  // Пишут производители
+    alignas(64) std::atomic<uint32_t> m_tail;  // Пишут читатели
+};
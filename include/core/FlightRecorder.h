@@ -0,0 +1,183 @@
+/*
+ * FlightRecorder.h
+ *
+ * "Бортовой самописец" диспетчера: последние CAPACITY доставленных событий
+ * (тип, данные, время публикации, ожидание в очереди, глубина очереди).
+ *
+ * - Без кучи и без блокировок: пишут циклы диспетчера (один или два, см. dual_core_dispatch),
+ *   номер записи резервируется атомарным инкрементом, слот - 4 слова данных и номер версии
+ *   (seqlock), поэтому самописец остается включенным и в production-сборке.
+ * - Снимок (snapshot/serialize/dump) можно делать из любой задачи: записи, которые
+ *   цикл успел перезаписать (или еще не дописал) во время копирования, отбрасываются.
+ * - Дамп - компактный двоичный формат (little-endian) через IHalStorage::writeFile:
+ *     заголовок (16 байт): "EVFR", версия (u8), размер записи (u8), количество записей (u16),
+ *                          всего записано с момента reset (u32), время дампа, мкс (u32);
+ *     запись (16 байт, от старой к новой): время публикации, мкс (u32), EventType (u8),
+ *                          глубина очереди (u8), ожидание в очереди, мкс (u16, насыщается),
+ *                          данные A (i32), данные B (i32).
+ *   Декодер: FlightRecorder::decode() (Native) или tools/decode_flight_recorder.py.
+ *
+ * Соответствует: docs/modules/core_event_dispatcher.md
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "events.h"
+
+class IHalStorage;
+
+/**
+ * @brief Одна запись самописца (распакованная).
+ * Данные A/B: SENSOR_VALUE_CHANGED - id/value; SENSOR_FRAME - timestampMs/count;
+ * SENSOR_MASK_CHANGED - mask; HALF_HOLE_DETECTED - id; VIBRATO_DETECTED - id/биты float depth;
+ * NOTE_PITCH_SELECTED - pitch; события без данных - 0/0.
+ */
+struct FlightRecord {
+    uint32_t postTimeUs;
+    uint16_t waitUs;
+    EventType type;
+    uint8_t queueDepth;
+    int32_t a;
+    int32_t b;
+};
+
+class FlightRecorder {
+public:
+    // Слотов - степень двойки (2.5 КБ); один слот всегда может переписываться циклом,
+    // поэтому снимок содержит не больше SLOT_COUNT - 1 событий
+    static constexpr size_t SLOT_COUNT = 128;
+    static constexpr size_t CAPACITY = SLOT_COUNT - 1;
+    static constexpr uint8_t FORMAT_VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr size_t RECORD_SIZE = 16;
+
+    FlightRecorder() : m_enabled(true) {
+        reset();
+    }
+
+    /**
+     * @brief Записывает доставляемое событие (циклы диспетчера; безопасно для нескольких писателей).
+     * @param dispatchUs Время начала доставки (мкс).
+     * @param queueDepth Глубина очереди полосы после извлечения события.
+     */
+    void record(const Event& event, uint32_t dispatchUs, size_t queueDepth) {
+        if (!m_enabled.load(std::memory_order_relaxed)) return;
+
+        int32_t a = 0;
+        int32_t b = 0;
+        switch (event.type) {
+            case EventType::SENSOR_VALUE_CHANGED:
+                a = event.payload.sensorValue.id;
+                b = event.payload.sensorValue.value;
+                break;
+            case EventType::SENSOR_FRAME:
+                a = (int32_t)event.payload.sensorFrame.timestampMs;
+                b = event.payload.sensorFrame.count;
+                break;
+            case EventType::SENSOR_MASK_CHANGED:
+                a = (int32_t)event.payload.sensorMask.mask;
+                break;
+            case EventType::HALF_HOLE_DETECTED:
+                a = event.payload.halfHole.id;
+                break;
+            case EventType::VIBRATO_DETECTED:
+                a = event.payload.vibrato.id;
+                std::memcpy(&b, &event.payload.vibrato.depth, sizeof(b));
+                break;
+            case EventType::NOTE_PITCH_SELECTED:
+                a = event.payload.notePitch.pitch;
+                break;
+            default:
+                break;
+        }
+
+        uint32_t wait = dispatchUs - event.postTimeUs;
+        if (wait > 0xFFFF) wait = 0xFFFF;
+        uint32_t depth = queueDepth > 0xFF ? 0xFF : (uint32_t)queueDepth;
+
+        uint32_t n = m_head.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = m_slots[n % SLOT_COUNT];
+        // Версия слота: нечетная - запись идет, 2(n + 1) - в слоте запись номер n
+        slot.version.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.words[0].store(event.postTimeUs, std::memory_order_relaxed);
+        slot.words[1].store((uint32_t)event.type | (depth << 8) | (wait << 16), std::memory_order_relaxed);
+        slot.words[2].store((uint32_t)a, std::memory_order_relaxed);
+        slot.words[3].store((uint32_t)b, std::memory_order_relaxed);
+        slot.version.store(2 * n + 2, std::memory_order_release);
+    }
+
+    void setEnabled(bool enabled) {
+        m_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool isEnabled() const {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Очищает самописец. НЕ потокобезопасно (цикл диспетчера не должен работать).
+     */
+    void reset() {
+        for (size_t i = 0; i < SLOT_COUNT; ++i) {
+            for (size_t w = 0; w < WORDS_PER_SLOT; ++w) {
+                m_slots[i].words[w].store(0, std::memory_order_relaxed);
+            }
+            m_slots[i].version.store(0, std::memory_order_relaxed);
+        }
+        m_head.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Сколько событий записано с момента reset() (включая перезаписанные).
+     */
+    uint32_t totalRecorded() const {
+        return m_head.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Копирует целые записи (от старой к новой) в out.
+     * @return Количество скопированных записей (не больше CAPACITY).
+     */
+    size_t snapshot(std::vector<FlightRecord>& out) const;
+
+    /**
+     * @brief Двоичный дамп (формат - в заголовке файла).
+     */
+    std::string serialize(uint32_t nowUs) const;
+
+    /**
+     * @brief Записывает дамп в файл через IHalStorage::writeFile.
+     */
+    bool dump(IHalStorage* storage, const std::string& path, uint32_t nowUs) const;
+
+    /**
+     * @brief Разбирает двоичный дамп (декодер для хоста/тестов).
+     * @return false, если заголовок или размер не совпадают с форматом.
+     */
+    static bool decode(const std::string& blob, std::vector<FlightRecord>& out,
+                       uint32_t* totalRecorded = nullptr, uint32_t* dumpTimeUs = nullptr);
+
+    /**
+     * @brief Текстовое представление записи, напр. "t=1200us wait=35us depth=2 NOTE_PITCH_SELECTED 62 0".
+     */
+    static std::string format(const FlightRecord& record);
+
+private:
+    static constexpr size_t WORDS_PER_SLOT = 4;
+
+    // Атомарные слова: чтение снимка параллельно с записью не является гонкой данных
+    struct Slot {
+        std::atomic<uint32_t> words[WORDS_PER_SLOT];
+        std::atomic<uint32_t> version;
+    };
+
+    Slot m_slots[SLOT_COUNT];
+    std::atomic<uint32_t> m_head; // Номер следующей резервируемой записи (монотонный)
+    std::atomic<bool> m_enabled;
+};
@@ -0,0 +1,43 @@
+/*
+ * IdleMonitor.h
+ *
+ * Таймаут бездействия на колесе таймеров диспетчера: однократный таймер
+ * SYSTEM_IDLE_TIMEOUT перезапускается каждым событием активности
+ * (отдельная задача, опрашивающая время, не нужна).
+ *
+ * Соответствует: docs/modules/hal_power.md, docs/modules/core_event_dispatcher.md
+ */
+#pragma once
+
+#include <cstdint>
+#include "core/EventDispatcher.h"
+#include "interfaces/IEventHandler.h"
+
+class IdleMonitor : public IEventHandler {
+public:
+    IdleMonitor();
+
+    /**
+     * @brief Взводит таймер SYSTEM_IDLE_TIMEOUT.
+     * @param timeoutMs Таймаут бездействия (0 - автовыключение отключено).
+     */
+    bool init(EventDispatcher* dispatcher, uint32_t timeoutMs);
+
+    /**
+     * @brief Подписывает монитор на события активности (маска, полузакрытие,
+     * вибрато, mute, нота, подключение BLE).
+     */
+    void subscribe(EventDispatcher* dispatcher);
+
+    /**
+     * @brief Любое событие активности переносит таймаут на timeoutMs вперед.
+     */
+    virtual void handleEvent(const Event& event) override;
+
+    TimerId getTimerId() const { return m_timer; }
+
+private:
+    EventDispatcher* m_dispatcher;
+    uint32_t m_timeoutMs;
+    TimerId m_timer;
+};
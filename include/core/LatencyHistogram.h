@@ -0,0 +1,79 @@
+/*
+ * LatencyHistogram.h
+ *
+ * Гистограмма задержек с фиксированными логарифмическими корзинами (мкс).
+ * Корзина 0: < 1 мкс; корзина i (1..BUCKET_COUNT-2): [2^(i-1), 2^i) мкс;
+ * последняя корзина: >= 2^(BUCKET_COUNT-2) мкс.
+ *
+ * Без кучи и без блокировок: пишет один поток (цикл диспетчера),
+ * читать (дамп через Logger) можно из любого.
+ *
+ * Соответствует: docs/modules/core_event_dispatcher.md
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class LatencyHistogram {
+public:
+    static constexpr size_t BUCKET_COUNT = 16;
+
+    LatencyHistogram() {
+        reset();
+    }
+
+    /**
+     * @brief Учитывает одно измерение.
+     */
+    void record(uint32_t us) {
+        m_buckets[bucketFor(us)].fetch_add(1, std::memory_order_relaxed);
+        if (us > m_maxUs.load(std::memory_order_relaxed)) {
+            m_maxUs.store(us, std::memory_order_relaxed);
+        }
+    }
+
+    void reset() {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            m_buckets[i].store(0, std::memory_order_relaxed);
+        }
+        m_maxUs.store(0, std::memory_order_relaxed);
+    }
+
+    uint32_t bucketCount(size_t bucket) const {
+        return bucket < BUCKET_COUNT ? m_buckets[bucket].load(std::memory_order_relaxed) : 0;
+    }
+
+    uint32_t totalCount() const {
+        uint32_t total = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            total += m_buckets[i].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    uint32_t maxUs() const {
+        return m_maxUs.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Номер корзины для значения (мкс).
+     */
+    static size_t bucketFor(uint32_t us) {
+        if (us == 0) return 0;
+        size_t bucket = 32 - (size_t)__builtin_clz(us); // 1 -> 1, 2..3 -> 2, 4..7 -> 3 ...
+        return bucket < BUCKET_COUNT ? bucket : BUCKET_COUNT - 1;
+    }
+
+    /**
+     * @brief Верхняя граница корзины (мкс, не включительно). Для последней корзины - 0 (без границы).
+     */
+    static uint32_t bucketUpperUs(size_t bucket) {
+        return bucket + 1 < BUCKET_COUNT ? (1u << bucket) : 0;
+    }
+
+private:
+    std::atomic<uint32_t> m_buckets[BUCKET_COUNT];
+    std::atomic<uint32_t> m_maxUs;
+};
@@ -14,6 +14,8 @@
 // Forward-declare FreeRTOS типы
 typedef void* SemaphoreHandle_t;
 
+class EventDispatcher;
+
 class Logger {
 public:
     /**
@@ -31,7 +33,25 @@ public:
      */
     void log(LogLevel level, const char* tag, const char* format, ...);
 
+    /**
+     * @brief Выводит непустые гистограммы задержек диспетчера (ожидание в очереди
+     * и время каждого обработчика по EventType). Печатается независимо от log_level.
+     * @param resetAfter Обнулить гистограммы после вывода.
+     */
+    void dumpLatencyStats(EventDispatcher& dispatcher, bool resetAfter = false);
+
+    /**
+     * @brief Выводит записи "бортового самописца" диспетчера (от старой к новой).
+     * Печатается независимо от log_level.
+     */
+    void dumpFlightRecorder(const EventDispatcher& dispatcher);
+
 private:
+    /**
+     * @brief Форматирует "TIMESTAMP - TAG - LEVEL - MESSAGE" и отправляет в HAL (под мьютексом).
+     */
+    void writeLine(LogLevel level, const char* tag, const char* message);
+
     Logger(); // Приватный конструктор
     ~Logger(); // Приватный деструктор
 
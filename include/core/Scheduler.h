@@ -23,9 +23,11 @@
 #include "core/ConfigManager.h"
 #include "core/EventDispatcher.h"
 #include "core/Logger.h"
+#include "core/IdleMonitor.h"
 #include "app/AppFingering.h"
 #include "app/AppLogic.h"
 #include "app/AppMidi.h"
+#include "app/AppPipeline.h"
 
 
 class Application {
@@ -55,6 +57,12 @@ public:
         IHalPower* power
     );
 
+    /**
+     * @brief Сохраняет "бортовой самописец" диспетчера в EventDispatcher::FLIGHT_RECORDER_PATH.
+     * Вызывается по запросу; на ESP32 - также при программной перезагрузке (esp_restart).
+     */
+    bool dumpFlightRecorder();
+
 private:
     // --- CORE (Конкретные классы) ---
     // (ConfigManager, EventDispatcher и Logger - это синглтоны
@@ -63,9 +71,18 @@ private:
     
     ConfigManager m_configManager;
     EventDispatcher m_eventDispatcher;
+
+    // Таймаут бездействия (таймер SYSTEM_IDLE_TIMEOUT на колесе диспетчера)
+    IdleMonitor m_idleMonitor;
+
+    // Хранилище для дампов самописца (задается в init)
+    IHalStorage* m_storage;
     
     // --- APP (Конкретные классы) ---
     AppLogic m_appLogic;
     AppFingering m_appFingering;
     AppMidi m_appMidi;
+
+    // Типизированная шина fused_pipeline (logic -> fingering -> midi)
+    AppPipelineBus m_pipelineBus;
 };
\ No newline at end of file
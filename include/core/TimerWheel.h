@@ -0,0 +1,132 @@
+/*
+ * TimerWheel.h
+ *
+ * Иерархическое колесо таймеров (тик = 1 мс) для отложенных и периодических событий.
+ * Принадлежит EventDispatcher и продвигается его циклом; по срабатыванию таймер
+ * публикует заранее заданный Event.
+ *
+ * - 4 уровня по 64 слота: уровень L покрывает задержки [64^L, 64^(L+1)) мс,
+ *   всего ~4.6 ч (более длинные задержки перекладываются по мере приближения).
+ * - Фиксированный пул MAX_TIMERS таймеров, интрузивные списки - без кучи.
+ *   start/cancel/restart - O(1); тик - O(таймеров в слоте) плюс каскад на границах уровней.
+ * - Если до ближайшего срабатывания далеко, advance() перескакивает время целиком
+ *   (цикл не "тикает" впустую, пока спит).
+ * - Потокобезопасно: управлять таймерами можно из любой задачи (короткая критическая секция).
+ *
+ * Время (nowMs) передает владелец: ESP32 - esp_timer, Native - steady_clock или виртуальные часы.
+ *
+ * Соответствует: docs/modules/core_event_dispatcher.md
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "events.h"
+
+#if defined(ESP32_TARGET)
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/task.h"
+#elif defined(NATIVE_TEST)
+    #include <mutex>
+#endif
+
+// Идентификатор таймера (0 - нет таймера). Устаревший ID после cancel/срабатывания игнорируется.
+typedef uint32_t TimerId;
+constexpr TimerId INVALID_TIMER_ID = 0;
+
+class TimerWheel {
+public:
+    static constexpr size_t MAX_TIMERS = 16;
+    static constexpr size_t LEVEL_COUNT = 4;
+    static constexpr size_t SLOT_BITS = 6;
+    static constexpr size_t SLOT_COUNT = 1u << SLOT_BITS; // 64
+
+    // Событие сработавшего таймера (буфер для advance())
+    struct Fired {
+        Event event;
+        Fired() : event(EventType::SYSTEM_IDLE_TIMEOUT) {}
+    };
+
+    TimerWheel();
+
+    /**
+     * @brief Удаляет все таймеры и устанавливает текущее время колеса.
+     * НЕ потокобезопасно относительно advance().
+     */
+    void reset(uint32_t nowMs);
+
+    /**
+     * @brief Запускает таймер.
+     * @param nowMs Текущее время (мс).
+     * @param delayMs Задержка до первого срабатывания (0 трактуется как 1 мс).
+     * @param event Событие, которое будет опубликовано.
+     * @param periodMs 0 - однократный, иначе период повторения.
+     * @return ID таймера или INVALID_TIMER_ID, если пул исчерпан.
+     */
+    TimerId start(uint32_t nowMs, uint32_t delayMs, const Event& event, uint32_t periodMs = 0);
+
+    /**
+     * @brief Отменяет таймер. @return false, если таймер уже сработал (однократный) или отменен.
+     */
+    bool cancel(TimerId id);
+
+    /**
+     * @brief Переносит срабатывание активного таймера на nowMs + delayMs (период сохраняется).
+     */
+    bool restart(TimerId id, uint32_t nowMs, uint32_t delayMs);
+
+    bool isActive(TimerId id) const;
+    size_t activeCount() const;
+
+    /**
+     * @brief Время ближайшего срабатывания (мс). @return false, если активных таймеров нет.
+     */
+    bool nextExpiry(uint32_t& expiryMs) const;
+
+    /**
+     * @brief Продвигает колесо к nowMs до первого тика, в котором что-то сработало,
+     * и копирует события сработавших таймеров в out. Вызывать, пока возвращает > 0.
+     * @return Количество событий в out (не больше MAX_TIMERS).
+     */
+    size_t advance(uint32_t nowMs, Fired (&out)[MAX_TIMERS]);
+
+private:
+    static constexpr uint8_t NIL = 0xFF;          // Нет таймера
+    static constexpr uint16_t NO_BUCKET = 0xFFFF; // Таймер не в колесе
+
+    struct Timer {
+        Event event;
+        uint32_t expiry;
+        uint32_t period;
+        TimerId id;      // INVALID_TIMER_ID - слот пула свободен
+        uint8_t next;
+        uint8_t prev;
+        uint16_t bucket; // Индекс списка (уровень * SLOT_COUNT + слот) или NO_BUCKET
+
+        Timer() : event(EventType::SYSTEM_IDLE_TIMEOUT), expiry(0), period(0),
+                  id(INVALID_TIMER_ID), next(NIL), prev(NIL), bucket(NO_BUCKET) {}
+    };
+
+    // --- Все методы ниже вызываются под блокировкой ---
+    void place(uint8_t index);
+    void unlink(uint8_t index);
+    void cascade(size_t level);
+    size_t tick(Fired (&out)[MAX_TIMERS]);
+    void jumpTo(uint32_t nowMs);
+    bool nextExpiryLocked(uint32_t& expiryMs) const;
+    int findIndex(TimerId id) const;
+
+    void lock() const;
+    void unlock() const;
+
+    Timer m_timers[MAX_TIMERS];
+    uint8_t m_buckets[LEVEL_COUNT * SLOT_COUNT]; // Голова списка или NIL
+    uint32_t m_now;        // Время, до которого колесо обработано
+    uint32_t m_generation; // Для уникальности ID
+
+    #if defined(ESP32_TARGET)
+        mutable portMUX_TYPE m_mux;
+    #elif defined(NATIVE_TEST)
+        mutable std::mutex m_mutex;
+    #endif
+};
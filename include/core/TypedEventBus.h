@@ -0,0 +1,153 @@
+/*
+ * TypedEventBus.h
+ *
+ * Типизированная шина событий (compile-time) рядом с EventDispatcher.
+ *
+ * - Таблица маршрутов задается списком TypedRoute<EventType, Handler> в параметрах шаблона
+ *   и целиком разворачивается компилятором: publish<T>() - это прямые (невиртуальные,
+ *   встраиваемые) вызовы handler->onEvent(EventTag<T>{}, payload) в порядке маршрутов.
+ * - Каждый тип события жестко связан со своей структурой (EventPayload<T>), поэтому
+ *   publish<EventType::VIBRATO_DETECTED>(SensorMaskPayload{...}) или обработчик,
+ *   ожидающий SensorMaskPayload для вибрато, - это ошибка компиляции, а не чтение
+ *   "чужого" члена union.
+ * - Опционально (setMirror) событие затем публикуется в EventDispatcher для
+ *   наблюдателей, которые работают через IEventHandler.
+ *
+ * Соответствует: docs/modules/core_event_dispatcher.md
+ */
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "events.h"
+#include "core/EventDispatcher.h"
+
+// Событие без данных (BLE_CONNECTED, MUTE_ENABLED, ...)
+struct EmptyPayload {};
+
+/**
+ * @brief Тег типа события для перегрузок onEvent().
+ */
+template <EventType T>
+struct EventTag {
+    static constexpr EventType type = T;
+};
+
+/**
+ * @brief Структура данных, жестко связанная с типом события.
+ */
+template <EventType T> struct EventPayloadOf { using type = EmptyPayload; };
+template <> struct EventPayloadOf<EventType::SENSOR_VALUE_CHANGED> { using type = SensorValuePayload; };
+template <> struct EventPayloadOf<EventType::SENSOR_FRAME>         { using type = SensorFramePayload; };
+template <> struct EventPayloadOf<EventType::SENSOR_MASK_CHANGED>  { using type = SensorMaskPayload; };
+template <> struct EventPayloadOf<EventType::HALF_HOLE_DETECTED>   { using type = HalfHolePayload; };
+template <> struct EventPayloadOf<EventType::VIBRATO_DETECTED>     { using type = VibratoPayload; };
+template <> struct EventPayloadOf<EventType::NOTE_PITCH_SELECTED>  { using type = NotePitchPayload; };
+
+template <EventType T>
+using EventPayload = typename EventPayloadOf<T>::type;
+
+/**
+ * @brief Собирает Event из типизированных данных (для EventDispatcher).
+ */
+template <EventType T>
+inline Event makeEvent(const EventPayload<T>& payload) {
+    if constexpr (std::is_same<EventPayload<T>, EmptyPayload>::value) {
+        (void)payload;
+        return Event(T);
+    } else {
+        return Event(T, payload);
+    }
+}
+
+/**
+ * @brief Маршрут: события типа T доставляются обработчику Handler.
+ * Handler обязан иметь метод onEvent(EventTag<T>, const EventPayload<T>&).
+ */
+template <EventType T, typename Handler>
+struct TypedRoute {
+    static constexpr EventType type = T;
+    using HandlerType = Handler;
+};
+
+template <typename... Routes>
+class TypedEventBus {
+public:
+    TypedEventBus() : m_handlers(static_cast<typename Routes::HandlerType*>(nullptr)...), m_mirror(nullptr) {}
+
+    /**
+     * @brief Привязывает экземпляр ко всем маршрутам с его типом (nullptr - отвязать).
+     */
+    template <typename Handler>
+    void bind(Handler* handler) {
+        bindAll(handler, std::index_sequence_for<Routes...>{});
+    }
+
+    /**
+     * @brief Дополнительно публиковать каждое событие в EventDispatcher (nullptr - нет).
+     */
+    void setMirror(EventDispatcher* dispatcher) {
+        m_mirror = dispatcher;
+    }
+
+    /**
+     * @brief Доставляет событие всем маршрутам типа T прямыми вызовами в вызывающей задаче,
+     * затем (если задано) публикует его в EventDispatcher.
+     */
+    template <EventType T>
+    void publish(const EventPayload<T>& payload) {
+        deliver<T>(payload, std::index_sequence_for<Routes...>{});
+        if (m_mirror) {
+            m_mirror->postEvent(makeEvent<T>(payload));
+        }
+    }
+
+    template <EventType T>
+    void publish() {
+        static_assert(std::is_same<EventPayload<T>, EmptyPayload>::value, "This event type carries a payload");
+        publish<T>(EmptyPayload{});
+    }
+
+    /**
+     * @brief Количество маршрутов для типа события (вычисляется при компиляции).
+     */
+    template <EventType T>
+    static constexpr size_t routeCount() {
+        return ((Routes::type == T ? 1 : 0) + ... + 0);
+    }
+
+private:
+    template <typename Handler, size_t... I>
+    void bindAll(Handler* handler, std::index_sequence<I...>) {
+        (bindOne<I>(handler), ...);
+    }
+
+    template <size_t I, typename Handler>
+    void bindOne(Handler* handler) {
+        using Route = typename std::tuple_element<I, std::tuple<Routes...>>::type;
+        if constexpr (std::is_same<typename Route::HandlerType, Handler>::value) {
+            std::get<I>(m_handlers) = handler;
+        }
+    }
+
+    template <EventType T, size_t... I>
+    void deliver(const EventPayload<T>& payload, std::index_sequence<I...>) {
+        (deliverOne<T, I>(payload), ...);
+    }
+
+    template <EventType T, size_t I>
+    void deliverOne(const EventPayload<T>& payload) {
+        using Route = typename std::tuple_element<I, std::tuple<Routes...>>::type;
+        if constexpr (Route::type == T) {
+            auto* handler = std::get<I>(m_handlers);
+            if (handler) {
+                handler->onEvent(EventTag<T>{}, payload);
+            }
+        }
+    }
+
+    std::tuple<typename Routes::HandlerType*...> m_handlers;
+    EventDispatcher* m_mirror;
+};
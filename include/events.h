@@ -8,6 +8,7 @@
  */
 #pragma once
 #include <cstdint>
+#include <cstddef>
 
 // 1. Типы событий
 enum class EventType {
@@ -25,16 +26,65 @@ enum class EventType {
     NOTE_PITCH_SELECTED,  // (payload: notePitch)
     
     // CORE -> APP
-    SYSTEM_IDLE_TIMEOUT   // (no payload)
+    SYSTEM_IDLE_TIMEOUT,  // (no payload)
+
+    // Новые типы - только в конец: номера пишутся в дамп самописца (tools/decode_flight_recorder.py)
+    // HAL -> APP
+    SENSOR_FRAME,         // (payload: sensorFrame) Все значения одного цикла опроса
+
+    // (Служебное) Количество типов событий. Должно оставаться последним.
+    EVENT_TYPE_COUNT
 };
 
+constexpr size_t EVENT_TYPE_COUNT = static_cast<size_t>(EventType::EVENT_TYPE_COUNT);
+
+// Имя типа события (для логов и дампов статистики)
+inline const char* eventTypeName(EventType type) {
+    switch (type) {
+        case EventType::SENSOR_VALUE_CHANGED: return "SENSOR_VALUE_CHANGED";
+        case EventType::BLE_CONNECTED:        return "BLE_CONNECTED";
+        case EventType::BLE_DISCONNECTED:     return "BLE_DISCONNECTED";
+        case EventType::SENSOR_MASK_CHANGED:  return "SENSOR_MASK_CHANGED";
+        case EventType::HALF_HOLE_DETECTED:   return "HALF_HOLE_DETECTED";
+        case EventType::VIBRATO_DETECTED:     return "VIBRATO_DETECTED";
+        case EventType::MUTE_ENABLED:         return "MUTE_ENABLED";
+        case EventType::MUTE_DISABLED:        return "MUTE_DISABLED";
+        case EventType::NOTE_PITCH_SELECTED:  return "NOTE_PITCH_SELECTED";
+        case EventType::SYSTEM_IDLE_TIMEOUT:  return "SYSTEM_IDLE_TIMEOUT";
+        case EventType::SENSOR_FRAME:         return "SENSOR_FRAME";
+        default:                              return "UNKNOWN";
+    }
+}
+
+// Ширина маски отверстий (бит = позиция в hole_sensor_ids): 16 или 32 бита.
+// Задается при сборке: -D HOLE_MASK_BITS=32
+#ifndef HOLE_MASK_BITS
+#define HOLE_MASK_BITS 16
+#endif
+
+#if HOLE_MASK_BITS == 16
+using HoleMask = uint16_t;
+#elif HOLE_MASK_BITS == 32
+using HoleMask = uint32_t;
+#else
+#error "HOLE_MASK_BITS must be 16 or 32"
+#endif
+
 // 2. Структуры данных (Payloads)
 struct SensorValuePayload { int id; int value; };
-struct SensorMaskPayload { uint8_t mask; };
+struct SensorMaskPayload { HoleMask mask; };
 struct HalfHolePayload { int id; };
 struct VibratoPayload { int id; float depth; };
 struct NotePitchPayload { int pitch; }; // 0 = Note Off
 
+// Кадр опроса: значения всех сенсоров за один цикл (индекс = логический ID)
+constexpr int MAX_FRAME_SENSORS = 16;
+struct SensorFramePayload {
+    uint32_t timestampMs;               // Время опроса (IHalSystem::getSystemTimestampMs)
+    uint8_t count;                      // Количество валидных значений (ID 0..count-1)
+    uint16_t values[MAX_FRAME_SENSORS]; // Отфильтрованные значения (насыщаются на 65535)
+};
+
 // 3. Единая структура события
 struct Event {
     EventType type;
@@ -46,25 +96,34 @@ struct Event {
         HalfHolePayload halfHole;
         VibratoPayload vibrato;
         NotePitchPayload notePitch;
+        SensorFramePayload sensorFrame;
     } payload;
 
+    // Монотонное время публикации (мкс), ставит EventDispatcher::postEvent()
+    uint32_t postTimeUs;
+    // Порядковый номер в последней очереди (EventQueue), 0 - не в очереди
+    uint32_t seq;
+
     // Конструкторы
     
     // 1. Для событий без данных
-    Event(EventType t) : type(t) {}
+    Event(EventType t) : type(t), postTimeUs(0), seq(0) {}
 
     // 2. Для SENSOR_VALUE_CHANGED
-    Event(EventType t, SensorValuePayload p) : type(t), payload{.sensorValue = p} {}
+    Event(EventType t, SensorValuePayload p) : type(t), payload{.sensorValue = p}, postTimeUs(0), seq(0) {}
 
     // 3. Для SENSOR_MASK_CHANGED
-    Event(EventType t, SensorMaskPayload p) : type(t), payload{.sensorMask = p} {}
+    Event(EventType t, SensorMaskPayload p) : type(t), payload{.sensorMask = p}, postTimeUs(0), seq(0) {}
 
     // 4. Для HALF_HOLE_DETECTED
-    Event(EventType t, HalfHolePayload p) : type(t), payload{.halfHole = p} {}
+    Event(EventType t, HalfHolePayload p) : type(t), payload{.halfHole = p}, postTimeUs(0), seq(0) {}
 
     // 5. Для VIBRATO_DETECTED
-    Event(EventType t, VibratoPayload p) : type(t), payload{.vibrato = p} {}
+    Event(EventType t, VibratoPayload p) : type(t), payload{.vibrato = p}, postTimeUs(0), seq(0) {}
 
     // 6. Для NOTE_PITCH_SELECTED (Именно его не хватало)
-    Event(EventType t, NotePitchPayload p) : type(t), payload{.notePitch = p} {}
+    Event(EventType t, NotePitchPayload p) : type(t), payload{.notePitch = p}, postTimeUs(0), seq(0) {}
+
+    // 7. Для SENSOR_FRAME
+    Event(EventType t, SensorFramePayload p) : type(t), payload{.sensorFrame = p}, postTimeUs(0), seq(0) {}
 };
\ No newline at end of file
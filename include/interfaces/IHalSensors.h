@@ -11,6 +11,13 @@
 class ConfigManager;
 class EventDispatcher;
 
+/*
+ * Режимы публикации (ConfigManager::getSensorFrameMode()):
+ * - false: SENSOR_VALUE_CHANGED на каждый пин за цикл опроса.
+ * - true:  один SENSOR_FRAME на цикл опроса (значения всех пинов, индекс = логический ID,
+ *          не более MAX_FRAME_SENSORS) с timestamp опроса. В 9 раз меньше копий в очередь
+ *          и вызовов handleEvent, а app/logic пересчитывает маску один раз за кадр.
+ */
 class IHalSensors {
 public:
     virtual ~IHalSensors() {}
@@ -25,6 +32,7 @@ public:
 
     /**
      * @brief Запускает задачу FreeRTOS для циклического опроса сенсоров.
+     * Задача публикует SENSOR_VALUE_CHANGED или SENSOR_FRAME (см. режимы выше).
      */
     virtual void startTask() = 0;
 };
\ No newline at end of file
@@ -24,6 +24,8 @@ void MockEventHandler::handleEvent(const Event& event) {
         m_lastIntPayload = event.payload.notePitch.pitch;
     } else if (event.type == EventType::SENSOR_MASK_CHANGED) { 
         m_lastIntPayload = (int)event.payload.sensorMask.mask;
+    } else if (event.type == EventType::SENSOR_FRAME) {
+        m_lastIntPayload = (int)event.payload.sensorFrame.count;
     }
 }
 
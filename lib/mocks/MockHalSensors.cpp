@@ -5,9 +5,10 @@
  */
 #include "MockHalSensors.h"
 #include "core/ConfigManager.h" // Нужен для init
+#include <algorithm>
 
 MockHalSensors::MockHalSensors()
-    : m_dispatcher(nullptr), m_pinCount(0) {
+    : m_dispatcher(nullptr), m_configManager(nullptr), m_pinCount(0), m_frameTimestampMs(0) {
 }
 
 MockHalSensors::~MockHalSensors() {
@@ -15,6 +16,7 @@ MockHalSensors::~MockHalSensors() {
 
 bool MockHalSensors::init(ConfigManager* configManager, EventDispatcher* dispatcher) {
     m_dispatcher = dispatcher;
+    m_configManager = configManager;
     // Мы не можем получить `physical_pins` напрямую из ConfigManager,
     // так как он еще не инициализирован (это сделает Scheduler).
     // Мы эмулируем, что ConfigManager *будет* загружен.
@@ -40,6 +42,32 @@ void MockHalSensors::pushMockSensorValue(int logicalId, int value) {
     }
 }
 
+void MockHalSensors::pushMockSensorFrame(const std::vector<int>& values, uint32_t timestampMs) {
+    if (!m_dispatcher) {
+        std::cerr << "[MockHalSensors] ERROR: pushMockSensorFrame called but dispatcher is null!" << std::endl;
+        return;
+    }
+
+    // Эмулируем период опроса sample_rate_hz (50 Гц без конфига), если время не задано явно
+    int rateHz = m_configManager ? m_configManager->getSampleRateHz() : 0;
+    if (rateHz <= 0) rateHz = 50;
+    m_frameTimestampMs = (timestampMs != 0) ? timestampMs : m_frameTimestampMs + 1000 / rateHz;
+
+    SensorFramePayload frame = {};
+    frame.timestampMs = m_frameTimestampMs;
+    frame.count = (uint8_t)std::min<size_t>(values.size(), MAX_FRAME_SENSORS);
+    for (int i = 0; i < frame.count; ++i) {
+        // Насыщение, как в настоящем HAL
+        frame.values[i] = (uint16_t)std::max(0, std::min(values[i], 65535));
+    }
+
+    m_dispatcher->postEvent(Event(EventType::SENSOR_FRAME, frame));
+}
+
+uint32_t MockHalSensors::getLastFrameTimestampMs() const {
+    return m_frameTimestampMs;
+}
+
 int MockHalSensors::getConfiguredPinCount() const {
     // (Полезно для тестов, чтобы проверить, что Scheduler все настроил)
     return m_pinCount; 
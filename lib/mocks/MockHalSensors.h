@@ -10,6 +10,8 @@
 #include "interfaces/IHalSensors.h"
 #include "core/EventDispatcher.h" // Нужен для отправки событий
 #include <iostream> // Для std::cout
+#include <vector>
+#include <cstdint>
 
 class MockHalSensors : public IHalSensors {
 public:
@@ -26,10 +28,24 @@ public:
      * (Реализация требования Спринта 1.10)
      */
     void pushMockSensorValue(int logicalId, int value);
+
+    /**
+     * @brief "Вбрасывает" целый кадр опроса (SENSOR_FRAME) в систему.
+     * @param values Значения сенсоров, индекс = логический ID.
+     * @param timestampMs Время кадра; 0 = автоматически (+1000/sample_rate_hz от прошлого кадра).
+     */
+    void pushMockSensorFrame(const std::vector<int>& values, uint32_t timestampMs = 0);
     
     int getConfiguredPinCount() const;
 
+    /**
+     * @brief Время последнего вброшенного кадра (timestampMs), мс.
+     */
+    uint32_t getLastFrameTimestampMs() const;
+
 private:
     EventDispatcher* m_dispatcher;
+    ConfigManager* m_configManager; // Для sample_rate_hz (загружается позже init)
     int m_pinCount;
+    uint32_t m_frameTimestampMs;
 };
\ No newline at end of file
@@ -51,7 +51,7 @@ bool MockHalStorage::readFile(const std::string& path, std::string& content) {
 
     // 2. Реальное чтение
     std::string hostPath = getHostPath(path);
-    std::ifstream file(hostPath);
+    std::ifstream file(hostPath, std::ios::binary);
     if (!file.is_open()) {
         std::cerr << "[MockHalStorage] FAILED to read file: " << hostPath << std::endl;
         return false; // Файл не найден
@@ -70,7 +70,7 @@ bool MockHalStorage::readFile(const std::string& path, std::string& content) {
  */
 bool MockHalStorage::writeFile(const std::string& path, const std::string& content) {
     std::string hostPath = getHostPath(path);
-    std::ofstream file(hostPath);
+    std::ofstream file(hostPath, std::ios::binary); // Дампы могут быть двоичными
     if (!file.is_open()) {
         std::cerr << "[MockHalStorage] FAILED to write file: " << hostPath << std::endl;
         return false;
@@ -8,6 +8,7 @@
  */
 
 #include "app/AppFingering.h"
+#include "app/AppMidi.h"
 #include "core/Logger.h"
 #include <sstream>
 #include <algorithm>
@@ -16,6 +17,7 @@
 #include <iostream> // std::cout, std::cerr
 #include <cctype>   // isspace
 #include <iomanip>  
+#include <limits>
 
 #define TAG "AppFingering"
 
@@ -45,10 +47,36 @@ static int parseNumber(const std::string& str) {
     }
 }
 
+/**
+ * @brief Маска из fingering.cfg (0b..., 0x... или десятичная), не шире HOLE_MASK_BITS.
+ */
+static bool parseMask(const std::string& str, HoleMask& mask) {
+    std::string cleanStr = trim(str);
+    try {
+        size_t used = 0;
+        unsigned long long value;
+        if (cleanStr.size() > 2 && cleanStr.substr(0, 2) == "0b") {
+            value = std::stoull(cleanStr.substr(2), &used, 2);
+            used += 2;
+        } else if (cleanStr.size() > 2 && cleanStr.substr(0, 2) == "0x") {
+            value = std::stoull(cleanStr.substr(2), &used, 16);
+            used += 2;
+        } else {
+            value = std::stoull(cleanStr, &used, 10);
+        }
+        if (used != cleanStr.size() || cleanStr[0] == '-' || value > std::numeric_limits<HoleMask>::max()) return false;
+        mask = (HoleMask)value;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
 // --- Конструктор ---
 
 AppFingering::AppFingering() 
     : m_dispatcher(nullptr), 
+      m_pipeline(nullptr),
       m_currentMask(0), 
       m_lastPublishedNote(0), 
       m_currentHalfHoleId(-1) {
@@ -74,11 +102,19 @@ bool AppFingering::init(IHalStorage* storage) {
     }
 }
 
+// --- Fused Pipeline ---
+
+void AppFingering::setFusedPipeline(AppPipelineBus* pipeline) {
+    m_pipeline = pipeline;
+}
+
 // --- Subscribe ---
 
 void AppFingering::subscribe(EventDispatcher* dispatcher) {
     m_dispatcher = dispatcher;
-    if (m_dispatcher) {
+    // В режиме fused_pipeline маску и полузакрытие передает AppLogic напрямую.
+    // Диспетчер нужен только для публикации NOTE_PITCH_SELECTED наблюдателям.
+    if (m_dispatcher && !m_pipeline) {
         m_dispatcher->subscribe(EventType::SENSOR_MASK_CHANGED, this);
         m_dispatcher->subscribe(EventType::HALF_HOLE_DETECTED, this);
     }
@@ -88,22 +124,43 @@ void AppFingering::subscribe(EventDispatcher* dispatcher) {
 
 void AppFingering::handleEvent(const Event& event) {
     if (event.type == EventType::SENSOR_MASK_CHANGED) {
-        m_currentMask = event.payload.sensorMask.mask;
-        m_currentHalfHoleId = -1; 
-        
-        std::cout << "[AppFingering] Mask Changed -> " << (int)m_currentMask << std::endl;
-        
-        int note = findNote(m_currentMask, m_currentHalfHoleId);
-        publishNote(note);
+        onMaskChanged(event.payload.sensorMask.mask);
     } 
     else if (event.type == EventType::HALF_HOLE_DETECTED) {
-        m_currentHalfHoleId = event.payload.halfHole.id;
-        
-        std::cout << "[AppFingering] HalfHole Detected ID: " << m_currentHalfHoleId << std::endl;
+        onHalfHoleDetected(event.payload.halfHole.id);
+    }
+}
+
+bool AppFingering::isKnownMask(HoleMask mask) const {
+    return m_fingeringMap.count(mask) != 0;
+}
 
-        int note = findNote(m_currentMask, m_currentHalfHoleId);
-        publishNote(note);
+std::vector<HoleMask> AppFingering::knownMasks() const {
+    std::vector<HoleMask> masks;
+    masks.reserve(m_fingeringMap.size());
+    for (const auto& entry : m_fingeringMap) {
+        masks.push_back(entry.first);
     }
+    return masks;
+}
+
+void AppFingering::onMaskChanged(HoleMask mask) {
+    m_currentMask = mask;
+    m_currentHalfHoleId = -1; 
+    
+    std::cout << "[AppFingering] Mask Changed -> " << (unsigned long)m_currentMask << std::endl;
+    
+    int note = findNote(m_currentMask, m_currentHalfHoleId);
+    publishNote(note);
+}
+
+void AppFingering::onHalfHoleDetected(int sensorId) {
+    m_currentHalfHoleId = sensorId;
+    
+    std::cout << "[AppFingering] HalfHole Detected ID: " << m_currentHalfHoleId << std::endl;
+
+    int note = findNote(m_currentMask, m_currentHalfHoleId);
+    publishNote(note);
 }
 
 // --- Приватные методы ---
@@ -140,15 +197,20 @@ void AppFingering::parseFingeringConfig(const std::string& fileContent) {
         // --------------------------------------
 
         if (tokens.size() >= 2) {
-            int mask = parseNumber(tokens[0]);
+            HoleMask mask = 0;
+            if (!parseMask(tokens[0], mask)) {
+                // Маска шире HOLE_MASK_BITS не обрезается: правило сработало бы на чужой маске
+                LOG_WARN(TAG, "Invalid or too wide mask '%s' (HOLE_MASK_BITS=%d)", tokens[0].c_str(), HOLE_MASK_BITS);
+                continue;
+            }
             int note = parseNumber(tokens[1]);
 
-            if (mask < 0 || note < 0) {
+            if (note < 0) {
                 std::cout << "   -> INVALID NUMBERS" << std::endl;
                 continue;
             }
 
-            FingeringRule& rule = m_fingeringMap[(uint8_t)mask];
+            FingeringRule& rule = m_fingeringMap[mask];
             rule.mainNote = note;
 
             // Если есть 4 токена
@@ -174,17 +236,18 @@ void AppFingering::parseFingeringConfig(const std::string& fileContent) {
     LOG_INFO(TAG, "Loaded %d fingering rules.", loadedCount);
 }
 
-int AppFingering::findNote(uint8_t mask, int halfHoleSensorId) {
-    if (m_fingeringMap.count(mask) == 0) {
-        std::cout << "[AppFingering] Mask " << (int)mask << " NOT FOUND in map" << std::endl;
+int AppFingering::findNote(HoleMask mask, int halfHoleSensorId) {
+    auto it = m_fingeringMap.find(mask);
+    if (it == m_fingeringMap.end()) {
+        std::cout << "[AppFingering] Mask " << (unsigned long)mask << " NOT FOUND in map" << std::endl;
         return 0; 
     }
 
-    const FingeringRule& rule = m_fingeringMap.at(mask);
+    const FingeringRule& rule = it->second;
 
     if (halfHoleSensorId != -1) {
         // ДЕТАЛЬНАЯ ОТЛАДКА ПОИСКА
-        std::cout << "[AppFingering] Checking HH for Mask " << (int)mask 
+        std::cout << "[AppFingering] Checking HH for Mask " << (unsigned long)mask 
                   << ", Sensor " << halfHoleSensorId << ". Rules in map: " 
                   << rule.halfHoleRules.size() << std::endl;
         
@@ -209,6 +272,12 @@ void AppFingering::publishNote(int note) {
     m_lastPublishedNote = note;
     std::cout << "[AppFingering] Publish Note: " << note << std::endl;
 
+    // fused_pipeline: сначала MIDI (критический путь), затем событие для наблюдателей
+    if (m_pipeline) {
+        m_pipeline->publish<EventType::NOTE_PITCH_SELECTED>(NotePitchPayload{note});
+        return;
+    }
+
     if (m_dispatcher) {
         Event ev(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{note});
         m_dispatcher->postEvent(ev);
@@ -8,9 +8,12 @@
  * DEVELOPMENT_PLAN.MD - Спринт 2.7 / 2.10
  */
 #include "app/AppLogic.h"
+#include "app/AppFingering.h"
+#include "app/AppMidi.h"
 #include "core/Logger.h"
 #include <iostream> // Для отладки в Native
 #include <numeric>  // Для std::accumulate
+#include <cmath>
 
 #define TAG "AppLogic"
 
@@ -19,13 +22,8 @@
 #if defined(ESP32_TARGET)
     #include "freertos/FreeRTOS.h"
     #include "freertos/task.h"
-    #include "freertos/queue.h"
 #elif defined(NATIVE_TEST)
-    // Заглушки типов и макросов FreeRTOS для компиляции на хосте
-    typedef void* QueueHandle_t;
-    #define xQueueCreate(len, size) ((void*)1) // Возвращаем не-null указатель
-    #define xQueueSend(queue, item, ticks) (true)
-    #define xQueueReceive(queue, item, ticks) (true)
+    // Заглушки макросов FreeRTOS для компиляции на хосте
     #define xTaskCreate(task, name, stack, params, prio, handle) (pdPASS)
     #define vTaskDelay(ticks) ((void)0)
     #define pdPASS 1
@@ -36,9 +34,39 @@
 AppLogic::AppLogic() 
     : m_dispatcher(nullptr), 
       m_configManager(nullptr),
-      m_sensorQueue(nullptr),
+      m_pipeline(nullptr),
+      m_task(nullptr),
+      m_reportedGaps(0),
+      m_muteSensorId(-1),
+      m_hysteresis(0),
+      m_dwellSamples(1),
+      m_sampleRateHz(50),
+      m_predictSamples(0),
+      m_adaptive(false),
+      m_closedRatio(0.6f),
+      m_halfRatio(0.3f),
+      m_defaultBaseline(0.0f),
+      m_defaultRange(1.0f),
+      m_calibrationSamples(0),
+      m_driftAlpha(0.0f),
+      m_vibratoDetector(VibratoDetector::ZERO_CROSSING),
       m_isMuted(false),
-      m_currentMask(0) {
+      m_muteRaw(false),
+      m_mutePending(false),
+      m_mutePendingCount(0),
+      m_rawTransitions(0),
+      m_transitions(0),
+      m_currentMask(0),
+      m_maskSettleMs(0),
+      m_knownMasks(),
+      m_maskPending(false),
+      m_pendingMask(0),
+      m_pendingSinceMs(0),
+      m_deferredHalfHoles(0),
+      m_settleStats(),
+      m_predictionStats(),
+      m_lanes(),
+      m_laneOfId() {
     // Инициализация массивов и переменных происходит в списке инициализации
 }
 
@@ -46,15 +74,21 @@ AppLogic::AppLogic()
 bool AppLogic::init(ConfigManager* configManager, EventDispatcher* dispatcher) {
     // 1. Сброс состояния (ВАЖНО для тестов и корректной перезагрузки конфига)
     m_isMuted = false;
+    m_muteRaw = false;
+    m_mutePendingCount = 0;
+    m_rawTransitions = 0;
+    m_transitions = 0;
     m_currentMask = 0;
-    // Сбрасываем состояния всех сенсоров в OPEN и очищаем историю вибрато
-    for (int i = 0; i < 16; ++i) {
-        m_sensorContexts[i] = SensorContext(); 
-    }
-
+    m_maskPending = false;
+    m_deferredHalfHoles = 0;
+    m_settleStats = MaskSettleStats();
     m_configManager = configManager;
     m_dispatcher = dispatcher;
-    
+
+    // История - 1 секунда данных (емкость = частота дискретизации), память выделена заранее.
+    int historySize = m_configManager->getSampleRateHz();
+    if (historySize <= 0) historySize = 50; // Защита от некорректного конфига
+
     // 2. Загружаем параметры из ConfigManager
     // Это гарантирует, что мы используем актуальные настройки из settings.cfg
     m_muteSensorId = m_configManager->getMuteSensorId();
@@ -65,48 +99,132 @@ bool AppLogic::init(ConfigManager* configManager, EventDispatcher* dispatcher) {
     m_holeClosedThreshold = m_configManager->getHoleClosedThreshold();
     m_halfHoleThreshold = m_configManager->getHalfHoleThreshold();
 
+    // Триггер Шмитта и выдержка для OPEN/HALF_HOLE/CLOSED и Mute (0 и 1 - как голые пороги)
+    m_hysteresis = m_configManager->getThresholdHysteresis();
+    if (m_hysteresis < 0) m_hysteresis = 0;
+    m_dwellSamples = m_configManager->getStateDwellSamples();
+    m_maskSettleMs = m_configManager->getMaskSettleMs();
+
+    // Адаптивные пороги: порог = база + доля размаха. База и размах по умолчанию - те, при
+    // которых относительные пороги совпадают с глобальными (до конца калибровки и если она не удалась)
+    m_adaptive = m_configManager->getAdaptiveThresholds();
+    m_closedRatio = m_configManager->getHoleClosedRatio();
+    m_halfRatio = m_configManager->getHalfHoleRatio();
+    if (m_adaptive && !(m_halfRatio > 0.0f && m_halfRatio < m_closedRatio && m_closedRatio <= 1.0f &&
+                        m_halfHoleThreshold < m_holeClosedThreshold)) {
+        LOG_WARN(TAG, "adaptive_thresholds off: need 0 < half_hole_ratio < hole_closed_ratio <= 1 "
+                      "and half_hole_threshold < hole_closed_threshold");
+        m_adaptive = false;
+    }
+    if (m_adaptive) {
+        m_defaultRange = (float)(m_holeClosedThreshold - m_halfHoleThreshold) / (m_closedRatio - m_halfRatio);
+        m_defaultBaseline = (float)m_holeClosedThreshold - m_closedRatio * m_defaultRange;
+        long calibration = (long)m_configManager->getBaselineCalibrationMs() * historySize / 1000;
+        m_calibrationSamples = (uint16_t)(calibration < 1 ? 1 : (calibration > 0xFFFF ? 0xFFFF : calibration));
+        long tau = (long)m_configManager->getBaselineTauMs() * historySize / 1000;
+        m_driftAlpha = tau > 1 ? 1.0f / (float)tau : 1.0f;
+    }
+
+    // Все полосы - в OPEN с пустой историей, пороги - из конфига
+    resetLanes((size_t)historySize);
+
+    // Предсказание закрытия: горизонт в значениях (не меньше одного периода опроса)
+    m_sampleRateHz = historySize;
+    const int predictMs = m_configManager->getPredictOnsetMs();
+    m_predictSamples = predictMs > 0 ? (predictMs * historySize + 500) / 1000 : 0;
+    if (predictMs > 0 && m_predictSamples < 1) m_predictSamples = 1;
+    m_predictionStats = OnsetPredictionStats();
+    m_predictionStats.horizonMs = (uint32_t)(m_predictSamples * 1000 / historySize);
+
     // Параметры для алгоритма детекции вибрато
     m_vibratoFreqMin = m_configManager->getVibratoFreqMin();
     m_vibratoFreqMax = m_configManager->getVibratoFreqMax();
     m_vibratoAmplitudeMin = m_configManager->getVibratoAmplitudeMin();
+    m_vibratoDetector = m_configManager->getVibratoDetector();
 
-    // 3. Создание очереди событий
-    #if defined(ESP32_TARGET)
-    // В RTOS создаем реальную очередь.
-    // Если init вызывается повторно (перезагрузка конфига), очередь может уже существовать.
-    if (m_sensorQueue == nullptr) {
-        m_sensorQueue = xQueueCreate(20, sizeof(Event));
-        if (m_sensorQueue == nullptr) {
-            LOG_ERROR(TAG, "Failed to create queue");
-            return false;
-        }
-    } else {
-        // Очищаем очередь от старых событий при ре-инициализации
-        xQueueReset(m_sensorQueue);
+    // Окно бинов - хвост истории (значение, покидающее окно, берется из нее)
+    size_t binWindow = (size_t)((long)m_configManager->getVibratoWindowMs() * historySize / 1000);
+    if (binWindow > m_lanes.history[0].capacity()) {
+        binWindow = m_lanes.history[0].capacity();
     }
-    #else
-    // В тестах используем фейковый указатель
-    m_sensorQueue = (void*)1; 
-    #endif
-    
+    m_vibratoBank.configure((float)historySize, m_vibratoFreqMin, m_vibratoFreqMax, binWindow);
+    for (size_t lane = 0; lane < MAX_HOLE_SENSORS; ++lane) {
+        m_vibratoBank.reset(m_lanes.vibratoBins[lane]);
+    }
+
+    // 3. Настройка очереди событий (хранилище статическое, куча не используется)
+    // Емкость и политика применяются и при повторном init (перезагрузка конфига).
+    m_sensorQueue.configure(m_configManager->getAppLogicQueueConfig());
+    m_sensorQueue.setBlockTimeoutMs((uint32_t)m_configManager->getQueueBlockTimeoutMs());
+    if (m_task == nullptr) {
+        // Задача еще не запущена - можно очистить очередь и статистику
+        m_sensorQueue.reset();
+        m_reportedGaps = 0;
+    }
+
     return true;
 }
 
+// --- Fused Pipeline ---
+void AppLogic::setFusedPipeline(AppPipelineBus* pipeline) {
+    m_pipeline = pipeline;
+}
+
+template <EventType T>
+void AppLogic::publish(const EventPayload<T>& payload) {
+    if (m_pipeline) {
+        // Прямые вызовы по таблице маршрутов; шина сама опубликует событие наблюдателям
+        m_pipeline->publish<T>(payload);
+    } else {
+        m_dispatcher->postEvent(makeEvent<T>(payload));
+    }
+}
+
+void AppLogic::setKnownFingerings(const AppFingering* fingering) {
+    m_knownMasks.clear();
+    if (!fingering) return;
+    const std::vector<HoleMask> masks = fingering->knownMasks();
+    m_knownMasks.reserve(masks.size());
+    m_knownMasks.insert(masks.begin(), masks.end());
+}
+
 // --- Запуск задачи ---
-void AppLogic::startTask() {
+void AppLogic::startTask(int core) {
     #if defined(ESP32_TARGET)
     // Запускаем задачу обработки логики с приоритетом 5
     // Stack size 4096 байт обычно достаточно для логики без тяжелых аллокаций
-    xTaskCreate(appLogicTask, "appLogicTask", 4096, this, 5, nullptr);
+    TaskHandle_t handle = nullptr;
+    const BaseType_t affinity = core == NO_CORE_AFFINITY ? tskNO_AFFINITY : (BaseType_t)core;
+    if (xTaskCreatePinnedToCore(appLogicTask, "appLogicTask", 4096, this, 5, &handle, affinity) == pdPASS) {
+        m_task = handle;
+    } else {
+        LOG_ERROR(TAG, "Failed to create task");
+    }
+    #else
+    (void)core;
     #endif
 }
 
 // --- Подписка на события ---
 void AppLogic::subscribe(EventDispatcher* dispatcher) {
     if (dispatcher) {
-        // Подписываемся только на сырые данные сенсоров
-        dispatcher->subscribe(EventType::SENSOR_VALUE_CHANGED, this);
+        // Подписываемся только на сырые данные сенсоров (по пину или кадром).
+        // Значения чужих сенсоров отсекает диспетчер - они не попадают в очередь модуля.
+        dispatcher->subscribe(EventType::SENSOR_VALUE_CHANGED, this, sensorFilter());
+        dispatcher->subscribe(EventType::SENSOR_FRAME, this);
+    }
+}
+
+EventFilter AppLogic::sensorFilter() const {
+    uint32_t mask = EventFilter::idBit(m_muteSensorId);
+    bool allFit = mask != 0 || m_muteSensorId < 0;
+    for (int id : m_holeSensorIds) {
+        uint32_t bit = EventFilter::idBit(id);
+        if (bit == 0 && id >= 0) allFit = false;
+        mask |= bit;
     }
+    // ID за пределами битового набора - фильтровать нечем, модуль разберет все сам
+    return allFit ? EventFilter::ids(mask) : EventFilter::all();
 }
 
 // --- Обработчик входящих событий (IEventHandler) ---
@@ -114,19 +232,44 @@ void AppLogic::handleEvent(const Event& event) {
     // Этот метод вызывается в контексте задачи EventDispatcher (или ISR).
     // Его цель - максимально быстро передать данные в собственную задачу AppLogic.
     
-    #if defined(NATIVE_TEST)
-        // В тестах (синхронный режим) вызываем логику напрямую для детерминизма
-        if (event.type == EventType::SENSOR_VALUE_CHANGED) {
-             processSensorEvent(event);
+    if (event.type != EventType::SENSOR_VALUE_CHANGED && event.type != EventType::SENSOR_FRAME) return;
+
+    #if defined(ESP32_TARGET)
+        // В RTOS кладем событие в очередь по политике app_logic_queue_policy
+        // и будим задачу. Потери учитываются счетчиками очереди.
+        if (m_sensorQueue.push(event, true) != SensorQueue::PushResult::DROPPED && m_task) {
+            xTaskNotifyGive((TaskHandle_t)m_task);
         }
-    #else
-        // В RTOS отправляем событие в очередь для асинхронной обработки
-        if (m_sensorQueue) {
-            xQueueSend(m_sensorQueue, &event, 0);
+    #elif defined(NATIVE_TEST)
+        // В тестах (синхронный режим) сразу разбираем очередь для детерминизма
+        m_sensorQueue.push(event, false);
+        Event pending(EventType::BLE_CONNECTED);
+        while (m_sensorQueue.pop(pending)) {
+            processSensorEvent(pending);
         }
     #endif
 }
 
+const AppLogic::SensorQueue& AppLogic::getSensorQueue() const {
+    return m_sensorQueue;
+}
+
+uint32_t AppLogic::getSuppressedTransitionCount() const {
+    return m_rawTransitions > m_transitions ? m_rawTransitions - m_transitions : 0;
+}
+
+uint32_t AppLogic::getTransitionCount() const {
+    return m_transitions;
+}
+
+const MaskSettleStats& AppLogic::getMaskSettleStats() const {
+    return m_settleStats;
+}
+
+const OnsetPredictionStats& AppLogic::getOnsetPredictionStats() const {
+    return m_predictionStats;
+}
+
 // --- Приватные методы: Задача FreeRTOS ---
 
 void AppLogic::appLogicTask(void* params) {
@@ -140,10 +283,28 @@ void AppLogic::runAppLogicTask() {
     Event event(EventType::BLE_CONNECTED); // Временная переменная
     
     while(true) {
-        // Блокирующее ожидание новых данных из очереди
-        if (xQueueReceive(m_sensorQueue, &event, portMAX_DELAY) == pdPASS) {
+        // Разбираем все, что накопилось
+        while (m_sensorQueue.pop(event)) {
             processSensorEvent(event);
         }
+
+        uint32_t gaps = m_sensorQueue.getGapCount();
+        if (gaps > m_reportedGaps) {
+            LOG_WARN(TAG, "Lost %u sensor events (dropped=%u, hwm=%u)", (unsigned)(gaps - m_reportedGaps),
+                     (unsigned)m_sensorQueue.getDroppedCount(), (unsigned)m_sensorQueue.getHighWaterMark());
+            m_reportedGaps = gaps;
+        }
+
+        // Блокирующее ожидание новых данных (уведомление из handleEvent).
+        // Удерживаемая маска публикуется и без новых значений - по истечении выдержки.
+        TickType_t wait = portMAX_DELAY;
+        if (m_maskPending) {
+            uint32_t held = m_dispatcher->nowMs() - m_pendingSinceMs;
+            uint32_t left = held < (uint32_t)m_maskSettleMs ? (uint32_t)m_maskSettleMs - held : 0;
+            wait = pdMS_TO_TICKS(left) + 1;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+        pollMaskSettle();
     }
     #endif
 }
@@ -155,6 +316,14 @@ void AppLogic::runAppLogicTask() {
  * Здесь принимаются решения о смене состояния (OPEN/HALF/CLOSED) и жестах.
  */
 void AppLogic::processSensorEvent(const Event& event) {
+    // Удерживаемая маска простояла до этого значения - публикуем до его обработки
+    pollMaskSettle();
+
+    if (event.type == EventType::SENSOR_FRAME) {
+        processSensorFrame(event.payload.sensorFrame);
+        return;
+    }
+
     // Мы обрабатываем только изменения значений сенсоров
     if (event.type != EventType::SENSOR_VALUE_CHANGED) return;
 
@@ -163,160 +332,543 @@ void AppLogic::processSensorEvent(const Event& event) {
 
     // --- 1. Логика Сенсора Mute ---
     if (id == m_muteSensorId) {
-        // Простая пороговая логика (Шмитт триггер здесь не помешал бы, но пока простой порог)
-        bool newMuteState = (value > m_muteThreshold);
-        
-        if (newMuteState != m_isMuted) {
-            m_isMuted = newMuteState;
-            // Публикуем событие изменения состояния Mute
-            Event ev(newMuteState ? EventType::MUTE_ENABLED : EventType::MUTE_DISABLED);
-            m_dispatcher->postEvent(ev);
-            
-            #if defined(NATIVE_TEST)
-            std::cout << "[AppLogic] Mute changed: " << newMuteState << std::endl;
-            #endif
-        }
+        processMuteValue(value);
         return; // Сенсор Mute обработан, это не игровое отверстие
     }
 
     // --- 2. Логика Игровых Сенсоров ---
-    
-    // Проверяем, входит ли ID сенсора в список игровых (hole_sensor_ids)
-    // и находим его битовый индекс (0..7) для маски.
-    int bitIndex = -1;
-    for (size_t i = 0; i < m_holeSensorIds.size(); ++i) {
-        if (m_holeSensorIds[i] == id) {
-            bitIndex = i;
-            break;
+    if (processHoleValue(id, value)) {
+        // !!! ИСПРАВЛЕНИЕ ПОРЯДКА СОБЫТИЙ !!!
+        // Сначала обновляем МАСКУ. Это сбросит старое состояние Half-Hole в AppFingering.
+        // Затем отправляем НОВОЕ событие Half-Hole (если оно есть).
+        // Если сделать наоборот, маска перезапишет (сбросит) только что установленный Half-Hole.
+
+        // 1. Обновляем маску (в любом случае)
+        updateMaskAndPublish();
+
+        // 2. Если перешли в состояние ПОЛУЗАКРЫТИЯ -> Публикуем специальное событие
+        if (holeState(id) == SensorState::HALF_HOLE) {
+            publishHalfHole(id);
         }
     }
+}
 
-    // Если сенсор игровой и ID валиден
-    if (bitIndex != -1 && id < 16) {
-        SensorContext& ctx = m_sensorContexts[id]; 
-        SensorState oldState = ctx.state;
-        SensorState newState = oldState;
+/**
+ * @brief Обработка целого кадра опроса (SENSOR_FRAME).
+ * Значения раскладываются по полосам, пороги сравниваются ядром кадра сразу для всех полос,
+ * автомат состояний проходят только полосы, где состояние может измениться.
+ * Маска пересчитывается ОДИН раз за кадр.
+ */
+void AppLogic::processSensorFrame(const SensorFramePayload& frame) {
+    const int count = frame.count < MAX_FRAME_SENSORS ? frame.count : MAX_FRAME_SENSORS;
 
-        // --- A. Сбор истории для Вибрато ---
-        ctx.valueHistory.push_back(value);
-        
-        // Ограничиваем размер буфера истории (равен частоте дискретизации = 1 секунда данных)
-        int maxHistorySize = m_configManager->getSampleRateHz(); 
-        if (maxHistorySize <= 0) maxHistorySize = 50; // Защита от некорректного конфига
+    if (m_muteSensorId >= 0 && m_muteSensorId < count) {
+        processMuteValue(frame.values[m_muteSensorId]);
+    }
 
-        if (ctx.valueHistory.size() > (size_t)maxHistorySize) {
-            ctx.valueHistory.erase(ctx.valueHistory.begin()); // Удаляем старые данные
+    // 1. История и вибрато - по каждой полосе, присутствующей в кадре
+    uint32_t present = 0;
+    for (size_t lane = 0; lane < m_lanes.count; ++lane) {
+        const uint32_t bit = 1u << lane;
+        if (!(m_lanes.live & bit) || m_lanes.id[lane] >= count) continue;
+        present |= bit;
+        recordLaneValue(lane, frame.values[m_lanes.id[lane]]);
+    }
+    if (present == 0) return;
+
+    // 2. Пороги - все полосы разом
+    const SensorFrameKernel::Bits raw = SensorFrameKernel::classify(
+        m_lanes.values, m_lanes.closedThreshold, m_lanes.halfThreshold, m_lanes.count);
+    trackRawStates(raw, present);
+    const SensorFrameKernel::Bits levels = SensorFrameKernel::classify(
+        m_lanes.values, m_lanes.closedLevel, m_lanes.halfLevel, m_lanes.count);
+
+    // 3. Автомат: смена уровня, идущая выдержка, предсказание
+    uint32_t active = (levels.closed ^ m_lanes.closed) | (levels.held ^ m_lanes.held) | m_lanes.pending |
+                      m_lanes.predicted;
+    if (m_predictSamples > 0) active |= ~m_lanes.closed;
+    active &= present;
+
+    bool stateChanged = false;
+    uint32_t halfHoleEntered = 0; // Биты ID, перешедших в HALF_HOLE в этом кадре
+    while (active != 0) {
+        const size_t lane = (size_t)__builtin_ctz(active);
+        active &= active - 1;
+        const uint32_t bit = 1u << lane;
+        const SensorState classified = (levels.closed & bit) ? SensorState::CLOSED
+                                     : (levels.held & bit)   ? SensorState::HALF_HOLE
+                                                             : SensorState::OPEN;
+        if (stepLane(lane, classified)) {
+            stateChanged = true;
+            if (m_lanes.state[lane] == SensorState::HALF_HOLE) {
+                halfHoleEntered |= (1u << m_lanes.id[lane]);
+            }
         }
+    }
 
-        // --- B. Анализ Вибрато ---
-        // Запускаем анализ, только если набрали достаточно данных (половина буфера)
-        if (ctx.valueHistory.size() >= (size_t)(maxHistorySize / 2)) {
-            float vibratoDepth = analyzeVibrato(ctx.valueHistory);
-            
-            if (vibratoDepth > 0.0f) {
-                // Вибрато обнаружено -> Публикуем событие
-                Event ev(EventType::VIBRATO_DETECTED, VibratoPayload{id, vibratoDepth});
-                m_dispatcher->postEvent(ev);
-                
-                #if defined(NATIVE_TEST)
-                // std::cout << "[AppLogic] Vibrato Detected! Depth: " << vibratoDepth << std::endl;
-                #endif
-            }
+    if (!stateChanged) return;
+
+    // Тот же порядок, что и для одиночных значений: сначала МАСКА, затем Half-Hole
+    updateMaskAndPublish();
+
+    for (int id = 0; halfHoleEntered != 0; ++id) {
+        if (halfHoleEntered & (1u << id)) {
+            halfHoleEntered &= ~(1u << id);
+            publishHalfHole(id);
         }
+    }
+}
+
+/**
+ * @brief Выдержка: новое состояние принимается, только если продержалось dwell значений подряд.
+ * @return true, если candidate нужно принять (счетчик сбрасывается вызывающим).
+ */
+template <typename State>
+static bool dwellElapsed(State candidate, State current, State& pending, uint16_t& count, int dwell) {
+    if (candidate == current) {
+        count = 0;
+        return false;
+    }
+    if (count == 0 || candidate != pending) {
+        pending = candidate;
+        count = 0;
+    }
+    if (count < 0xFFFF) ++count;
+    return count >= dwell;
+}
+
+/**
+ * @brief Логика сенсора Mute.
+ */
+void AppLogic::processMuteValue(int value) {
+    const bool raw = (value > m_muteThreshold);
+    if (raw != m_muteRaw) {
+        m_muteRaw = raw;
+        ++m_rawTransitions;
+    }
+
+    // Триггер Шмитта: включается выше порога, выключается только ниже (порог - гистерезис)
+    const bool candidate = m_isMuted ? (value > m_muteThreshold - m_hysteresis) : raw;
+    if (!dwellElapsed(candidate, m_isMuted, m_mutePending, m_mutePendingCount, m_dwellSamples)) return;
+    m_mutePendingCount = 0;
+    ++m_transitions;
+
+    m_isMuted = candidate;
+    // Публикуем событие изменения состояния Mute
+    if (m_isMuted) {
+        publish<EventType::MUTE_ENABLED>(EmptyPayload{});
+    } else {
+        publish<EventType::MUTE_DISABLED>(EmptyPayload{});
+    }
+
+    #if defined(NATIVE_TEST)
+    std::cout << "[AppLogic] Mute changed: " << m_isMuted << std::endl;
+    #endif
+}
+
+/**
+ * @brief Сбрасывает полосы. Полоса - позиция в hole_sensor_ids; таблица m_laneOfId заменяет
+ * поиск по списку на каждом значении.
+ */
+void AppLogic::resetLanes(size_t historySize) {
+    HoleSensorLanes& lanes = m_lanes;
+    for (int id = 0; id < MAX_SENSOR_IDS; ++id) m_laneOfId[id] = -1;
 
-        // --- C. Определение Состояния (3 ступени) ---
-        // Сравниваем значение с порогами из конфига
-        if (value > m_holeClosedThreshold) {
-            newState = SensorState::CLOSED;
-        } else if (value > m_halfHoleThreshold) {
-            newState = SensorState::HALF_HOLE;
+    lanes.count = m_holeSensorIds.size() < MAX_HOLE_SENSORS ? m_holeSensorIds.size() : MAX_HOLE_SENSORS;
+    if (m_holeSensorIds.size() > MAX_HOLE_SENSORS) {
+        LOG_WARN(TAG, "hole_sensor_ids: only the first %u sensors form the mask", (unsigned)MAX_HOLE_SENSORS);
+    }
+    lanes.live = 0;
+    lanes.closed = 0;
+    lanes.held = 0;
+    lanes.rawClosed = 0;
+    lanes.rawHeld = 0;
+    lanes.pending = 0;
+    lanes.predicted = 0;
+
+    for (size_t lane = 0; lane < MAX_HOLE_SENSORS; ++lane) {
+        const int id = lane < lanes.count ? m_holeSensorIds[lane] : -1;
+        lanes.id[lane] = id;
+        lanes.values[lane] = 0;
+        lanes.closedThreshold[lane] = m_holeClosedThreshold;
+        lanes.halfThreshold[lane] = m_halfHoleThreshold;
+        lanes.state[lane] = SensorState::OPEN;
+        lanes.pendingState[lane] = SensorState::OPEN;
+        lanes.pendingCount[lane] = 0;
+        lanes.predictedFrom[lane] = SensorState::OPEN;
+        lanes.predictAge[lane] = 0;
+        lanes.baseline[lane] = m_defaultBaseline;
+        lanes.closedPeak[lane] = m_defaultBaseline + m_defaultRange;
+        lanes.calibrationSum[lane] = 0;
+        lanes.calibrationLeft[lane] = m_adaptive ? m_calibrationSamples : 0;
+        lanes.history[lane].setCapacity(historySize);
+        refreshLaneLevels(lane);
+
+        // Повтор ID: бит маски - первая позиция (как при поиске по списку); Mute - не игровой
+        if (id >= 0 && id < MAX_SENSOR_IDS && id != m_muteSensorId && m_laneOfId[id] < 0) {
+            m_laneOfId[id] = (int8_t)lane;
+            lanes.live |= 1u << lane;
+        }
+    }
+}
+
+/**
+ * @brief Триггер Шмитта на два порога: вверх - строго выше порога (как раньше),
+ * вниз - только ниже (порог - threshold_hysteresis) того уровня, в котором сенсор сейчас.
+ * Пороги пересчитываются при смене состояния, а не на каждом значении.
+ */
+void AppLogic::refreshLaneLevels(size_t lane) {
+    HoleSensorLanes& lanes = m_lanes;
+    const SensorState basis = (lanes.predicted & (1u << lane)) ? lanes.predictedFrom[lane] : lanes.state[lane];
+    lanes.closedLevel[lane] = lanes.closedThreshold[lane] - (basis == SensorState::CLOSED ? m_hysteresis : 0);
+    lanes.halfLevel[lane] = lanes.halfThreshold[lane] - (basis != SensorState::OPEN ? m_hysteresis : 0);
+}
+
+void AppLogic::setLaneState(size_t lane, SensorState state) {
+    const uint32_t bit = 1u << lane;
+    m_lanes.state[lane] = state;
+    m_lanes.closed = state == SensorState::CLOSED ? (m_lanes.closed | bit) : (m_lanes.closed & ~bit);
+    m_lanes.held = state != SensorState::OPEN ? (m_lanes.held | bit) : (m_lanes.held & ~bit);
+    refreshLaneLevels(lane);
+}
+
+SensorState AppLogic::holeState(int id) const {
+    const int lane = id >= 0 && id < MAX_SENSOR_IDS ? m_laneOfId[id] : -1;
+    return lane >= 0 ? m_lanes.state[lane] : SensorState::OPEN;
+}
+
+/**
+ * @brief Калибровка: среднее первых baseline_calibration_ms значений (отверстие открыто).
+ * Затем база следует за значением, только пока отверстие уверенно открыто (ниже середины
+ * между базой и порогом полузакрытия, без выдержки и предсказания), а уровень закрытия -
+ * пока уверенно закрыто. Палец, медленно подходящий к отверстию, базу не тянет.
+ */
+void AppLogic::adaptLaneThresholds(size_t lane, int sample) {
+    HoleSensorLanes& lanes = m_lanes;
+    const uint32_t bit = 1u << lane;
+
+    if (lanes.calibrationLeft[lane] > 0) {
+        lanes.calibrationSum[lane] += (uint32_t)sample;
+        if (--lanes.calibrationLeft[lane] > 0) return;
+
+        const float mean = (float)lanes.calibrationSum[lane] / (float)m_calibrationSamples;
+        if (mean < (float)m_halfHoleThreshold) {
+            lanes.baseline[lane] = mean;
+            lanes.closedPeak[lane] = mean + m_defaultRange;
         } else {
-            newState = SensorState::OPEN;
+            // Палец на отверстии при старте - остаются база и размах по умолчанию
+            LOG_WARN(TAG, "Sensor %d not open during calibration (mean %d), using global thresholds",
+                     lanes.id[lane], (int)mean);
         }
+        applyLaneThresholds(lane);
+        return;
+    }
 
-        // --- D. Обработка изменения состояния ---
-        if (newState != oldState) {
-            ctx.state = newState;
-
-            #if defined(NATIVE_TEST)
-            std::cout << "[AppLogic] Sensor " << id << " state: " << (int)newState << std::endl;
-            #endif
-
-            // !!! ИСПРАВЛЕНИЕ ПОРЯДКА СОБЫТИЙ !!!
-            // Сначала обновляем МАСКУ. Это сбросит старое состояние Half-Hole в AppFingering.
-            // Затем отправляем НОВОЕ событие Half-Hole (если оно есть).
-            // Если сделать наоборот, маска перезапишет (сбросит) только что установленный Half-Hole.
-            
-            // 1. Обновляем маску (в любом случае)
-            updateMaskAndPublish();
-
-            // 2. Если перешли в состояние ПОЛУЗАКРЫТИЯ -> Публикуем специальное событие
-            if (newState == SensorState::HALF_HOLE) {
-                Event ev(EventType::HALF_HOLE_DETECTED, HalfHolePayload{id});
-                m_dispatcher->postEvent(ev);
-            }
+    if ((lanes.pending | lanes.predicted) & bit) return;
+
+    if (lanes.state[lane] == SensorState::OPEN) {
+        const float confident = lanes.baseline[lane] + 0.5f * ((float)lanes.halfThreshold[lane] - lanes.baseline[lane]);
+        if ((float)sample > confident) return;
+        // Дрейф сдвигает отклик целиком: уровень закрытия - вместе с базой, размах сохраняется
+        const float drift = m_driftAlpha * ((float)sample - lanes.baseline[lane]);
+        lanes.baseline[lane] += drift;
+        lanes.closedPeak[lane] += drift;
+    } else if (lanes.state[lane] == SensorState::CLOSED && sample > lanes.closedThreshold[lane]) {
+        lanes.closedPeak[lane] += m_driftAlpha * ((float)sample - lanes.closedPeak[lane]);
+    } else {
+        return;
+    }
+    applyLaneThresholds(lane);
+}
+
+/**
+ * @brief Размах не меньше половины размаха по умолчанию: пороги не сжимаются в шум,
+ * если отверстие долго не закрывали.
+ */
+float AppLogic::laneRange(size_t lane) const {
+    const float range = m_lanes.closedPeak[lane] - m_lanes.baseline[lane];
+    const float minRange = 0.5f * m_defaultRange;
+    return range > minRange ? range : minRange;
+}
+
+void AppLogic::applyLaneThresholds(size_t lane) {
+    const float range = laneRange(lane);
+    m_lanes.closedThreshold[lane] = (int32_t)std::lround(m_lanes.baseline[lane] + m_closedRatio * range);
+    m_lanes.halfThreshold[lane] = (int32_t)std::lround(m_lanes.baseline[lane] + m_halfRatio * range);
+    refreshLaneLevels(lane);
+}
+
+bool AppLogic::getSensorCalibration(int id, SensorCalibration& out) const {
+    const int lane = id >= 0 && id < MAX_SENSOR_IDS ? m_laneOfId[id] : -1;
+    if (lane < 0) return false;
+
+    out.calibrated = m_adaptive && m_lanes.calibrationLeft[lane] == 0;
+    out.baseline = m_adaptive ? m_lanes.baseline[lane] : 0.0f;
+    out.range = m_adaptive ? laneRange((size_t)lane) : 0.0f;
+    out.closedThreshold = m_lanes.closedThreshold[lane];
+    out.halfThreshold = m_lanes.halfThreshold[lane];
+    return true;
+}
+
+void AppLogic::trackRawStates(const SensorFrameKernel::Bits& raw, uint32_t lanes) {
+    const uint32_t changed = ((raw.closed ^ m_lanes.rawClosed) | (raw.held ^ m_lanes.rawHeld)) & lanes;
+    m_rawTransitions += (uint32_t)__builtin_popcount(changed);
+    m_lanes.rawClosed = (m_lanes.rawClosed & ~lanes) | (raw.closed & lanes);
+    m_lanes.rawHeld = (m_lanes.rawHeld & ~lanes) | (raw.held & lanes);
+}
+
+/**
+ * @brief Экстраполяция v(t) = v + slope * t + acc * t^2 / 2 на горизонт m_predictSamples.
+ * При замедлении (acc < 0) берется вершина параболы, если она ближе горизонта:
+ * EMA-фильтр подходит к новому уровню именно так.
+ */
+bool AppLogic::predictsClosing(const SensorHistory::View& history, int32_t closedThreshold) const {
+    const size_t n = history.size();
+    if (n < 3) return false;
+
+    const float v0 = history[n - 1];
+    const float slope = v0 - (float)history[n - 2];
+    const float acc = slope - ((float)history[n - 2] - (float)history[n - 3]);
+    if (slope <= 0.0f) return false;
+
+    float t = (float)m_predictSamples;
+    if (acc < 0.0f && slope / -acc < t) t = slope / -acc;
+    return v0 + slope * t + 0.5f * acc * t * t > (float)closedThreshold;
+}
+
+/**
+ * @brief История и вибрато полосы: окно фиксированной емкости, статистика обновляется за O(1).
+ */
+void AppLogic::recordLaneValue(size_t lane, int value) {
+    HoleSensorLanes& lanes = m_lanes;
+    SensorHistory& history = lanes.history[lane];
+
+    // --- A. Сбор истории для Вибрато ---
+    const uint16_t sample = (uint16_t)(value < 0 ? 0 : (value > 0xFFFF ? 0xFFFF : value));
+    lanes.values[lane] = sample;
+    if (m_vibratoDetector == VibratoDetector::GOERTZEL) {
+        // Значение, покидающее окно бинов (до push - оно еще в истории)
+        const SensorHistory::View window = history.view();
+        const size_t size = m_vibratoBank.windowSize();
+        const int evicted = window.size() >= size ? window[window.size() - size] : 0;
+        m_vibratoBank.update(lanes.vibratoBins[lane], sample, evicted);
+    }
+    history.push(sample);
+
+    // Пороги полосы - до классификации этого значения
+    if (m_adaptive) adaptLaneThresholds(lane, sample);
+
+    // --- B. Анализ Вибрато ---
+    // Zero-crossing: запускаем анализ, только если набрали достаточно данных (половина буфера).
+    // Goertzel: решение на каждом значении, как только заполнено (более короткое) окно бинов.
+    float vibratoDepth = 0.0f;
+    if (m_vibratoDetector == VibratoDetector::GOERTZEL) {
+        vibratoDepth = analyzeVibratoBins(lanes.vibratoBins[lane]);
+    } else if (history.size() >= history.capacity() / 2) {
+        vibratoDepth = analyzeVibrato(history);
+    }
+
+    if (vibratoDepth > 0.0f) {
+        // Вибрато обнаружено -> Публикуем событие
+        publish<EventType::VIBRATO_DETECTED>(VibratoPayload{lanes.id[lane], vibratoDepth});
+    }
+}
+
+/**
+ * @brief Автомат состояний полосы (3 ступени).
+ */
+bool AppLogic::stepLane(size_t lane, SensorState classified) {
+    HoleSensorLanes& lanes = m_lanes;
+    const uint32_t bit = 1u << lane;
+    const SensorState oldState = lanes.state[lane];
+
+    // --- C. Предсказание закрытия (predict_onset_ms) ---
+    if (lanes.predicted & bit) {
+        // classified - относительно состояния до предсказания (refreshLaneLevels)
+        ++lanes.predictAge[lane];
+        if (classified == SensorState::CLOSED) {
+            // Подтверждено: CLOSED уже опубликован, выигрыш - время от предсказания до порога
+            lanes.predicted &= ~bit;
+            refreshLaneLevels(lane);
+            ++m_predictionStats.confirmed;
+            m_predictionStats.totalLeadMs += (uint32_t)lanes.predictAge[lane] * 1000u / (uint32_t)m_sampleRateHz;
+            return false;
         }
+
+        const SensorHistory::View history = lanes.history[lane].view();
+        const bool falling = history.size() >= 2 && history[history.size() - 1] < history[history.size() - 2];
+        if (lanes.predictAge[lane] < m_predictSamples && !falling) return false;
+
+        // Горизонт истек или палец пошел назад - коррекция маски
+        lanes.predicted &= ~bit;
+        ++m_predictionStats.corrected;
+        lanes.pendingCount[lane] = 0;
+        lanes.pending &= ~bit;
+        ++m_transitions;
+        setLaneState(lane, classified);
+        return true;
+    }
+
+    if (m_predictSamples > 0 && classified != SensorState::CLOSED && oldState != SensorState::CLOSED &&
+        predictsClosing(lanes.history[lane].view(), lanes.closedThreshold[lane])) {
+        // Объявляем закрытие раньше порога (без выдержки - цель именно в задержке)
+        lanes.predicted |= bit;
+        lanes.predictedFrom[lane] = oldState;
+        lanes.predictAge[lane] = 0;
+        ++m_predictionStats.predictions;
+        lanes.pendingCount[lane] = 0;
+        lanes.pending &= ~bit;
+        ++m_transitions;
+        setLaneState(lane, SensorState::CLOSED);
+        return true;
+    }
+
+    // --- D. Обработка изменения состояния ---
+    // Новое состояние должно продержаться state_dwell_samples значений подряд
+    const bool accepted = dwellElapsed(classified, oldState, lanes.pendingState[lane], lanes.pendingCount[lane],
+                                       m_dwellSamples);
+    if (!accepted) {
+        lanes.pending = lanes.pendingCount[lane] > 0 ? (lanes.pending | bit) : (lanes.pending & ~bit);
+        return false;
     }
+    lanes.pendingCount[lane] = 0;
+    lanes.pending &= ~bit;
+    ++m_transitions;
+
+    setLaneState(lane, classified);
+
+    #if defined(NATIVE_TEST)
+    std::cout << "[AppLogic] Sensor " << lanes.id[lane] << " state: " << (int)classified << std::endl;
+    #endif
+
+    return true;
+}
+
+/**
+ * @brief Обработка значения игрового сенсора: история, вибрато, состояние.
+ * @return true, если состояние сенсора (OPEN/HALF/CLOSED) изменилось.
+ */
+bool AppLogic::processHoleValue(int id, int value) {
+    // Полоса (= битовый индекс маски) по таблице; -1 - сенсор не игровой или ID невалиден
+    const int lane = id >= 0 && id < MAX_SENSOR_IDS ? m_laneOfId[id] : -1;
+    if (lane < 0) return false;
+
+    recordLaneValue((size_t)lane, value);
+
+    // Одна полоса - скалярное сравнение с ее порогами
+    const int32_t sample = m_lanes.values[lane];
+    const uint32_t bit = 1u << lane;
+    SensorFrameKernel::Bits raw = {0, 0};
+    if (sample > m_lanes.closedThreshold[lane]) raw.closed = bit;
+    if (sample > m_lanes.halfThreshold[lane]) raw.held = bit;
+    raw.held |= raw.closed;
+    trackRawStates(raw, bit);
+
+    const SensorState classified = sample > m_lanes.closedLevel[lane] ? SensorState::CLOSED
+                                 : sample > m_lanes.halfLevel[lane]   ? SensorState::HALF_HOLE
+                                                                      : SensorState::OPEN;
+    return stepLane((size_t)lane, classified);
 }
 
 /**
  * @brief Собирает битовую маску из состояний всех сенсоров и публикует, если она изменилась.
  */
 void AppLogic::updateMaskAndPublish() {
-    uint8_t newMask = 0;
-    
-    // Проходим по всем игровым сенсорам в порядке, заданном в конфиге
-    for (size_t i = 0; i < m_holeSensorIds.size(); ++i) {
-        int id = m_holeSensorIds[i];
-        
-        // Проверка выхода за границы массива
-        if (id >= 16) continue;
-
-        // !!! КРИТИЧЕСКОЕ ИСПРАВЛЕНИЕ ЛОГИКИ !!!
-        // Для формирования базовой маски мы считаем отверстие "ЗАКРЫТЫМ" (бит = 1),
-        // если оно находится в состоянии CLOSED *ИЛИ* HALF_HOLE.
-        //
-        // Это необходимо, чтобы AppFingering мог сначала найти базовую ноту
-        // (соответствующую закрытому отверстию), а затем применить к ней
-        // модификатор "Half-Hole", если он активен.
-        //
-        // Если мы не включим HALF_HOLE в маску, AppFingering увидит "открытое" отверстие
-        // и выберет другую ноту, игнорируя правило полузакрытия.
-        if (m_sensorContexts[id].state == SensorState::CLOSED || 
-            m_sensorContexts[id].state == SensorState::HALF_HOLE) {
-            newMask |= (1 << i); 
-        }
+    // Бит маски - полоса (порядок hole_sensor_ids), установлен для CLOSED *И* HALF_HOLE:
+    // AppFingering сначала находит базовую ноту (отверстие закрыто), затем применяет к ней
+    // модификатор "Half-Hole". Без HALF_HOLE в маске он увидел бы "открытое" отверстие.
+    const HoleMask newMask = (HoleMask)m_lanes.held;
+
+    // Публикуем только изменившуюся маску - сразу или после выдержки (mask_settle_ms)
+    settleMask(newMask);
+}
+
+/**
+ * @brief Выдержка маски: пальцы при смене аккорда пересекают пороги с разницей в несколько
+ * значений, и каждая промежуточная маска дала бы короткую неверную ноту.
+ */
+void AppLogic::settleMask(HoleMask newMask) {
+    if (m_maskPending) {
+        if (newMask == m_pendingMask) return;
+        // Промежуточная маска так и не простояла выдержку - нота-"глитч" подавлена
+        m_maskPending = false;
+        ++m_settleStats.suppressedMasks;
     }
 
-    // Публикуем событие только если маска действительно изменилась
-    if (newMask != m_currentMask) {
-        m_currentMask = newMask;
-        Event ev(EventType::SENSOR_MASK_CHANGED, SensorMaskPayload{newMask});
-        m_dispatcher->postEvent(ev);
-        
+    if (newMask == m_currentMask) {
+        // Пальцы вернулись к опубликованной маске - отложенное полузакрытие больше не ждет
+        commitMask(newMask);
+        return;
+    }
+
+    const HoleMask changed = (HoleMask)(newMask ^ m_currentMask);
+    const bool singleBit = (changed & (changed - 1)) == 0;
+    const bool known = m_knownMasks.count(newMask) != 0;
+    if (m_maskSettleMs <= 0 || (singleBit && known)) {
+        ++m_settleStats.immediateMasks;
+        commitMask(newMask);
+        return;
+    }
+
+    m_maskPending = true;
+    m_pendingMask = newMask;
+    m_pendingSinceMs = m_dispatcher->nowMs();
+}
+
+void AppLogic::pollMaskSettle() {
+    if (!m_maskPending) return;
+
+    const uint32_t held = m_dispatcher->nowMs() - m_pendingSinceMs;
+    if (held < (uint32_t)m_maskSettleMs) return;
+
+    m_maskPending = false;
+    ++m_settleStats.heldMasks;
+    m_settleStats.totalDelayMs += held;
+    if (held > m_settleStats.maxDelayMs) m_settleStats.maxDelayMs = held;
+    commitMask(m_pendingMask);
+}
+
+void AppLogic::commitMask(HoleMask mask) {
+    if (mask != m_currentMask) {
+        m_currentMask = mask;
+        // fused_pipeline: нота выбирается и уходит в MIDI прямо здесь, событие - наблюдателям
+        publish<EventType::SENSOR_MASK_CHANGED>(SensorMaskPayload{mask});
+
         #if defined(NATIVE_TEST)
-        std::cout << "[AppLogic] Mask changed: " << (int)newMask << std::endl;
+        std::cout << "[AppLogic] Mask changed: " << (unsigned long)mask << std::endl;
         #endif
     }
+
+    // Полузакрытие после маски: маска сбрасывает его в AppFingering
+    for (int id = 0; m_deferredHalfHoles != 0; ++id) {
+        if (m_deferredHalfHoles & (1u << id)) {
+            m_deferredHalfHoles &= ~(1u << id);
+            if (holeState(id) == SensorState::HALF_HOLE) {
+                publish<EventType::HALF_HOLE_DETECTED>(HalfHolePayload{id});
+            }
+        }
+    }
+}
+
+void AppLogic::publishHalfHole(int id) {
+    if (m_maskPending) {
+        m_deferredHalfHoles |= (1u << id);
+        return;
+    }
+    publish<EventType::HALF_HOLE_DETECTED>(HalfHolePayload{id});
 }
 
 /**
  * @brief Алгоритм Zero-Crossing для детекции частоты вибрато.
- * Анализирует историю значений сенсора.
+ * Статистика (min/max/сумма/пересечения) ведется окном инкрементально - без прохода по истории.
  */
-float AppLogic::analyzeVibrato(const std::vector<int>& history) {
+float AppLogic::analyzeVibrato(SensorHistory& history) {
     if (history.empty()) return 0.0f;
 
-    // 1. Находим Min/Max (Амплитуду сигнала)
-    int minVal = 4096;
-    int maxVal = 0;
-    long sum = 0;
-
-    for (int v : history) {
-        if (v < minVal) minVal = v;
-        if (v > maxVal) maxVal = v;
-        sum += v;
-    }
+    // 1. Min/Max (Амплитуда сигнала).
+    // Начальные значения прежнего полного прохода (4096/0) сохранены: решения не меняются.
+    int minVal = history.minValue() < 4096 ? history.minValue() : 4096;
+    int maxVal = history.maxValue();
 
     int amplitude = maxVal - minVal;
     
@@ -325,21 +877,8 @@ float AppLogic::analyzeVibrato(const std::vector<int>& history) {
         return 0.0f;
     }
 
-    // 2. Считаем среднее значение (DC offset)
-    int avg = sum / history.size();
-
-    // 3. Считаем количество пересечений среднего значения (Zero Crossings)
-    int crossings = 0;
-    bool above = (history[0] > avg);
-
-    for (size_t i = 1; i < history.size(); ++i) {
-        bool nowAbove = (history[i] > avg);
-        // Если сигнал пересек среднюю линию
-        if (nowAbove != above) {
-            crossings++;
-            above = nowAbove;
-        }
-    }
+    // 2-3. Количество пересечений среднего значения (DC offset) - Zero Crossings
+    int crossings = history.crossings();
 
     // 4. Вычисляем частоту
     // Частота = (Количество пересечений / 2) / Длительность выборки
@@ -364,4 +903,13 @@ float AppLogic::analyzeVibrato(const std::vector<int>& history) {
     }
 
     return 0.0f;
+}
+
+/**
+ * @brief Детекция вибрато банком скользящих бинов DFT.
+ * Частота - доминирующий бин полосы vibrato_freq_min_hz..max_hz; глубина - по его амплитуде.
+ */
+float AppLogic::analyzeVibratoBins(const SlidingDftBank::State& bins) {
+    SlidingDftBank::Result result = m_vibratoBank.analyze(bins, m_vibratoAmplitudeMin);
+    return result.detected ? result.depth : 0.0f;
 }
\ No newline at end of file
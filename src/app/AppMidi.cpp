@@ -19,7 +19,8 @@ AppMidi::AppMidi()
       m_halLed(nullptr),
       m_currentNote(0),
       m_isMuted(false),
-      m_basePitchHz(440.0f) {
+      m_basePitchHz(440.0f),
+      m_fusedMode(false) {
 }
 
 bool AppMidi::init(IHalBle* halBle, IHalLed* halLed, float basePitchHz) {
@@ -34,13 +35,22 @@ bool AppMidi::init(IHalBle* halBle, IHalLed* halLed, float basePitchHz) {
     return true;
 }
 
+void AppMidi::setFusedMode(bool fused) {
+    m_fusedMode = fused;
+}
+
 void AppMidi::subscribe(EventDispatcher* dispatcher) {
     if (dispatcher) {
+        dispatcher->subscribe(EventType::BLE_CONNECTED, this);
+
+        // В режиме fused_pipeline остальное приходит прямыми вызовами из AppLogic/AppFingering.
+        // Подписка на эти же события привела бы к двойной обработке.
+        if (m_fusedMode) return;
+
         dispatcher->subscribe(EventType::NOTE_PITCH_SELECTED, this);
         dispatcher->subscribe(EventType::VIBRATO_DETECTED, this);
         dispatcher->subscribe(EventType::MUTE_ENABLED, this);
         dispatcher->subscribe(EventType::MUTE_DISABLED, this);
-        dispatcher->subscribe(EventType::BLE_CONNECTED, this);
     }
 }
 
@@ -60,49 +70,59 @@ void AppMidi::handleEvent(const Event& event) {
              break;
         }
 
-        case EventType::NOTE_PITCH_SELECTED: {
-            int newNote = event.payload.notePitch.pitch;
-            handleNoteChange(newNote);
+        case EventType::NOTE_PITCH_SELECTED:
+            onNoteSelected(event.payload.notePitch.pitch);
             break;
-        }
 
-        case EventType::VIBRATO_DETECTED: {
-            if (m_isMuted) return;
-            // Пропускаем вибрато, если HAL не инициализирован
-            if (m_halBle) {
-                float depth = event.payload.vibrato.depth;
-                m_halBle->sendPitchBend(depth);
-                
-                #if defined(NATIVE_TEST)
-                std::cout << "[AppMidi] PitchBend: " << depth << std::endl;
-                #endif
-            }
+        case EventType::VIBRATO_DETECTED:
+            onVibrato(event.payload.vibrato.depth);
             break;
-        }
 
-        case EventType::MUTE_ENABLED: {
-            m_isMuted = true;
-            // Срочно выключаем текущую ноту
-            handleNoteChange(0); 
-            // И посылаем "Panic" (All Notes Off) для надежности
-            if (m_halBle) {
-                m_halBle->sendAllNotesOff();
-            }
-            LOG_INFO(TAG, "Mute Enabled");
+        case EventType::MUTE_ENABLED:
+            onMuteChanged(true);
             break;
-        }
 
-        case EventType::MUTE_DISABLED: {
-            m_isMuted = false;
-            LOG_INFO(TAG, "Mute Disabled");
+        case EventType::MUTE_DISABLED:
+            onMuteChanged(false);
             break;
-        }
 
         default:
             break;
     }
 }
 
+void AppMidi::onNoteSelected(int note) {
+    handleNoteChange(note);
+}
+
+void AppMidi::onVibrato(float depth) {
+    if (m_isMuted) return;
+    // Пропускаем вибрато, если HAL не инициализирован
+    if (m_halBle) {
+        m_halBle->sendPitchBend(depth);
+
+        #if defined(NATIVE_TEST)
+        std::cout << "[AppMidi] PitchBend: " << depth << std::endl;
+        #endif
+    }
+}
+
+void AppMidi::onMuteChanged(bool muted) {
+    if (muted) {
+        m_isMuted = true;
+        // Срочно выключаем текущую ноту
+        handleNoteChange(0);
+        // И посылаем "Panic" (All Notes Off) для надежности
+        if (m_halBle) {
+            m_halBle->sendAllNotesOff();
+        }
+        LOG_INFO(TAG, "Mute Enabled");
+    } else {
+        m_isMuted = false;
+        LOG_INFO(TAG, "Mute Disabled");
+    }
+}
+
 void AppMidi::handleNoteChange(int newNote) {
     // Если включен Mute, мы можем только ВЫКЛЮЧАТЬ ноты (newNote=0),
     // но не включать новые.
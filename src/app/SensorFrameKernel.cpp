@@ -0,0 +1,117 @@
+/*
+ * SensorFrameKernel.cpp
+ *
+ * Векторное сравнение значений кадра с порогами.
+ *
+ * ESP32-S3: расширение PIE (128-битные регистры q0..q7) доступно только ассемблерными вставками.
+ * EE.VLD.128.IP требует выравнивания по 16 байт (младшие биты адреса игнорируются), поэтому
+ * невыровненные массивы уходят в скалярный вариант. Аналога movemask в PIE нет: результаты
+ * EE.VCMP.GT.S32 (0 / -1 на полосу) сохраняются в выровненный буфер и собираются в биты.
+ *
+ * Соответствует: docs/modules/app_logic.md
+ */
+#include "app/SensorFrameKernel.h"
+
+#if !defined(ESP32_TARGET) && defined(__AVX2__)
+    #include <immintrin.h>
+    #define SENSOR_KERNEL_AVX2 1
+#elif !defined(ESP32_TARGET) && defined(__SSE2__)
+    #include <emmintrin.h>
+    #define SENSOR_KERNEL_SSE2 1
+#elif defined(ESP32_TARGET)
+    #include <sdkconfig.h>
+    #if defined(CONFIG_IDF_TARGET_ESP32S3)
+        #define SENSOR_KERNEL_PIE 1
+    #endif
+#endif
+
+static uint32_t laneMask(size_t lanes) {
+    if (lanes > SensorFrameKernel::MAX_LANES) lanes = SensorFrameKernel::MAX_LANES;
+    return (1u << lanes) - 1;
+}
+
+SensorFrameKernel::Bits SensorFrameKernel::classifyScalar(const int32_t* values, const int32_t* closedLevels,
+                                                          const int32_t* halfLevels, size_t lanes) {
+    Bits bits = {0, 0};
+    if (lanes > MAX_LANES) lanes = MAX_LANES;
+    for (size_t i = 0; i < lanes; ++i) {
+        bits.closed |= (uint32_t)(values[i] > closedLevels[i]) << i;
+        bits.held |= (uint32_t)(values[i] > halfLevels[i]) << i;
+    }
+    bits.held |= bits.closed;
+    return bits;
+}
+
+SensorFrameKernel::Bits SensorFrameKernel::classify(const int32_t* values, const int32_t* closedLevels,
+                                                    const int32_t* halfLevels, size_t lanes) {
+#if defined(SENSOR_KERNEL_AVX2)
+    Bits bits = {0, 0};
+    const uint32_t mask = laneMask(lanes);
+    for (size_t i = 0; i < lanes && i < MAX_LANES; i += 8) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(values + i));
+        const __m256i closed = _mm256_cmpgt_epi32(v, _mm256_loadu_si256((const __m256i*)(closedLevels + i)));
+        const __m256i half = _mm256_cmpgt_epi32(v, _mm256_loadu_si256((const __m256i*)(halfLevels + i)));
+        bits.closed |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(closed)) << i;
+        bits.held |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(half)) << i;
+    }
+    bits.closed &= mask;
+    bits.held = (bits.held & mask) | bits.closed;
+    return bits;
+#elif defined(SENSOR_KERNEL_SSE2)
+    Bits bits = {0, 0};
+    const uint32_t mask = laneMask(lanes);
+    for (size_t i = 0; i < lanes && i < MAX_LANES; i += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(values + i));
+        const __m128i closed = _mm_cmpgt_epi32(v, _mm_loadu_si128((const __m128i*)(closedLevels + i)));
+        const __m128i half = _mm_cmpgt_epi32(v, _mm_loadu_si128((const __m128i*)(halfLevels + i)));
+        bits.closed |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(closed)) << i;
+        bits.held |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(half)) << i;
+    }
+    bits.closed &= mask;
+    bits.held = (bits.held & mask) | bits.closed;
+    return bits;
+#elif defined(SENSOR_KERNEL_PIE)
+    if (((uintptr_t)values | (uintptr_t)closedLevels | (uintptr_t)halfLevels) & 15) {
+        return classifyScalar(values, closedLevels, halfLevels, lanes);
+    }
+    Bits bits = {0, 0};
+    const uint32_t mask = laneMask(lanes);
+    alignas(16) int32_t flags[8]; // [0..3] - closed, [4..7] - half (0 или -1 на полосу)
+    for (size_t i = 0; i < lanes && i < MAX_LANES; i += 4) {
+        const int32_t* v = values + i;
+        const int32_t* c = closedLevels + i;
+        const int32_t* h = halfLevels + i;
+        int32_t* out = flags;
+        asm volatile(
+            "ee.vld.128.ip q0, %[v], 0\n"
+            "ee.vld.128.ip q1, %[c], 0\n"
+            "ee.vld.128.ip q2, %[h], 0\n"
+            "ee.vcmp.gt.s32 q3, q0, q1\n"
+            "ee.vcmp.gt.s32 q4, q0, q2\n"
+            "ee.vst.128.ip q3, %[out], 16\n"
+            "ee.vst.128.ip q4, %[out], 16\n"
+            : [v] "+r"(v), [c] "+r"(c), [h] "+r"(h), [out] "+r"(out)
+            :
+            : "memory");
+        bits.closed |= (uint32_t)((flags[0] & 1) | (flags[1] & 2) | (flags[2] & 4) | (flags[3] & 8)) << i;
+        bits.held |= (uint32_t)((flags[4] & 1) | (flags[5] & 2) | (flags[6] & 4) | (flags[7] & 8)) << i;
+    }
+    bits.closed &= mask;
+    bits.held = (bits.held & mask) | bits.closed;
+    return bits;
+#else
+    return classifyScalar(values, closedLevels, halfLevels, lanes);
+#endif
+}
+
+const char* SensorFrameKernel::implementation() {
+#if defined(SENSOR_KERNEL_AVX2)
+    return "avx2";
+#elif defined(SENSOR_KERNEL_SSE2)
+    return "sse2";
+#elif defined(SENSOR_KERNEL_PIE)
+    return "pie";
+#else
+    return "scalar";
+#endif
+}
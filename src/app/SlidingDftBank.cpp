@@ -0,0 +1,158 @@
+/*
+ * SlidingDftBank.cpp
+ *
+ * Банк скользящих бинов DFT для детекции вибрато.
+ * Бин k хранит S(n) = sum_{m=0}^{N-1} x(n-m) * z^(m+1), z = r * e^{jw}, и обновляется рекурсией
+ *   S(n) = z * (S(n-1) + x(n) - z^N * x(n-N)),
+ * поэтому частоты бинов не обязаны быть кратны fs / N.
+ *
+ * Соответствует: docs/modules/app_logic.md
+ */
+#include "app/SlidingDftBank.h"
+#include <cmath>
+
+static const float PI_F = 3.14159265f;
+
+SlidingDftBank::SlidingDftBank()
+    : m_bins(),
+      m_bandCount(0),
+      m_binCount(0),
+      m_window(MIN_WINDOW),
+      m_gain(0.0f) {
+}
+
+void SlidingDftBank::configure(float sampleRateHz, float freqMinHz, float freqMaxHz, size_t windowSamples) {
+    m_window = windowSamples < MIN_WINDOW ? MIN_WINDOW : windowSamples;
+    m_bandCount = 0;
+    m_binCount = 0;
+
+    m_gain = 0.0f;
+    float damping = 1.0f;
+    for (size_t m = 0; m < m_window; ++m) {
+        damping *= DAMPING;
+        m_gain += damping;
+    }
+
+    if (sampleRateHz <= 0.0f) return;
+    const float nyquist = sampleRateHz / 2.0f;
+    if (freqMaxHz < freqMinHz) freqMaxHz = freqMinHz;
+
+    float freqs[MAX_BINS];
+    size_t bands = freqMaxHz > freqMinHz ? MAX_BANDS : 1;
+    size_t count = 0;
+    for (size_t i = 0; i < bands; ++i) {
+        float f = bands == 1 ? freqMinHz : freqMinHz + (freqMaxHz - freqMinHz) * (float)i / (float)(bands - 1);
+        if (f > 0.0f && f < nyquist) freqs[count++] = f;
+    }
+    m_bandCount = count;
+    if (m_bandCount == 0) return;
+
+    const float guards[GUARD_BINS] = {freqMinHz * 0.5f, freqMinHz * 0.75f, freqMaxHz * 1.15f};
+    for (float f : guards) {
+        if (f > 0.0f && f < nyquist) freqs[count++] = f;
+    }
+    m_binCount = count;
+
+    for (size_t k = 0; k < m_binCount; ++k) {
+        Bin& bin = m_bins[k];
+        const float w = 2.0f * PI_F * freqs[k] / sampleRateHz;
+        bin.freqHz = freqs[k];
+        bin.rotRe = DAMPING * std::cos(w);
+        bin.rotIm = DAMPING * std::sin(w);
+
+        // z^N и sum_{m=0}^{N-1} z^(m+1) - последовательным умножением (N <= сотни)
+        float powRe = 1.0f, powIm = 0.0f;
+        float dcRe = 0.0f, dcIm = 0.0f;
+        for (size_t m = 0; m < m_window; ++m) {
+            float re = powRe * bin.rotRe - powIm * bin.rotIm;
+            float im = powRe * bin.rotIm + powIm * bin.rotRe;
+            powRe = re;
+            powIm = im;
+            dcRe += powRe;
+            dcIm += powIm;
+        }
+        bin.tailRe = powRe;
+        bin.tailIm = powIm;
+        bin.dcRe = dcRe;
+        bin.dcIm = dcIm;
+    }
+}
+
+void SlidingDftBank::reset(State& state) const {
+    for (size_t k = 0; k < MAX_BINS; ++k) {
+        state.re[k] = 0.0f;
+        state.im[k] = 0.0f;
+    }
+    state.sum = 0;
+    state.sumSq = 0;
+    state.count = 0;
+}
+
+void SlidingDftBank::update(State& state, int value, int evicted) const {
+    if (state.count < m_window) {
+        evicted = 0;
+        ++state.count;
+    }
+    state.sum += value - evicted;
+    state.sumSq += (uint64_t)((int64_t)value * value) - (uint64_t)((int64_t)evicted * evicted);
+
+    const float x = (float)value;
+    const float old = (float)evicted;
+    for (size_t k = 0; k < m_binCount; ++k) {
+        const Bin& bin = m_bins[k];
+        const float re = state.re[k] + x - bin.tailRe * old;
+        const float im = state.im[k] - bin.tailIm * old;
+        state.re[k] = re * bin.rotRe - im * bin.rotIm;
+        state.im[k] = re * bin.rotIm + im * bin.rotRe;
+    }
+}
+
+SlidingDftBank::Result SlidingDftBank::analyze(const State& state, int amplitudeMin) const {
+    Result result = {false, 0.0f, 0.0f, 0, 0.0f};
+    if (state.count < m_window || m_bandCount == 0) return result;
+
+    const int64_t n = (int64_t)m_window;
+    // N^2 * дисперсия окна - в целых, без потери точности на большом DC
+    const int64_t acEnergy = n * (int64_t)state.sumSq - state.sum * state.sum;
+    if (acEnergy <= 0) return result;
+
+    const float mean = (float)state.sum / (float)n;
+    float power[MAX_BINS];
+    size_t best = 0;
+    float guardPower = 0.0f;
+    for (size_t k = 0; k < m_binCount; ++k) {
+        const float re = state.re[k] - mean * m_bins[k].dcRe;
+        const float im = state.im[k] - mean * m_bins[k].dcIm;
+        power[k] = re * re + im * im;
+        if (k < m_bandCount) {
+            if (power[k] > power[best]) best = k;
+        } else if (power[k] > guardPower) {
+            guardPower = power[k];
+        }
+    }
+
+    const float magnitude = std::sqrt(power[best]);
+    result.amplitude = (int)(4.0f * magnitude / m_gain);
+    result.tonality = 2.0f * power[best] * (float)(n * n) / (m_gain * m_gain * (float)acEnergy);
+    result.frequencyHz = m_bins[best].freqHz;
+
+    // Параболическая интерполяция по амплитудам соседних бинов полосы
+    if (best > 0 && best + 1 < m_bandCount) {
+        const float left = std::sqrt(power[best - 1]);
+        const float right = std::sqrt(power[best + 1]);
+        const float denom = left - 2.0f * magnitude + right;
+        if (denom < 0.0f) {
+            const float delta = 0.5f * (left - right) / denom;
+            result.frequencyHz += delta * (m_bins[best + 1].freqHz - m_bins[best].freqHz);
+        }
+    }
+
+    // Сторожевой бин сильнее полосы - энергия вне диапазона вибрато (ступенька, дрейф, дрожание)
+    if (guardPower > power[best]) return result;
+    if (result.tonality < MIN_TONALITY || result.amplitude < amplitudeMin) return result;
+
+    result.detected = true;
+    result.depth = (float)result.amplitude / 500.0f;
+    if (result.depth > 1.0f) result.depth = 1.0f;
+    return result;
+}
@@ -34,6 +34,24 @@ static std::vector<std::string> split(const std::string& str, char delimiter) {
     return tokens;
 }
 
+static bool parseBool(const std::string& str) {
+    return str == "true" || str == "1" || str == "yes" || str == "on";
+}
+
+static OverflowPolicy parsePolicy(const std::string& str, OverflowPolicy fallback) {
+    if (str == "block") return OverflowPolicy::BLOCK_TIMEOUT;
+    if (str == "drop_newest") return OverflowPolicy::DROP_NEWEST;
+    if (str == "drop_oldest") return OverflowPolicy::DROP_OLDEST;
+    if (str == "coalesce") return OverflowPolicy::COALESCE;
+    return fallback;
+}
+
+static VibratoDetector parseVibratoDetector(const std::string& str, VibratoDetector fallback) {
+    if (str == "zero_crossing") return VibratoDetector::ZERO_CROSSING;
+    if (str == "goertzel") return VibratoDetector::GOERTZEL;
+    return fallback;
+}
+
 // --- Конструктор ---
 
 ConfigManager::ConfigManager() {
@@ -73,15 +91,37 @@ int ConfigManager::getSampleRateHz() const { return m_sampleRateHz; }
 float ConfigManager::getFilterAlpha() const { return m_filterAlpha; }
 int ConfigManager::getMuteThreshold() const { return m_muteThreshold; }
 int ConfigManager::getHoleClosedThreshold() const { return m_holeClosedThreshold; }
+bool ConfigManager::getSensorFrameMode() const { return m_sensorFrameMode; }
+int ConfigManager::getThresholdHysteresis() const { return m_thresholdHysteresis; }
+int ConfigManager::getStateDwellSamples() const { return m_stateDwellSamples; }
+bool ConfigManager::getAdaptiveThresholds() const { return m_adaptiveThresholds; }
+float ConfigManager::getHoleClosedRatio() const { return m_holeClosedRatio; }
+float ConfigManager::getHalfHoleRatio() const { return m_halfHoleRatio; }
+int ConfigManager::getBaselineCalibrationMs() const { return m_baselineCalibrationMs; }
+int ConfigManager::getBaselineTauMs() const { return m_baselineTauMs; }
 
 int ConfigManager::getMuteSensorId() const { return m_muteSensorId; }
 const std::vector<int>& ConfigManager::getHoleSensorIds() const { return m_holeSensorIds; }
+bool ConfigManager::getFusedPipeline() const { return m_fusedPipeline; }
+int ConfigManager::getMaskSettleMs() const { return m_maskSettleMs; }
+int ConfigManager::getPredictOnsetMs() const { return m_predictOnsetMs; }
 
 float ConfigManager::getVibratoFreqMin() const { return m_vibratoFreqMin; }
 float ConfigManager::getVibratoFreqMax() const { return m_vibratoFreqMax; }
 int ConfigManager::getVibratoAmplitudeMin() const { return m_vibratoAmplitudeMin; }
+VibratoDetector ConfigManager::getVibratoDetector() const { return m_vibratoDetector; }
+int ConfigManager::getVibratoWindowMs() const { return m_vibratoWindowMs; }
 int ConfigManager::getHalfHoleThreshold() const { return m_halfHoleThreshold; }
 
+QueueConfig ConfigManager::getRealtimeQueueConfig() const { return m_realtimeQueue; }
+QueueConfig ConfigManager::getBulkQueueConfig() const { return m_bulkQueue; }
+QueueConfig ConfigManager::getAppLogicQueueConfig() const { return m_appLogicQueue; }
+int ConfigManager::getQueueBlockTimeoutMs() const { return m_queueBlockTimeoutMs; }
+
+bool ConfigManager::getDualCoreDispatch() const { return m_dualCoreDispatch; }
+int ConfigManager::getRealtimeCore() const { return m_realtimeCore; }
+int ConfigManager::getBulkCore() const { return m_bulkCore; }
+
 
 // --- Приватные методы ---
 
@@ -102,16 +142,40 @@ void ConfigManager::loadDefaults() {
     m_filterAlpha = 0.1f;
     m_muteThreshold = 500;
     m_holeClosedThreshold = 400;
+    m_sensorFrameMode = false;
+    m_thresholdHysteresis = 0;
+    m_stateDwellSamples = 1;
+    m_adaptiveThresholds = false;
+    m_holeClosedRatio = 0.6f;
+    m_halfHoleRatio = 0.3f;
+    m_baselineCalibrationMs = 1000;
+    m_baselineTauMs = 5000;
 
     // [app_logic]
     m_muteSensorId = 8;
     m_holeSensorIds = {0, 1, 2, 3, 4, 5, 6, 7};
+    m_fusedPipeline = false;
+    m_maskSettleMs = 0;
+    m_predictOnsetMs = 0;
 
     // [gestures]
     m_vibratoFreqMin = 2.0f;
     m_vibratoFreqMax = 6.0f;
     m_vibratoAmplitudeMin = 50;
+    m_vibratoDetector = VibratoDetector::ZERO_CROSSING;
+    m_vibratoWindowMs = 640;
     m_halfHoleThreshold = 300;
+
+    // [queues]
+    m_realtimeQueue = {16, OverflowPolicy::BLOCK_TIMEOUT};
+    m_bulkQueue = {32, OverflowPolicy::BLOCK_TIMEOUT};
+    m_appLogicQueue = {20, OverflowPolicy::DROP_NEWEST};
+    m_queueBlockTimeoutMs = 10;
+
+    // [dispatch]
+    m_dualCoreDispatch = false;
+    m_realtimeCore = 1; // APP_CPU: путь "палец -> нота"
+    m_bulkCore = 0;     // PRO_CPU: рядом со стеком BLE
 }
 
 void ConfigManager::parseConfig(const std::string& fileContent) {
@@ -166,6 +230,14 @@ void ConfigManager::parseConfig(const std::string& fileContent) {
             else if (key == "filter_alpha") m_filterAlpha = std::stof(value);
             else if (key == "mute_threshold") m_muteThreshold = std::stoi(value);
             else if (key == "hole_closed_threshold") m_holeClosedThreshold = std::stoi(value);
+            else if (key == "sensor_frame_mode") m_sensorFrameMode = parseBool(value);
+            else if (key == "threshold_hysteresis") m_thresholdHysteresis = std::stoi(value);
+            else if (key == "state_dwell_samples") m_stateDwellSamples = std::stoi(value);
+            else if (key == "adaptive_thresholds") m_adaptiveThresholds = parseBool(value);
+            else if (key == "hole_closed_ratio") m_holeClosedRatio = std::stof(value);
+            else if (key == "half_hole_ratio") m_halfHoleRatio = std::stof(value);
+            else if (key == "baseline_calibration_ms") m_baselineCalibrationMs = std::stoi(value);
+            else if (key == "baseline_tau_ms") m_baselineTauMs = std::stoi(value);
 
             // --- [app_logic] ---
             else if (key == "mute_sensor_id") m_muteSensorId = std::stoi(value);
@@ -174,13 +246,32 @@ void ConfigManager::parseConfig(const std::string& fileContent) {
                 m_holeSensorIds.clear();
                 for (const auto& s : strIds) m_holeSensorIds.push_back(std::stoi(s));
             }
+            else if (key == "fused_pipeline") m_fusedPipeline = parseBool(value);
+            else if (key == "mask_settle_ms") m_maskSettleMs = std::stoi(value);
+            else if (key == "predict_onset_ms") m_predictOnsetMs = std::stoi(value);
 
             // --- [gestures] ---
             else if (key == "vibrato_freq_min_hz") m_vibratoFreqMin = std::stof(value);
             else if (key == "vibrato_freq_max_hz") m_vibratoFreqMax = std::stof(value);
             else if (key == "vibrato_amplitude_min") m_vibratoAmplitudeMin = std::stoi(value);
+            else if (key == "vibrato_detector") m_vibratoDetector = parseVibratoDetector(value, m_vibratoDetector);
+            else if (key == "vibrato_window_ms") m_vibratoWindowMs = std::stoi(value);
             else if (key == "half_hole_threshold") m_halfHoleThreshold = std::stoi(value);
 
+            // --- [queues] ---
+            else if (key == "realtime_queue_capacity") m_realtimeQueue.capacity = std::stoi(value);
+            else if (key == "realtime_queue_policy") m_realtimeQueue.policy = parsePolicy(value, m_realtimeQueue.policy);
+            else if (key == "bulk_queue_capacity") m_bulkQueue.capacity = std::stoi(value);
+            else if (key == "bulk_queue_policy") m_bulkQueue.policy = parsePolicy(value, m_bulkQueue.policy);
+            else if (key == "app_logic_queue_capacity") m_appLogicQueue.capacity = std::stoi(value);
+            else if (key == "app_logic_queue_policy") m_appLogicQueue.policy = parsePolicy(value, m_appLogicQueue.policy);
+            else if (key == "queue_block_timeout_ms") m_queueBlockTimeoutMs = std::stoi(value);
+
+            // --- [dispatch] ---
+            else if (key == "dual_core_dispatch") m_dualCoreDispatch = parseBool(value);
+            else if (key == "realtime_core") m_realtimeCore = std::stoi(value);
+            else if (key == "bulk_core") m_bulkCore = std::stoi(value);
+
         } catch (...) {
             // Игнорируем ошибки конвертации
         }
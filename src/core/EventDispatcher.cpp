@@ -2,8 +2,13 @@
  * EventDispatcher.cpp
  *
  * Реализация для EventDispatcher.
- * * - ESP32: Использует FreeRTOS Queue + Task для асинхронной обработки.
- * - Native: Использует синхронный вызов (postEvent сразу вызывает handleEvent) для упрощения тестов.
+ * Оба окружения используют одни и те же lock-free очереди (EventQueue поверх EventRing):
+ * - ESP32: задача FreeRTOS `evtLoop` читает буфер; спит на Task Notification,
+ *   производители будят ее только если она действительно спит. В режиме двух циклов
+ *   (dual_core_dispatch) у каждой полосы своя задача, закрепленная за ядром.
+ * - Native: по умолчанию синхронный режим (postEvent сразу доставляет событие через буфер)
+ *   для простых тестов; startLoopThread() включает настоящие потоки (std::thread + condvar).
+ *   drain()/waitIdle() делают асинхронные тесты детерминированными.
  *
  * Соответствует: docs/modules/core_event_dispatcher.md
  * DEVELOPMENT_PLAN.MD - Спринт 2.6
@@ -23,34 +28,126 @@
 #if defined(ESP32_TARGET)
     #include "freertos/FreeRTOS.h"
     #include "freertos/task.h"
-    #include "freertos/queue.h"
+    #include "esp_timer.h"
+#elif defined(NATIVE_TEST)
+    #include <chrono>
+    #if defined(__linux__)
+        #include <pthread.h>
+        #include <sched.h>
+    #endif
 #endif
 
-EventDispatcher::EventDispatcher() : m_eventQueue(nullptr) {
+// --- Назначение полос по умолчанию ---
+// Все, что лежит на пути "палец -> нота", обгоняет поток сырых значений сенсоров.
+static EventLane defaultLaneFor(EventType type) {
+    switch (type) {
+        case EventType::SENSOR_MASK_CHANGED:
+        case EventType::HALF_HOLE_DETECTED:
+        case EventType::NOTE_PITCH_SELECTED:
+        case EventType::MUTE_ENABLED:
+        case EventType::MUTE_DISABLED:
+            return EventLane::REALTIME;
+        default:
+            return EventLane::BULK;
+    }
+}
+
+EventDispatcher::EventDispatcher()
+    : m_preemptionCount(0),
+      m_postedCount(0),
+      m_dispatchedCount(0),
+      m_loopRunning(false),
+      m_loopCount(1),
+#if defined(NATIVE_TEST)
+      m_inlineDispatching(false),
+      m_virtualClock(false),
+      m_virtualNowMs(0),
+#endif
+      m_activeSnapshot(&m_snapshots[0]),
+      m_subscriberGeneration(1),
+      m_subscriptionsFrozen(false) {
+    for (size_t i = 0; i < MAX_DISPATCH_LOOPS; ++i) {
+        m_loops[i].owner = this;
+        m_loops[i].readerGeneration.store(0);
+        m_loops[i].sleeping.store(false);
+        m_loops[i].task = nullptr;
+        #if defined(ESP32_TARGET)
+        m_loops[i].taskActive.store(false);
+        #endif
+        #if defined(NATIVE_TEST)
+        m_loops[i].threadId.store(std::thread::id());
+        m_loops[i].wakePending = false;
+        #endif
+    }
+    for (size_t i = 0; i < SUBSCRIBER_SNAPSHOT_COUNT; ++i) {
+        m_snapshots[i].retiredAt = 0;
+        m_snapshots[i].inUse = (i == 0);
+    }
+    configureLoops(DispatchLoopConfig{false, {NO_CORE_AFFINITY, NO_CORE_AFFINITY}});
+    clearSubscribers();
+    resetLanes();
+    resetQueues();
+    resetStats();
+}
+
+EventDispatcher::~EventDispatcher() {
+    #if defined(NATIVE_TEST)
+        stopLoopThread();
+    #endif
 }
 
 bool EventDispatcher::init() {
+    return init(DispatchLoopConfig{false, {NO_CORE_AFFINITY, NO_CORE_AFFINITY}});
+}
+
+bool EventDispatcher::init(const DispatchLoopConfig& loops) {
     #if defined(ESP32_TARGET)
-        // 1. Создаем очередь на 20 событий
-        m_eventQueue = xQueueCreate(20, sizeof(Event));
-        if (m_eventQueue == nullptr) {
-            LOG_ERROR(TAG, "Failed to create queue");
-            return false;
+        // Повторный init (перезагрузка конфига): задачи уже работают с буфером
+        if (m_loopRunning.load()) {
+            return true;
         }
 
-        // 2. Запускаем задачу-обработчик
-        // Stack size: 4096 bytes, Priority: 5 (Medium-High)
-        BaseType_t res = xTaskCreate(eventLoopTask, "evtLoop", 4096, this, 5, nullptr);
-        if (res != pdPASS) {
-            LOG_ERROR(TAG, "Failed to create task");
-            return false;
+        // 1. Очищаем буферы (емкость фиксирована, куча не используется)
+        laneQueue(EventLane::REALTIME).reset();
+        laneQueue(EventLane::BULK).reset();
+        m_postedCount.store(0);
+        m_dispatchedCount.store(0);
+        m_timers.reset(nowMs());
+        configureLoops(loops);
+
+        // 2. Запускаем задачи-обработчики (по одной на цикл)
+        if (startLoopTasks()) {
+            return true;
         }
-        return true;
+        // Без второй задачи полоса BULK не доставлялась бы: откат на один цикл всех полос
+        if (m_loopCount > 1) {
+            LOG_WARN(TAG, "Dual-loop dispatch unavailable, falling back to one loop");
+            configureLoops(DispatchLoopConfig{false, {loops.laneCore[0], NO_CORE_AFFINITY}});
+            if (startLoopTasks()) {
+                return true;
+            }
+        }
+        LOG_ERROR(TAG, "No dispatch loop running, events will not be delivered");
+        return false;
 
     #elif defined(NATIVE_TEST)
-        // Для тестов инициализация всегда успешна
+        // Для тестов инициализация всегда успешна.
+        // Повторный init возвращает диспетчер в синхронный режим.
+        stopLoopThread();
+        configureLoops(loops);
+
         // ВАЖНО: Сбрасываем подписчиков при ре-инициализации (для тестов)
-        m_subscribers.clear(); 
+        clearSubscribers();
+        resetLanes();
+        resetQueues();
+        resetStats();
+        resetLatencyStats();
+        m_flightRecorder.reset();
+        m_postedCount.store(0);
+        m_dispatchedCount.store(0);
+        m_virtualClock.store(false);
+        m_virtualNowMs.store(0);
+        m_timers.reset(nowMs());
         std::cout << "[EventDispatcher] Init (Native Sync Mode)" << std::endl;
         return true;
     #else
@@ -58,84 +155,915 @@ bool EventDispatcher::init() {
     #endif
 }
 
+#if defined(ESP32_TARGET)
+bool EventDispatcher::startLoopTasks() {
+    // Stack size: 4096 bytes, Priority: 5 (Medium-High)
+    static const char* const names[MAX_DISPATCH_LOOPS] = {"evtRt", "evtBulk"};
+    m_loopRunning.store(true);
+    for (size_t i = 0; i < m_loopCount; ++i) {
+        DispatchLoop& loop = m_loops[i];
+        const BaseType_t core = loop.core == NO_CORE_AFFINITY ? tskNO_AFFINITY : (BaseType_t)loop.core;
+        // Хэндл записывается до первого запуска задачи (нужен currentReader())
+        loop.taskActive.store(true);
+        BaseType_t res = xTaskCreatePinnedToCore(eventLoopTask, m_loopCount > 1 ? names[i] : "evtLoop",
+                                                 4096, &loop, 5, (TaskHandle_t*)&loop.task, core);
+        if (res != pdPASS) {
+            LOG_ERROR(TAG, "Failed to create task %s", m_loopCount > 1 ? names[i] : "evtLoop");
+            loop.taskActive.store(false);
+            loop.task = nullptr;
+            stopLoopTasks(i);
+            return false;
+        }
+    }
+    return true;
+}
+
+void EventDispatcher::stopLoopTasks(size_t count) {
+    m_loopRunning.store(false);
+    for (size_t i = 0; i < count; ++i) {
+        wakeLoop(m_loops[i]);
+    }
+    // Цикл видит m_loopRunning == false после пробуждения (уведомление до сна не теряется)
+    for (size_t i = 0; i < count; ++i) {
+        while (m_loops[i].taskActive.load()) {
+            vTaskDelay(1);
+        }
+        m_loops[i].task = nullptr;
+    }
+}
+#endif
+
+void EventDispatcher::configureLoops(const DispatchLoopConfig& config) {
+    m_loopCount = config.dualLoop ? MAX_DISPATCH_LOOPS : 1;
+    for (size_t i = 0; i < MAX_DISPATCH_LOOPS; ++i) {
+        m_loops[i].laneMask = m_loopCount > 1 ? laneBit(static_cast<EventLane>(i)) : ALL_LANES;
+        m_loops[i].core = config.laneCore[i];
+    }
+}
+
+size_t EventDispatcher::getLoopCount() const {
+    return m_loopCount;
+}
+
+size_t EventDispatcher::getLoopIndex(EventType type) const {
+    return m_loopCount > 1 ? static_cast<size_t>(getEventLane(type)) : 0;
+}
+
 // (Новое)
 void EventDispatcher::reset() {
-    m_subscribers.clear();
+    clearSubscribers();
+    resetLanes();
     #if defined(NATIVE_TEST)
         std::cout << "[EventDispatcher] Reset subscribers." << std::endl;
     #endif
 }
 
 bool EventDispatcher::subscribe(EventType type, IEventHandler* handler) {
+    return subscribe(type, handler, EventFilter::all());
+}
+
+bool EventDispatcher::subscribe(EventType type, IEventHandler* handler, const EventFilter& filter) {
     if (handler == nullptr) return false;
-    
-    // Добавляем подписчика в список для данного типа событий
-    m_subscribers[type].push_back(handler);
-    
+
+    size_t index = static_cast<size_t>(type);
+    if (index >= EVENT_TYPE_COUNT) return false;
+
+    // Добавляем подписчика в копию набора и публикуем ее
+    SubscriberSnapshot* next = beginSubscriberUpdate();
+    if (next == nullptr) return false;
+    bool added = next->set.add(type, handler, filter);
+    if (!added) {
+        LOG_ERROR(TAG, "Too many subscribers for event type %d", (int)type);
+    }
+    endSubscriberUpdate(next, added);
+
     #if defined(NATIVE_TEST)
-        std::cout << "[EventDispatcher] Subscribed handler to event type " << (int)type << std::endl;
+        if (added) {
+            std::cout << "[EventDispatcher] Subscribed handler to event type " << (int)type << std::endl;
+        }
     #endif
+    return added;
+}
+
+bool EventDispatcher::unsubscribe(EventType type, IEventHandler* handler) {
+    if (handler == nullptr) return false;
+
+    size_t index = static_cast<size_t>(type);
+    if (index >= EVENT_TYPE_COUNT) return false;
+
+    SubscriberSnapshot* next = beginSubscriberUpdate();
+    if (next == nullptr) return false;
+    bool removed = next->set.remove(type, handler);
+    endSubscriberUpdate(next, removed);
+    return removed;
+}
+
+size_t EventDispatcher::unsubscribeAll(IEventHandler* handler) {
+    if (handler == nullptr) return 0;
+
+    SubscriberSnapshot* next = beginSubscriberUpdate();
+    if (next == nullptr) return 0;
+    size_t removed = next->set.removeAll(handler);
+    endSubscriberUpdate(next, removed > 0);
+    return removed;
+}
+
+void EventDispatcher::getSubscribers(SubscriberSet& out) const {
+    lockSubscriberWriter();
+    out = m_activeSnapshot.load(std::memory_order_relaxed)->set;
+    unlockSubscriberWriter();
+}
+
+bool EventDispatcher::replaceSubscribers(const SubscriberSet& subscribers) {
+    SubscriberSnapshot* next = beginSubscriberUpdate();
+    if (next == nullptr) return false;
+    next->set = subscribers;
+    endSubscriberUpdate(next, true);
+    LOG_INFO(TAG, "Subscribers replaced (generation %lu)", (unsigned long)getSubscriberGeneration());
     return true;
 }
 
+uint32_t EventDispatcher::getSubscriberGeneration() const {
+    return m_subscriberGeneration.load(std::memory_order_acquire);
+}
+
 bool EventDispatcher::postEvent(const Event& event) {
     #if defined(ESP32_TARGET)
-        // Асинхронная отправка в очередь
-        if (m_eventQueue == nullptr) return false;
-        
-        // portMAX_DELAY = ждать бесконечно, если очередь полна (блокировка отправителя)
-        // Для ISR (прерываний) нужно использовать xQueueSendFromISR (здесь упрощено)
-        if (xQueueSend(m_eventQueue, &event, (TickType_t)10) != pdPASS) {
-             LOG_WARN(TAG, "Queue full, event dropped: %d", (int)event.type);
-             return false;
-        }
+        // Задача-обработчик не запущена -> доставлять некому
+        if (!m_loopRunning.load(std::memory_order_relaxed)) return false;
+    #endif
+
+    size_t index = static_cast<size_t>(event.type);
+    if (index >= EVENT_TYPE_COUNT) return false;
+
+    // Штамп времени публикации (для гистограммы ожидания в очереди)
+    Event stamped = event;
+    stamped.postTimeUs = nowUs();
+
+    LaneQueue::PushResult result = pushToLane(stamped, index);
+    if (result == LaneQueue::PushResult::DROPPED) {
+        return false;
+    }
+    if (result == LaneQueue::PushResult::COALESCED) {
+        // Заменили ожидающее значение на месте - цикл о нем уже знает
         return true;
+    }
 
-    #elif defined(NATIVE_TEST)
-        // Синхронная эмуляция для тестов:
-        // Сразу доставляем событие подписчикам
-        std::cout << "[EventDispatcher] Posting event type " << (int)event.type << std::endl;
-        
-        if (m_subscribers.count(event.type)) {
-            size_t count = m_subscribers[event.type].size();
-            std::cout << "[EventDispatcher] Found " << count << " subscribers." << std::endl;
-            
-            for (IEventHandler* handler : m_subscribers[event.type]) {
-                handler->handleEvent(event);
+    #if defined(NATIVE_TEST)
+        // Синхронная эмуляция для тестов: сразу доставляем событие подписчикам.
+        // Вложенные публикации (из обработчиков) доставит внешний вызов - порядок FIFO, как на ESP32.
+        if (!m_loopRunning.load()) {
+            if (!m_inlineDispatching) {
+                m_inlineDispatching = true;
+                dispatchPending();
+                m_inlineDispatching = false;
             }
-        } else {
-            std::cout << "[EventDispatcher] No subscribers for this event." << std::endl;
+            return true;
         }
-        return true;
+    #endif
+
+    wakeIfSleeping(loopFor(m_laneOf[index]));
+    return true;
+}
+
+void EventDispatcher::configureLane(EventLane lane, const QueueConfig& config) {
+    size_t index = static_cast<size_t>(lane);
+    if (index >= EVENT_LANE_COUNT) return;
+    m_queues[index].configure(config);
+}
+
+void EventDispatcher::setBlockTimeoutMs(uint32_t timeoutMs) {
+    for (size_t i = 0; i < EVENT_LANE_COUNT; ++i) {
+        m_queues[i].setBlockTimeoutMs(timeoutMs);
+    }
+}
+
+void EventDispatcher::setSensorCoalescing(bool enabled) {
+    // Ячейки, заполненные до выключения, цикл все равно доставит
+    LaneQueue& queue = laneQueue(getEventLane(EventType::SENSOR_VALUE_CHANGED));
+    if (enabled) {
+        queue.setPolicy(OverflowPolicy::COALESCE);
+    } else if (queue.policy() == OverflowPolicy::COALESCE) {
+        queue.setPolicy(OverflowPolicy::BLOCK_TIMEOUT);
+    }
+}
+
+bool EventDispatcher::isSensorCoalescing() const {
+    return laneQueue(getEventLane(EventType::SENSOR_VALUE_CHANGED)).policy() == OverflowPolicy::COALESCE;
+}
+
+void EventDispatcher::freezeSubscriptions() {
+    m_subscriptionsFrozen = true;
+}
+
+bool EventDispatcher::setEventLane(EventType type, EventLane lane) {
+    size_t index = static_cast<size_t>(type);
+    if (index >= EVENT_TYPE_COUNT) return false;
+
+    if (m_subscriptionsFrozen) {
+        LOG_WARN(TAG, "Lanes frozen, lane change rejected: %d", (int)type);
+        return false;
+    }
+    m_laneOf[index] = lane;
+    return true;
+}
+
+EventLane EventDispatcher::getEventLane(EventType type) const {
+    size_t index = static_cast<size_t>(type);
+    if (index >= EVENT_TYPE_COUNT) return EventLane::BULK;
+    return m_laneOf[index];
+}
+
+size_t EventDispatcher::drain() {
+    if (m_loopRunning.load()) {
+        // У каждой полосы один потребитель - ждем фоновые циклы
+        waitIdle();
+        return 0;
+    }
+    return dispatchPending();
+}
+
+void EventDispatcher::waitIdle() {
+    #if defined(ESP32_TARGET)
+        while (m_loopRunning.load() &&
+               m_dispatchedCount.load(std::memory_order_acquire) != m_postedCount.load(std::memory_order_acquire)) {
+            vTaskDelay(1);
+        }
+    #elif defined(NATIVE_TEST)
+        if (!m_loopRunning.load()) {
+            dispatchPending();
+            return;
+        }
+        std::unique_lock<std::mutex> lock(m_idleMutex);
+        m_idleCv.wait(lock, [this] {
+            return !m_loopRunning.load() ||
+                   m_dispatchedCount.load(std::memory_order_acquire) == m_postedCount.load(std::memory_order_acquire);
+        });
+    #endif
+}
+
+size_t EventDispatcher::pendingCount() const {
+    size_t pending = 0;
+    for (size_t i = 0; i < EVENT_LANE_COUNT; ++i) {
+        pending += m_queues[i].size();
+    }
+    return pending;
+}
+
+uint32_t EventDispatcher::getPreemptionCount() const {
+    return m_preemptionCount.load(std::memory_order_relaxed);
+}
+
+uint32_t EventDispatcher::getCoalescedCount() const {
+    uint32_t coalesced = 0;
+    for (size_t i = 0; i < EVENT_LANE_COUNT; ++i) {
+        coalesced += m_queues[i].getCoalescedCount();
+    }
+    return coalesced;
+}
+
+uint32_t EventDispatcher::getDroppedCount(EventLane lane) const {
+    return laneQueue(lane).getDroppedCount();
+}
+
+uint32_t EventDispatcher::getEvictedCount(EventLane lane) const {
+    return laneQueue(lane).getEvictedCount();
+}
+
+uint32_t EventDispatcher::getHighWaterMark(EventLane lane) const {
+    return laneQueue(lane).getHighWaterMark();
+}
+
+uint32_t EventDispatcher::getGapCount(EventLane lane) const {
+    return laneQueue(lane).getGapCount();
+}
+
+size_t EventDispatcher::getLaneCapacity(EventLane lane) const {
+    return laneQueue(lane).capacity();
+}
+
+OverflowPolicy EventDispatcher::getLanePolicy(EventLane lane) const {
+    return laneQueue(lane).policy();
+}
+
+uint32_t EventDispatcher::getLaneDispatchedCount(EventLane lane) const {
+    size_t index = static_cast<size_t>(lane);
+    if (index >= EVENT_LANE_COUNT) return 0;
+    return m_laneDispatched[index].load(std::memory_order_relaxed);
+}
+
+void EventDispatcher::resetStats() {
+    m_preemptionCount.store(0, std::memory_order_relaxed);
+    for (size_t i = 0; i < EVENT_LANE_COUNT; ++i) {
+        m_laneDispatched[i].store(0, std::memory_order_relaxed);
+        m_queues[i].resetStats();
+    }
+}
+
+const LatencyHistogram& EventDispatcher::getQueueWaitHistogram(EventType type) const {
+    size_t index = static_cast<size_t>(type);
+    if (index >= EVENT_TYPE_COUNT) index = 0;
+    return m_queueWait[index];
+}
+
+const LatencyHistogram& EventDispatcher::getHandlerHistogram(EventType type, size_t slot) const {
+    size_t index = static_cast<size_t>(type);
+    if (index >= EVENT_TYPE_COUNT) index = 0;
+    if (slot >= MAX_HANDLERS_PER_TYPE) slot = 0;
+    lockSubscriberWriter();
+    const SubscriberSet::HandlerList& list = m_activeSnapshot.load(std::memory_order_relaxed)->set.m_lists[index];
+    const uint8_t stat = slot < list.count ? list.statSlots[slot] : (uint8_t)slot;
+    unlockSubscriberWriter();
+    return m_handlerTime[index][stat];
+}
+
+size_t EventDispatcher::getSubscriberCount(EventType type) const {
+    lockSubscriberWriter();
+    size_t count = m_activeSnapshot.load(std::memory_order_relaxed)->set.count(type);
+    unlockSubscriberWriter();
+    return count;
+}
+
+void EventDispatcher::resetLatencyStats() {
+    for (size_t i = 0; i < EVENT_TYPE_COUNT; ++i) {
+        m_queueWait[i].reset();
+        for (size_t slot = 0; slot < MAX_HANDLERS_PER_TYPE; ++slot) {
+            m_handlerTime[i][slot].reset();
+        }
+    }
+}
+
+FlightRecorder& EventDispatcher::getFlightRecorder() {
+    return m_flightRecorder;
+}
+
+const FlightRecorder& EventDispatcher::getFlightRecorder() const {
+    return m_flightRecorder;
+}
+
+bool EventDispatcher::dumpFlightRecorder(IHalStorage* storage, const std::string& path) const {
+    bool ok = m_flightRecorder.dump(storage, path, nowUs());
+    if (!ok) {
+        LOG_ERROR(TAG, "Flight recorder dump failed: %s", path.c_str());
+    }
+    return ok;
+}
+
+uint32_t EventDispatcher::nowUs() {
+    #if defined(ESP32_TARGET)
+        return (uint32_t)esp_timer_get_time();
+    #elif defined(NATIVE_TEST)
+        static const auto start = std::chrono::steady_clock::now();
+        return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
     #else
+        return 0;
+    #endif
+}
+
+uint32_t EventDispatcher::nowMs() const {
+    #if defined(ESP32_TARGET)
+        return (uint32_t)(esp_timer_get_time() / 1000);
+    #elif defined(NATIVE_TEST)
+        if (m_virtualClock.load(std::memory_order_acquire)) {
+            return m_virtualNowMs.load(std::memory_order_acquire);
+        }
+        static const auto start = std::chrono::steady_clock::now();
+        return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    #else
+        return 0;
+    #endif
+}
+
+// --- Таймеры ---
+
+TimerId EventDispatcher::startTimer(uint32_t delayMs, const Event& event, uint32_t periodMs) {
+    TimerId id = m_timers.start(nowMs(), delayMs, event, periodMs);
+    if (id == INVALID_TIMER_ID) {
+        LOG_ERROR(TAG, "Timer pool exhausted (%u)", (unsigned)TimerWheel::MAX_TIMERS);
+        return INVALID_TIMER_ID;
+    }
+    // Спящий цикл мог выбрать более поздний срок пробуждения - пересчитает
+    wakeIfSleeping(loopFor(EventLane::BULK));
+    return id;
+}
+
+bool EventDispatcher::cancelTimer(TimerId id) {
+    // Цикл проснется по старому сроку и просто уснет снова
+    return m_timers.cancel(id);
+}
+
+bool EventDispatcher::restartTimer(TimerId id, uint32_t delayMs) {
+    if (!m_timers.restart(id, nowMs(), delayMs)) {
         return false;
+    }
+    wakeIfSleeping(loopFor(EventLane::BULK));
+    return true;
+}
+
+bool EventDispatcher::isTimerActive(TimerId id) const {
+    return m_timers.isActive(id);
+}
+
+size_t EventDispatcher::pollTimers() {
+    TimerWheel::Fired fired[TimerWheel::MAX_TIMERS];
+    size_t total = 0;
+    const uint32_t now = nowMs();
+
+    // Публикуем вне блокировки колеса: обработчики могут сразу перезапустить таймер
+    for (;;) {
+        size_t count = m_timers.advance(now, fired);
+        if (count == 0) break;
+        for (size_t i = 0; i < count; ++i) {
+            if (postEvent(fired[i].event)) {
+                ++total;
+            }
+        }
+    }
+    return total;
+}
+
+#if defined(NATIVE_TEST)
+// Эмуляция xTaskCreatePinnedToCore: ядро = CPU хоста (по модулю их числа)
+static void pinThreadToCpu(std::thread& thread, int core) {
+    if (core == NO_CORE_AFFINITY) return;
+    #if defined(__linux__)
+        unsigned cpus = std::thread::hardware_concurrency();
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus > 0 ? (unsigned)core % cpus : 0, &set);
+        if (pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) != 0) {
+            std::cout << "[EventDispatcher] CPU affinity not applied (core " << core << ")" << std::endl;
+        }
+    #else
+        (void)thread;
     #endif
 }
 
-// --- Приватные методы (Только для ESP32) ---
+bool EventDispatcher::startLoopThread() {
+    if (m_loopRunning.load()) return true;
 
-void EventDispatcher::eventLoopTask(void* params) {
-    auto* dispatcher = static_cast<EventDispatcher*>(params);
-    dispatcher->eventLoop();
-    // Задача FreeRTOS никогда не должна возвращаться
-    // vTaskDelete(nullptr); 
+    m_loopRunning.store(true);
+    for (size_t i = 0; i < m_loopCount; ++i) {
+        DispatchLoop& loop = m_loops[i];
+        loop.thread = std::thread(&EventDispatcher::eventLoop, this, std::ref(loop));
+        pinThreadToCpu(loop.thread, loop.core);
+    }
+    std::cout << "[EventDispatcher] " << m_loopCount << " loop thread(s) started (Native Threaded Mode)" << std::endl;
+    return true;
 }
 
-void EventDispatcher::eventLoop() {
+void EventDispatcher::stopLoopThread() {
+    if (!m_loopRunning.load()) return;
+
+    m_loopRunning.store(false);
+    for (size_t i = 0; i < m_loopCount; ++i) {
+        wakeLoop(m_loops[i]);
+    }
+    for (size_t i = 0; i < m_loopCount; ++i) {
+        if (m_loops[i].thread.joinable()) {
+            m_loops[i].thread.join();
+        }
+        m_loops[i].threadId.store(std::thread::id());
+    }
+    notifyIdle();
+    std::cout << "[EventDispatcher] Loop thread stopped." << std::endl;
+}
+
+void EventDispatcher::setVirtualClock(bool enabled) {
+    m_virtualNowMs.store(0);
+    m_virtualClock.store(enabled, std::memory_order_release);
+    m_timers.reset(nowMs());
+}
+
+void EventDispatcher::advanceVirtualTime(uint32_t ms) {
+    m_virtualNowMs.fetch_add(ms, std::memory_order_acq_rel);
+    // Публикуем из вызывающего потока: после возврата waitIdle() уже видит эти события
+    pollTimers();
+}
+#endif
+
+// --- Приватные методы ---
+
+EventDispatcher::LaneQueue::PushResult EventDispatcher::pushToLane(const Event& event, size_t typeIndex) {
+    LaneQueue& queue = laneQueue(m_laneOf[typeIndex]);
+
+    // Ждать места имеет смысл, только если есть потребитель в другой задаче/потоке
     #if defined(ESP32_TARGET)
+        const bool mayBlock = true;
+    #else
+        const bool mayBlock = m_loopRunning.load();
+    #endif
+
+    // Учитываем событие ДО публикации: waitIdle() не должен увидеть posted == dispatched,
+    // пока оно ожидает доставки. Вытесненные и склеенные события затем вычитаются.
+    m_postedCount.fetch_add(1, std::memory_order_release);
+    uint32_t evicted = 0;
+    LaneQueue::PushResult result = queue.push(event, mayBlock, &evicted);
+    uint32_t notPending = evicted + (result == LaneQueue::PushResult::QUEUED ? 0 : 1);
+    if (notPending > 0) {
+        m_postedCount.fetch_sub(notPending, std::memory_order_release);
+    }
+
+    if (result == LaneQueue::PushResult::DROPPED) {
+        LOG_WARN(TAG, "Queue full, event dropped: %d", (int)event.type);
+    }
+    return result;
+}
+
+// --- Набор подписчиков ---
+
+SubscriberSet::SubscriberSet() {
+    clear();
+}
+
+bool SubscriberSet::add(EventType type, IEventHandler* handler, const EventFilter& filter) {
+    size_t index = static_cast<size_t>(type);
+    if (index >= EVENT_TYPE_COUNT || handler == nullptr) return false;
+
+    HandlerList& list = m_lists[index];
+    if (list.count >= MAX_HANDLERS_PER_TYPE) return false;
+    // Первая гистограмма, не закрепленная за оставшимися подписками
+    uint32_t used = 0;
+    for (uint8_t i = 0; i < list.count; ++i) {
+        used |= 1u << list.statSlots[i];
+    }
+    uint8_t stat = 0;
+    while (used & (1u << stat)) {
+        ++stat;
+    }
+    list.statSlots[list.count] = stat;
+    if (!filter.passesAll()) {
+        list.filtered |= (uint8_t)(1u << list.count);
+    }
+    list.filters[list.count] = filter;
+    list.handlers[list.count++] = handler;
+    return true;
+}
+
+bool SubscriberSet::remove(EventType type, IEventHandler* handler) {
+    size_t index = static_cast<size_t>(type);
+    if (index >= EVENT_TYPE_COUNT) return false;
+
+    HandlerList& list = m_lists[index];
+    for (uint8_t i = 0; i < list.count; ++i) {
+        if (list.handlers[i] != handler) continue;
+        // Сдвигаем хвост: порядок доставки остальным подписчикам не меняется
+        for (uint8_t j = i + 1; j < list.count; ++j) {
+            list.handlers[j - 1] = list.handlers[j];
+            list.filters[j - 1] = list.filters[j];
+            list.statSlots[j - 1] = list.statSlots[j];
+        }
+        const uint8_t below = (uint8_t)((1u << i) - 1);
+        list.filtered = (uint8_t)((list.filtered & below) | ((list.filtered >> 1) & ~below));
+        --list.count;
+        return true;
+    }
+    return false;
+}
+
+size_t SubscriberSet::removeAll(IEventHandler* handler) {
+    size_t removed = 0;
+    for (size_t i = 0; i < EVENT_TYPE_COUNT; ++i) {
+        while (remove(static_cast<EventType>(i), handler)) {
+            ++removed;
+        }
+    }
+    return removed;
+}
+
+void SubscriberSet::clear() {
+    for (size_t i = 0; i < EVENT_TYPE_COUNT; ++i) {
+        m_lists[i].count = 0;
+        m_lists[i].filtered = 0;
+    }
+}
+
+size_t SubscriberSet::count(EventType type) const {
+    size_t index = static_cast<size_t>(type);
+    if (index >= EVENT_TYPE_COUNT) return 0;
+    return m_lists[index].count;
+}
+
+IEventHandler* SubscriberSet::at(EventType type, size_t slot) const {
+    size_t index = static_cast<size_t>(type);
+    if (index >= EVENT_TYPE_COUNT || slot >= m_lists[index].count) return nullptr;
+    return m_lists[index].handlers[slot];
+}
+
+EventFilter SubscriberSet::filterAt(EventType type, size_t slot) const {
+    size_t index = static_cast<size_t>(type);
+    if (index >= EVENT_TYPE_COUNT || slot >= m_lists[index].count) return EventFilter::all();
+    return m_lists[index].filters[slot];
+}
+
+// --- Снимки подписчиков ---
+
+void EventDispatcher::lockSubscriberWriter() const {
+    while (m_subscriberWriter.test_and_set(std::memory_order_acquire)) {
+        writerPause();
+    }
+}
+
+void EventDispatcher::unlockSubscriberWriter() const {
+    m_subscriberWriter.clear(std::memory_order_release);
+}
+
+void EventDispatcher::writerPause() {
+    #if defined(ESP32_TARGET)
+        // Не taskYIELD: писатель с более низким приоритетом тоже должен получить процессор
+        vTaskDelay(1);
+    #elif defined(NATIVE_TEST)
+        std::this_thread::yield();
+    #endif
+}
+
+const EventDispatcher::DispatchLoop* EventDispatcher::currentReader() const {
+    for (size_t i = 0; i < MAX_DISPATCH_LOOPS; ++i) {
+        #if defined(ESP32_TARGET)
+            if (m_loops[i].task != nullptr && m_loops[i].task == (void*)xTaskGetCurrentTaskHandle()) return &m_loops[i];
+        #elif defined(NATIVE_TEST)
+            if (m_loops[i].threadId.load() == std::this_thread::get_id()) return &m_loops[i];
+        #endif
+    }
+    // Синхронный режим / drain(): доставка идет в вызывающем потоке от имени m_loops[0]
+    if (!m_loopRunning.load() && m_loops[0].readerGeneration.load() != 0) {
+        return &m_loops[0];
+    }
+    return nullptr;
+}
+
+bool EventDispatcher::isSnapshotReleased(uint32_t retiredAt) const {
+    // Снимок могут читать только циклы, взявшие номер набора раньше его замены
+    for (size_t i = 0; i < MAX_DISPATCH_LOOPS; ++i) {
+        uint32_t reading = m_loops[i].readerGeneration.load();
+        if (reading != 0 && (int32_t)(reading - retiredAt) < 0) return false;
+    }
+    return true;
+}
+
+void EventDispatcher::reclaimSubscriberSnapshots() {
+    for (size_t i = 0; i < SUBSCRIBER_SNAPSHOT_COUNT; ++i) {
+        SubscriberSnapshot& snapshot = m_snapshots[i];
+        if (snapshot.inUse && snapshot.retiredAt != 0 && isSnapshotReleased(snapshot.retiredAt)) {
+            snapshot.retiredAt = 0;
+            snapshot.inUse = false;
+        }
+    }
+}
+
+EventDispatcher::SubscriberSnapshot* EventDispatcher::beginSubscriberUpdate() {
+    const bool inHandler = currentReader() != nullptr;
+    for (;;) {
+        lockSubscriberWriter();
+        reclaimSubscriberSnapshots();
+        for (size_t i = 0; i < SUBSCRIBER_SNAPSHOT_COUNT; ++i) {
+            SubscriberSnapshot& snapshot = m_snapshots[i];
+            if (snapshot.inUse) continue;
+            snapshot.inUse = true;
+            snapshot.retiredAt = 0;
+            snapshot.set = m_activeSnapshot.load(std::memory_order_relaxed)->set;
+            return &snapshot;
+        }
+        unlockSubscriberWriter();
+
+        // Из обработчика ждать нельзя: снимок может держать наш же цикл
+        if (inHandler) {
+            LOG_WARN(TAG, "Subscriber snapshots busy, update rejected");
+            return nullptr;
+        }
+        writerPause();
+    }
+}
+
+void EventDispatcher::endSubscriberUpdate(SubscriberSnapshot* next, bool publish) {
+    if (!publish) {
+        next->inUse = false;
+        unlockSubscriberWriter();
+        return;
+    }
+
+    resetReassignedHandlerStats(next->set);
+
+    // Сначала указатель, затем номер: цикл, увидевший новый номер, увидит и новый снимок
+    SubscriberSnapshot* previous = m_activeSnapshot.load(std::memory_order_relaxed);
+    m_activeSnapshot.store(next);
+    uint32_t generation = m_subscriberGeneration.load(std::memory_order_relaxed) + 1;
+    if (generation == 0) generation = 1; // 0 - признак точки покоя цикла
+    m_subscriberGeneration.store(generation);
+    previous->retiredAt = generation;
+    unlockSubscriberWriter();
+
+    // Grace period: прежний набор больше не читается, отписанные обработчики можно удалять
+    if (currentReader() != nullptr) return;
+    while (!isSnapshotReleased(generation)) {
+        writerPause();
+    }
+}
+
+void EventDispatcher::resetReassignedHandlerStats(const SubscriberSet& next) {
+    const SubscriberSet& current = m_activeSnapshot.load(std::memory_order_relaxed)->set;
+    for (size_t index = 0; index < EVENT_TYPE_COUNT; ++index) {
+        const SubscriberSet::HandlerList& now = current.m_lists[index];
+        const SubscriberSet::HandlerList& then = next.m_lists[index];
+        for (uint8_t i = 0; i < then.count; ++i) {
+            // Та же подписка - тот же обработчик на той же гистограмме
+            bool kept = false;
+            for (uint8_t j = 0; j < now.count && !kept; ++j) {
+                kept = now.statSlots[j] == then.statSlots[i] && now.handlers[j] == then.handlers[i];
+            }
+            if (!kept) {
+                m_handlerTime[index][then.statSlots[i]].reset();
+            }
+        }
+    }
+}
+
+void EventDispatcher::clearSubscribers() {
+    SubscriberSnapshot* next = beginSubscriberUpdate();
+    if (next != nullptr) {
+        next->set.clear();
+        endSubscriberUpdate(next, true);
+    }
+    m_subscriptionsFrozen = false;
+}
+
+void EventDispatcher::dispatch(DispatchLoop& reader, const Event& event, size_t queueDepth) {
+    size_t index = static_cast<size_t>(event.type);
+    if (index >= EVENT_TYPE_COUNT) return;
+
+    // Беззнаковая разность корректна и при переполнении 32-битного счетчика (~71 мин)
+    uint32_t start = nowUs();
+    m_queueWait[index].record(start - event.postTimeUs);
+    m_flightRecorder.record(event, start, queueDepth);
+
+    // Объявляем читаемый набор (seq_cst в паре с endSubscriberUpdate), затем берем снимок.
+    // Вложенная доставка (drain() из обработчика) остается под номером внешней.
+    const uint32_t outer = reader.readerGeneration.load(std::memory_order_relaxed);
+    if (outer == 0) {
+        reader.readerGeneration.store(m_subscriberGeneration.load());
+    }
+    const SubscriberSet::HandlerList& list = m_activeSnapshot.load()->set.m_lists[index];
+    for (uint8_t i = 0; i < list.count; ++i) {
+        // Фильтр по содержимому - до вызова обработчика (и копии в его очередь)
+        if ((list.filtered & (1u << i)) && !list.filters[i].matches(event)) continue;
+        list.handlers[i]->handleEvent(event);
+        uint32_t end = nowUs();
+        m_handlerTime[index][list.statSlots[i]].record(end - start);
+        start = end;
+    }
+    // Точка покоя: снимок больше не нужен
+    if (outer == 0) {
+        reader.readerGeneration.store(0, std::memory_order_release);
+    }
+}
+
+size_t EventDispatcher::dispatchPending(DispatchLoop& reader, uint8_t laneMask) {
     Event event(EventType::BLE_CONNECTED); // Временная переменная для буфера
+    size_t count = 0;
+    const bool realtime = (laneMask & laneBit(EventLane::REALTIME)) != 0;
+    const bool bulk = (laneMask & laneBit(EventLane::BULK)) != 0;
 
-    while(true) {
-        // Ждем событие из очереди (блокируемся, пока не придет)
-        if (xQueueReceive(m_eventQueue, &event, portMAX_DELAY) == pdPASS) {
-            
-            // Рассылаем подписчикам
-            if (m_subscribers.count(event.type)) {
-                for (IEventHandler* handler : m_subscribers[event.type]) {
-                    handler->handleEvent(event);
-                }
+    for (;;) {
+        EventLane lane;
+        // Строгий приоритет: REALTIME проверяется перед каждым событием BULK
+        if (realtime && laneQueue(EventLane::REALTIME).pop(event)) {
+            lane = EventLane::REALTIME;
+            if (bulk && !laneQueue(EventLane::BULK).empty()) {
+                // Событие обогнало ожидающий поток сенсоров
+                m_preemptionCount.fetch_add(1, std::memory_order_relaxed);
             }
+        } else if (bulk && laneQueue(EventLane::BULK).pop(event)) {
+            lane = EventLane::BULK;
+        } else {
+            break;
         }
+
+        dispatch(reader, event, laneQueue(lane).fifoSize());
+        m_laneDispatched[static_cast<size_t>(lane)].fetch_add(1, std::memory_order_relaxed);
+        m_dispatchedCount.fetch_add(1, std::memory_order_release);
+        ++count;
+    }
+    return count;
+}
+
+bool EventDispatcher::lanesEmpty(uint8_t laneMask) const {
+    for (size_t i = 0; i < EVENT_LANE_COUNT; ++i) {
+        if ((laneMask & (1u << i)) && !m_queues[i].empty()) return false;
+    }
+    return true;
+}
+
+void EventDispatcher::resetLanes() {
+    for (size_t i = 0; i < EVENT_TYPE_COUNT; ++i) {
+        m_laneOf[i] = defaultLaneFor(static_cast<EventType>(i));
     }
+}
+
+void EventDispatcher::resetQueues() {
+    laneQueue(EventLane::REALTIME).reset();
+    laneQueue(EventLane::REALTIME).configure(QueueConfig{(int)REALTIME_QUEUE_CAPACITY, OverflowPolicy::BLOCK_TIMEOUT});
+    laneQueue(EventLane::BULK).reset();
+    laneQueue(EventLane::BULK).configure(QueueConfig{(int)BULK_QUEUE_CAPACITY, OverflowPolicy::BLOCK_TIMEOUT});
+    setBlockTimeoutMs(LaneQueue::DEFAULT_BLOCK_TIMEOUT_MS);
+}
+
+void EventDispatcher::wakeLoop(DispatchLoop& loop) {
+    #if defined(ESP32_TARGET)
+        if (loop.task) {
+            xTaskNotifyGive((TaskHandle_t)loop.task);
+        }
+    #elif defined(NATIVE_TEST)
+        {
+            std::lock_guard<std::mutex> lock(loop.wakeMutex);
+            loop.wakePending = true;
+        }
+        loop.wakeCv.notify_one();
+    #endif
+}
+
+void EventDispatcher::wakeIfSleeping(DispatchLoop& loop) {
+    // Будим цикл, только если он спит (пара барьеров с eventLoop исключает потерю пробуждения)
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (loop.sleeping.load(std::memory_order_relaxed)) {
+        wakeLoop(loop);
+    }
+}
+
+void EventDispatcher::sleepLoop(DispatchLoop& loop, bool withTimers) {
+    // Спим не дольше, чем до ближайшего таймера
+    uint32_t expiry = 0;
+    const bool hasTimer = withTimers && m_timers.nextExpiry(expiry);
+    int32_t delayMs = hasTimer ? (int32_t)(expiry - nowMs()) : 0;
+    if (hasTimer && delayMs <= 0) {
+        return;
+    }
+
+    #if defined(ESP32_TARGET)
+        // Счетчик уведомлений: xTaskNotifyGive до сна не теряется
+        TickType_t ticks = portMAX_DELAY;
+        if (hasTimer) {
+            ticks = pdMS_TO_TICKS(delayMs);
+            if (ticks == 0) ticks = 1;
+        }
+        ulTaskNotifyTake(pdTRUE, ticks);
+    #elif defined(NATIVE_TEST)
+        std::unique_lock<std::mutex> lock(loop.wakeMutex);
+        if (hasTimer && !m_virtualClock.load()) {
+            loop.wakeCv.wait_for(lock, std::chrono::milliseconds(delayMs), [&loop] { return loop.wakePending; });
+        } else {
+            // Виртуальное время продвигает advanceVirtualTime() - ждать по часам нечего
+            loop.wakeCv.wait(lock, [&loop] { return loop.wakePending; });
+        }
+        loop.wakePending = false;
     #endif
-}
\ No newline at end of file
+}
+
+void EventDispatcher::notifyIdle() {
+    #if defined(NATIVE_TEST)
+        // Захват мьютекса гарантирует, что waitIdle() не пропустит уведомление
+        { std::lock_guard<std::mutex> lock(m_idleMutex); }
+        m_idleCv.notify_all();
+    #endif
+    // ESP32: waitIdle() опрашивает счетчики, уведомлять некого
+}
+
+void EventDispatcher::eventLoopTask(void* params) {
+    auto* loop = static_cast<DispatchLoop*>(params);
+    loop->owner->eventLoop(*loop);
+    // Цикл остановлен (stopLoopTasks): задача FreeRTOS не должна возвращаться из функции
+    #if defined(ESP32_TARGET)
+        loop->taskActive.store(false);
+        vTaskDelete(nullptr);
+    #endif
+}
+
+void EventDispatcher::eventLoop(DispatchLoop& loop) {
+    const bool ownsTimers = &loop == &loopFor(EventLane::BULK);
+    #if defined(NATIVE_TEST)
+        loop.threadId.store(std::this_thread::get_id());
+    #endif
+
+    while (m_loopRunning.load(std::memory_order_acquire)) {
+        // 1. Публикуем события наступивших таймеров и рассылаем все накопившиеся события
+        if (ownsTimers) {
+            pollTimers();
+        }
+        if (dispatchPending(loop, loop.laneMask) > 0) {
+            continue;
+        }
+
+        // 2. Буфер пуст: сообщаем waitIdle() и засыпаем до следующего postEvent или таймера
+        notifyIdle();
+        loop.sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (lanesEmpty(loop.laneMask) && m_loopRunning.load()) {
+            sleepLoop(loop, ownsTimers);
+        }
+        loop.sleeping.store(false, std::memory_order_relaxed);
+    }
+
+    // Остановка цикла - доставляем то, что успели опубликовать
+    dispatchPending(loop, loop.laneMask);
+}
@@ -0,0 +1,144 @@
+/*
+ * FlightRecorder.cpp
+ *
+ * Снимок, двоичный дамп и декодер "бортового самописца" EventDispatcher.
+ * Горячий путь (record) - в заголовке; здесь только редкие операции.
+ *
+ * Соответствует: docs/modules/core_event_dispatcher.md
+ */
+#include "core/FlightRecorder.h"
+#include "interfaces/IHalStorage.h"
+#include <cstdio> // snprintf
+
+// --- Вспомогательные функции (little-endian независимо от платформы) ---
+
+static void putU16(std::string& out, uint32_t value) {
+    out.push_back((char)(value & 0xFF));
+    out.push_back((char)((value >> 8) & 0xFF));
+}
+
+static void putU32(std::string& out, uint32_t value) {
+    putU16(out, value & 0xFFFF);
+    putU16(out, value >> 16);
+}
+
+static uint32_t getU16(const std::string& in, size_t pos) {
+    return (uint32_t)(uint8_t)in[pos] | ((uint32_t)(uint8_t)in[pos + 1] << 8);
+}
+
+static uint32_t getU32(const std::string& in, size_t pos) {
+    return getU16(in, pos) | (getU16(in, pos + 2) << 16);
+}
+
+static const char FORMAT_MAGIC[4] = {'E', 'V', 'F', 'R'};
+
+// --- Снимок ---
+
+size_t FlightRecorder::snapshot(std::vector<FlightRecord>& out) const {
+    out.clear();
+
+    uint32_t end = m_head.load(std::memory_order_acquire);
+    uint32_t begin = end > CAPACITY ? end - (uint32_t)CAPACITY : 0;
+    out.reserve(end - begin);
+
+    for (uint32_t n = begin; n != end; ++n) {
+        const Slot& slot = m_slots[n % SLOT_COUNT];
+        // Seqlock: берем запись, только если версия до и после копирования - "номер n записан"
+        const uint32_t expected = 2 * n + 2;
+        if (slot.version.load(std::memory_order_acquire) != expected) continue;
+
+        uint32_t info = slot.words[1].load(std::memory_order_relaxed);
+        FlightRecord record;
+        record.postTimeUs = slot.words[0].load(std::memory_order_relaxed);
+        record.type = static_cast<EventType>(info & 0xFF);
+        record.queueDepth = (uint8_t)((info >> 8) & 0xFF);
+        record.waitUs = (uint16_t)(info >> 16);
+        record.a = (int32_t)slot.words[2].load(std::memory_order_relaxed);
+        record.b = (int32_t)slot.words[3].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.version.load(std::memory_order_relaxed) != expected) continue;
+        out.push_back(record);
+    }
+    return out.size();
+}
+
+// --- Двоичный дамп ---
+
+std::string FlightRecorder::serialize(uint32_t nowUs) const {
+    std::vector<FlightRecord> records;
+    snapshot(records);
+
+    std::string out;
+    out.reserve(HEADER_SIZE + records.size() * RECORD_SIZE);
+    out.append(FORMAT_MAGIC, sizeof(FORMAT_MAGIC));
+    out.push_back((char)FORMAT_VERSION);
+    out.push_back((char)RECORD_SIZE);
+    putU16(out, (uint32_t)records.size());
+    putU32(out, totalRecorded());
+    putU32(out, nowUs);
+
+    for (const FlightRecord& record : records) {
+        putU32(out, record.postTimeUs);
+        out.push_back((char)static_cast<uint8_t>(record.type));
+        out.push_back((char)record.queueDepth);
+        putU16(out, record.waitUs);
+        putU32(out, (uint32_t)record.a);
+        putU32(out, (uint32_t)record.b);
+    }
+    return out;
+}
+
+bool FlightRecorder::dump(IHalStorage* storage, const std::string& path, uint32_t nowUs) const {
+    if (storage == nullptr) return false;
+    return storage->writeFile(path, serialize(nowUs));
+}
+
+// --- Декодер ---
+
+bool FlightRecorder::decode(const std::string& blob, std::vector<FlightRecord>& out,
+                            uint32_t* totalRecorded, uint32_t* dumpTimeUs) {
+    out.clear();
+    if (blob.size() < HEADER_SIZE || blob.compare(0, sizeof(FORMAT_MAGIC), FORMAT_MAGIC, sizeof(FORMAT_MAGIC)) != 0) {
+        return false;
+    }
+    if ((uint8_t)blob[4] != FORMAT_VERSION || (uint8_t)blob[5] != RECORD_SIZE) {
+        return false;
+    }
+
+    size_t count = getU16(blob, 6);
+    if (blob.size() != HEADER_SIZE + count * RECORD_SIZE) {
+        return false;
+    }
+    if (totalRecorded) *totalRecorded = getU32(blob, 8);
+    if (dumpTimeUs) *dumpTimeUs = getU32(blob, 12);
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t pos = HEADER_SIZE + i * RECORD_SIZE;
+        FlightRecord record;
+        record.postTimeUs = getU32(blob, pos);
+        record.type = static_cast<EventType>((uint8_t)blob[pos + 4]);
+        record.queueDepth = (uint8_t)blob[pos + 5];
+        record.waitUs = (uint16_t)getU16(blob, pos + 6);
+        record.a = (int32_t)getU32(blob, pos + 8);
+        record.b = (int32_t)getU32(blob, pos + 12);
+        out.push_back(record);
+    }
+    return true;
+}
+
+std::string FlightRecorder::format(const FlightRecord& record) {
+    char line[128];
+    int len = snprintf(line, sizeof(line), "t=%luus wait=%uus depth=%u %s",
+                       (unsigned long)record.postTimeUs, (unsigned)record.waitUs,
+                       (unsigned)record.queueDepth, eventTypeName(record.type));
+
+    if (record.type == EventType::VIBRATO_DETECTED) {
+        float depth;
+        std::memcpy(&depth, &record.b, sizeof(depth));
+        snprintf(line + len, sizeof(line) - len, " %ld %.2f", (long)record.a, depth);
+    } else {
+        snprintf(line + len, sizeof(line) - len, " %ld %ld", (long)record.a, (long)record.b);
+    }
+    return line;
+}
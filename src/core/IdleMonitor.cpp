@@ -0,0 +1,54 @@
+/*
+ * IdleMonitor.cpp
+ *
+ * Реализация таймаута бездействия (см. IdleMonitor.h).
+ *
+ * Соответствует: docs/modules/hal_power.md
+ */
+#include "core/IdleMonitor.h"
+#include "core/Logger.h"
+
+#define TAG "IdleMonitor"
+
+IdleMonitor::IdleMonitor()
+    : m_dispatcher(nullptr),
+      m_timeoutMs(0),
+      m_timer(INVALID_TIMER_ID) {
+}
+
+bool IdleMonitor::init(EventDispatcher* dispatcher, uint32_t timeoutMs) {
+    if (m_dispatcher && m_timer != INVALID_TIMER_ID) {
+        m_dispatcher->cancelTimer(m_timer);
+    }
+    m_dispatcher = dispatcher;
+    m_timeoutMs = timeoutMs;
+    m_timer = INVALID_TIMER_ID;
+
+    if (m_dispatcher == nullptr || m_timeoutMs == 0) {
+        return m_dispatcher != nullptr;
+    }
+    m_timer = m_dispatcher->startTimer(m_timeoutMs, Event(EventType::SYSTEM_IDLE_TIMEOUT));
+    LOG_INFO(TAG, "Idle timeout armed: %lu ms", (unsigned long)m_timeoutMs);
+    return m_timer != INVALID_TIMER_ID;
+}
+
+void IdleMonitor::subscribe(EventDispatcher* dispatcher) {
+    if (dispatcher == nullptr) return;
+    dispatcher->subscribe(EventType::SENSOR_MASK_CHANGED, this);
+    dispatcher->subscribe(EventType::HALF_HOLE_DETECTED, this);
+    dispatcher->subscribe(EventType::VIBRATO_DETECTED, this);
+    dispatcher->subscribe(EventType::MUTE_ENABLED, this);
+    dispatcher->subscribe(EventType::MUTE_DISABLED, this);
+    dispatcher->subscribe(EventType::NOTE_PITCH_SELECTED, this);
+    dispatcher->subscribe(EventType::BLE_CONNECTED, this);
+}
+
+void IdleMonitor::handleEvent(const Event& event) {
+    (void)event;
+    if (m_dispatcher == nullptr || m_timeoutMs == 0) return;
+
+    // Таймер уже сработал (однократный) - активность после таймаута взводит его заново
+    if (!m_dispatcher->restartTimer(m_timer, m_timeoutMs)) {
+        m_timer = m_dispatcher->startTimer(m_timeoutMs, Event(EventType::SYSTEM_IDLE_TIMEOUT));
+    }
+}
@@ -9,6 +9,7 @@
  */
 
 #include "core/Logger.h"
+#include "core/EventDispatcher.h"
 #include <cstdio>   // vsnprintf
 #include <cstdarg>  // va_list
 #include <cstring>  // strlen
@@ -96,34 +97,102 @@ void Logger::log(LogLevel level, const char* tag, const char* format, ...) {
     // Для безопасности игнорируем, но в debug-сборке можно ассертить.
     if (!m_halUsb || !m_halSystem) return;
 
-    // 2. Захват Мьютекса (Thread Safety)
+    // 2. Форматирование сообщения пользователя
+    // Используем статический буфер для экономии кучи, но осторожно с переполнением
+    // Размер 256 байт обычно достаточен для строки лога
+    char msgBuffer[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(msgBuffer, sizeof(msgBuffer), format, args);
+    va_end(args);
+
+    writeLine(level, tag, msgBuffer);
+}
+
+// --- Дамп гистограмм задержек EventDispatcher ---
+// Формат строки: "wait SENSOR_MASK_CHANGED n=12 max=35us | <1:3 <4:5 <64:4 >=16384:0"
+static int formatHistogram(char* buffer, size_t size, const char* prefix, const LatencyHistogram& hist) {
+    int len = snprintf(buffer, size, "%s n=%lu max=%luus |", prefix,
+                       (unsigned long)hist.totalCount(), (unsigned long)hist.maxUs());
+    for (size_t b = 0; b < LatencyHistogram::BUCKET_COUNT && len > 0 && (size_t)len < size; ++b) {
+        uint32_t count = hist.bucketCount(b);
+        if (count == 0) continue;
+        uint32_t upper = LatencyHistogram::bucketUpperUs(b);
+        if (upper != 0) {
+            len += snprintf(buffer + len, size - len, " <%lu:%lu", (unsigned long)upper, (unsigned long)count);
+        } else {
+            len += snprintf(buffer + len, size - len, " >=%lu:%lu",
+                            (unsigned long)(1u << (LatencyHistogram::BUCKET_COUNT - 2)), (unsigned long)count);
+        }
+    }
+    return len;
+}
+
+void Logger::dumpLatencyStats(EventDispatcher& dispatcher, bool resetAfter) {
+    char line[256];
+    char prefix[64];
+
+    for (size_t i = 0; i < EVENT_TYPE_COUNT; ++i) {
+        EventType type = static_cast<EventType>(i);
+
+        const LatencyHistogram& wait = dispatcher.getQueueWaitHistogram(type);
+        if (wait.totalCount() > 0) {
+            snprintf(prefix, sizeof(prefix), "wait %s", eventTypeName(type));
+            formatHistogram(line, sizeof(line), prefix, wait);
+            writeLine(LogLevel::INFO, "Latency", line);
+        }
+
+        for (size_t slot = 0; slot < dispatcher.getSubscriberCount(type); ++slot) {
+            const LatencyHistogram& handler = dispatcher.getHandlerHistogram(type, slot);
+            if (handler.totalCount() == 0) continue;
+            snprintf(prefix, sizeof(prefix), "handler %s #%u", eventTypeName(type), (unsigned)slot);
+            formatHistogram(line, sizeof(line), prefix, handler);
+            writeLine(LogLevel::INFO, "Latency", line);
+        }
+    }
+
+    if (resetAfter) {
+        dispatcher.resetLatencyStats();
+    }
+}
+
+void Logger::dumpFlightRecorder(const EventDispatcher& dispatcher) {
+    const FlightRecorder& recorder = dispatcher.getFlightRecorder();
+    std::vector<FlightRecord> records;
+    recorder.snapshot(records);
+
+    char line[64];
+    snprintf(line, sizeof(line), "%u of %lu events", (unsigned)records.size(),
+             (unsigned long)recorder.totalRecorded());
+    writeLine(LogLevel::INFO, "Flight", line);
+    for (const FlightRecord& record : records) {
+        writeLine(LogLevel::INFO, "Flight", FlightRecorder::format(record).c_str());
+    }
+}
+
+// --- Вывод готовой строки ---
+void Logger::writeLine(LogLevel level, const char* tag, const char* message) {
+    if (!m_halUsb || !m_halSystem) return;
+
+    // Захват Мьютекса (Thread Safety)
     if (xSemaphoreTake(m_logMutex, portMAX_DELAY)) {
         
-        // 3. Получение времени
+        // Получение времени
         uint32_t timestamp = m_halSystem->getSystemTimestampMs();
 
-        // 4. Форматирование сообщения пользователя
-        // Используем статический буфер для экономии кучи, но осторожно с переполнением
-        // Размер 256 байт обычно достаточен для строки лога
-        char msgBuffer[256];
-        va_list args;
-        va_start(args, format);
-        vsnprintf(msgBuffer, sizeof(msgBuffer), format, args);
-        va_end(args);
-
-        // 5. Форматирование финальной строки: "TIMESTAMP - TAG - LEVEL - MESSAGE"
+        // Форматирование финальной строки: "TIMESTAMP - TAG - LEVEL - MESSAGE"
         // Пример: "12345 - app/logic - INFO - SensorMaskChanged: 0b1101"
         char finalBuffer[320]; // Чуть больше для метаданных
         snprintf(finalBuffer, sizeof(finalBuffer), "%lu - %s - %s - %s", 
                  (unsigned long)timestamp, 
                  tag, 
                  levelToString(level), 
-                 msgBuffer);
+                 message);
 
-        // 6. Отправка в HAL (USB Serial)
+        // Отправка в HAL (USB Serial)
         m_halUsb->serialPrint(std::string(finalBuffer));
 
-        // 7. Освобождение Мьютекса
+        // Освобождение Мьютекса
         xSemaphoreGive(m_logMutex);
     }
 }
\ No newline at end of file
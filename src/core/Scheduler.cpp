@@ -10,10 +10,25 @@
 
 #include "core/Scheduler.h"
 
+#if defined(ESP32_TARGET)
+    #include "esp_system.h"
+#endif
+
 // (Определение TAG для Логгера)
 #define TAG "Scheduler"
 
-Application::Application() {
+#if defined(ESP32_TARGET)
+// Экземпляр для обработчика перезагрузки (esp_register_shutdown_handler не передает контекст)
+static Application* s_shutdownApp = nullptr;
+
+static void dumpFlightRecorderOnShutdown() {
+    if (s_shutdownApp) {
+        s_shutdownApp->dumpFlightRecorder();
+    }
+}
+#endif
+
+Application::Application() : m_storage(nullptr) {
     // Конструктор
 }
 
@@ -33,6 +48,7 @@ void Application::init(
     // --- Фаза 1: Хранилище, Система и Конфигурация ---
     // Сначала грузим конфиг, так как от него зависят многие HAL модули
     m_configManager.init(storage);
+    m_storage = storage;
 
     // --- Фаза 2: USB и Логирование ---
     usb->init(storage);
@@ -42,8 +58,29 @@ void Application::init(
     LOG_INFO(TAG, "Boot: Logger initialized.");
 
     // --- Фаза 3: Диспетчер Событий ---
-    m_eventDispatcher.init();
-    LOG_INFO(TAG, "Boot: EventDispatcher running.");
+    // dual_core_dispatch: цикл на каждую полосу, закрепленный за своим ядром
+    DispatchLoopConfig loops = {false, {NO_CORE_AFFINITY, NO_CORE_AFFINITY}};
+    if (m_configManager.getDualCoreDispatch()) {
+        loops.dualLoop = true;
+        loops.laneCore[static_cast<size_t>(EventLane::REALTIME)] = m_configManager.getRealtimeCore();
+        loops.laneCore[static_cast<size_t>(EventLane::BULK)] = m_configManager.getBulkCore();
+    }
+    if (!m_eventDispatcher.init(loops)) {
+        LOG_ERROR(TAG, "Boot: EventDispatcher init failed, events will not be delivered.");
+    }
+    m_eventDispatcher.configureLane(EventLane::REALTIME, m_configManager.getRealtimeQueueConfig());
+    m_eventDispatcher.configureLane(EventLane::BULK, m_configManager.getBulkQueueConfig());
+    m_eventDispatcher.setBlockTimeoutMs((uint32_t)m_configManager.getQueueBlockTimeoutMs());
+    LOG_INFO(TAG, "Boot: EventDispatcher running (%u loop(s)).", (unsigned)m_eventDispatcher.getLoopCount());
+
+    #if defined(ESP32_TARGET)
+        // Последние события перед программной перезагрузкой сохраняются во флеш.
+        // (В обработчике паники писать во флеш нельзя - там доступен только дамп по запросу.)
+        if (s_shutdownApp == nullptr) {
+            s_shutdownApp = this;
+            esp_register_shutdown_handler(dumpFlightRecorderOnShutdown);
+        }
+    #endif
 
     // --- Фаза 4: Инициализация HAL и APP ---
     
@@ -52,10 +89,13 @@ void Application::init(
     led->init(&m_configManager);
     ble->init(&m_eventDispatcher);
     power->init(&m_configManager, &m_eventDispatcher);
+    int autoOffMin = m_configManager.getAutoOffTimeMin();
+    m_idleMonitor.init(&m_eventDispatcher, autoOffMin > 0 ? (uint32_t)autoOffMin * 60u * 1000u : 0);
     
     // APP
     m_appFingering.init(storage);
     m_appLogic.init(&m_configManager, &m_eventDispatcher);
+    m_appLogic.setKnownFingerings(&m_appFingering); // Для mask_settle_ms
     
     // Для Midi нужна базовая частота из конфига
     float basePitch = m_configManager.getBasePitchHz();
@@ -64,12 +104,29 @@ void Application::init(
     LOG_INFO(TAG, "Boot: Modules initialized.");
 
     // --- Фаза 5: Настройка Подписок ---
+    // fused_pipeline: logic -> fingering -> midi прямыми вызовами (до subscribe!)
+    bool fused = m_configManager.getFusedPipeline();
+    m_pipelineBus.bind(&m_appFingering);
+    m_pipelineBus.bind(&m_appMidi);
+    m_pipelineBus.setMirror(&m_eventDispatcher); // События - наблюдателям
+    m_appLogic.setFusedPipeline(fused ? &m_pipelineBus : nullptr);
+    m_appFingering.setFusedPipeline(fused ? &m_pipelineBus : nullptr);
+    m_appMidi.setFusedMode(fused);
+    if (fused) {
+        LOG_INFO(TAG, "Boot: Fused pipeline enabled.");
+    }
+
     m_appLogic.subscribe(&m_eventDispatcher);
     m_appMidi.subscribe(&m_eventDispatcher);
     m_appFingering.subscribe(&m_eventDispatcher);
     
     // HAL подписки
     power->subscribe(&m_eventDispatcher);
+    m_idleMonitor.subscribe(&m_eventDispatcher);
+
+    // Полосы больше не меняются (postEvent читает их без блокировок); подписки можно
+    // менять и дальше - через снимки (unsubscribe/replaceSubscribers)
+    m_eventDispatcher.freezeSubscriptions();
     
     LOG_INFO(TAG, "Boot sequence complete. Ready.");
 }
@@ -86,10 +143,18 @@ void Application::startTasks(
     LOG_INFO(TAG, "Boot: Starting FreeRTOS tasks...");
 
     sensors->startTask();
-    m_appLogic.startTask();
+    // DSP сенсоров и вибрато - на ядре цикла BULK, подальше от пути "палец -> нота"
+    m_appLogic.startTask(m_configManager.getDualCoreDispatch() ? m_configManager.getBulkCore() : NO_CORE_AFFINITY);
     led->startTask();
     ble->startTask();
     power->startTask();
     
     LOG_INFO(TAG, "Boot: All tasks started. System running.");
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Сохраняет "бортовой самописец" диспетчера
+ */
+bool Application::dumpFlightRecorder() {
+    return m_eventDispatcher.dumpFlightRecorder(m_storage);
+}
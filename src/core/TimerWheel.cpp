@@ -0,0 +1,298 @@
+/*
+ * TimerWheel.cpp
+ *
+ * Реализация иерархического колеса таймеров (см. TimerWheel.h).
+ *
+ * Таймер с задержкой delta = expiry - m_now лежит на уровне L, где 64^L <= delta < 64^(L+1),
+ * в слоте (expiry >> 6L) & 63. Когда время доходит до границы уровня L, слот
+ * "каскадируется": таймеры перекладываются на нижние уровни. На уровне 0 слот
+ * (m_now & 63) содержит ровно те таймеры, что срабатывают в этот тик.
+ *
+ * Соответствует: docs/modules/core_event_dispatcher.md
+ */
+#include "core/TimerWheel.h"
+
+TimerWheel::TimerWheel() : m_now(0), m_generation(0) {
+    #if defined(ESP32_TARGET)
+        portMUX_INITIALIZE(&m_mux);
+    #endif
+    for (size_t i = 0; i < LEVEL_COUNT * SLOT_COUNT; ++i) {
+        m_buckets[i] = NIL;
+    }
+}
+
+void TimerWheel::reset(uint32_t nowMs) {
+    lock();
+    for (size_t i = 0; i < MAX_TIMERS; ++i) {
+        m_timers[i].id = INVALID_TIMER_ID;
+        m_timers[i].bucket = NO_BUCKET;
+    }
+    for (size_t i = 0; i < LEVEL_COUNT * SLOT_COUNT; ++i) {
+        m_buckets[i] = NIL;
+    }
+    m_now = nowMs;
+    unlock();
+}
+
+TimerId TimerWheel::start(uint32_t nowMs, uint32_t delayMs, const Event& event, uint32_t periodMs) {
+    lock();
+    int index = -1;
+    for (size_t i = 0; i < MAX_TIMERS; ++i) {
+        if (m_timers[i].id == INVALID_TIMER_ID) {
+            index = (int)i;
+            break;
+        }
+    }
+    if (index < 0) {
+        unlock();
+        return INVALID_TIMER_ID;
+    }
+
+    Timer& timer = m_timers[index];
+    TimerId id;
+    do {
+        ++m_generation;
+        id = m_generation * (uint32_t)MAX_TIMERS + (uint32_t)index + 1;
+    } while (id == INVALID_TIMER_ID);
+
+    timer.id = id;
+    timer.event = event;
+    timer.period = periodMs;
+    timer.expiry = nowMs + (delayMs > 0 ? delayMs : 1);
+    if ((int32_t)(timer.expiry - m_now) <= 0) {
+        timer.expiry = m_now + 1;
+    }
+    place((uint8_t)index);
+    unlock();
+    return id;
+}
+
+bool TimerWheel::cancel(TimerId id) {
+    lock();
+    int index = findIndex(id);
+    if (index >= 0) {
+        unlink((uint8_t)index);
+        m_timers[index].id = INVALID_TIMER_ID;
+    }
+    unlock();
+    return index >= 0;
+}
+
+bool TimerWheel::restart(TimerId id, uint32_t nowMs, uint32_t delayMs) {
+    lock();
+    int index = findIndex(id);
+    if (index >= 0) {
+        Timer& timer = m_timers[index];
+        unlink((uint8_t)index);
+        timer.expiry = nowMs + (delayMs > 0 ? delayMs : 1);
+        if ((int32_t)(timer.expiry - m_now) <= 0) {
+            timer.expiry = m_now + 1;
+        }
+        place((uint8_t)index);
+    }
+    unlock();
+    return index >= 0;
+}
+
+bool TimerWheel::isActive(TimerId id) const {
+    lock();
+    bool active = findIndex(id) >= 0;
+    unlock();
+    return active;
+}
+
+size_t TimerWheel::activeCount() const {
+    lock();
+    size_t count = 0;
+    for (size_t i = 0; i < MAX_TIMERS; ++i) {
+        if (m_timers[i].id != INVALID_TIMER_ID) ++count;
+    }
+    unlock();
+    return count;
+}
+
+bool TimerWheel::nextExpiry(uint32_t& expiryMs) const {
+    lock();
+    bool found = nextExpiryLocked(expiryMs);
+    unlock();
+    return found;
+}
+
+size_t TimerWheel::advance(uint32_t nowMs, Fired (&out)[MAX_TIMERS]) {
+    lock();
+    size_t count = 0;
+    while (count == 0 && (int32_t)(nowMs - m_now) > 0) {
+        uint32_t next = 0;
+        if (!nextExpiryLocked(next) || (int32_t)(next - nowMs) > 0) {
+            // До nowMs ничего не срабатывает - перескакиваем сразу
+            jumpTo(nowMs);
+            break;
+        }
+        if ((int32_t)(next - m_now) > 1) {
+            jumpTo(next - 1);
+        }
+        count = tick(out);
+    }
+    unlock();
+    return count;
+}
+
+// --- Приватные методы (под блокировкой) ---
+
+void TimerWheel::place(uint8_t index) {
+    Timer& timer = m_timers[index];
+    int32_t delta = (int32_t)(timer.expiry - m_now);
+
+    size_t level = 0;
+    uint32_t slotTime = timer.expiry;
+    if (delta <= 0) {
+        // Срок уже наступил (каскад в тике срабатывания) - текущий слот уровня 0
+        slotTime = m_now;
+    } else {
+        uint32_t limit = SLOT_COUNT;
+        while (level + 1 < LEVEL_COUNT && (uint32_t)delta >= limit) {
+            ++level;
+            limit <<= SLOT_BITS;
+        }
+        if ((uint32_t)delta >= limit) {
+            // Дальше горизонта колеса: кладем на последний слот, потом переложим
+            slotTime = m_now + limit - 1;
+        }
+    }
+
+    uint16_t bucket = (uint16_t)(level * SLOT_COUNT + ((slotTime >> (level * SLOT_BITS)) & (SLOT_COUNT - 1)));
+    timer.bucket = bucket;
+    timer.prev = NIL;
+    timer.next = m_buckets[bucket];
+    if (timer.next != NIL) {
+        m_timers[timer.next].prev = index;
+    }
+    m_buckets[bucket] = index;
+}
+
+void TimerWheel::unlink(uint8_t index) {
+    Timer& timer = m_timers[index];
+    if (timer.bucket == NO_BUCKET) return;
+
+    if (timer.prev != NIL) {
+        m_timers[timer.prev].next = timer.next;
+    } else {
+        m_buckets[timer.bucket] = timer.next;
+    }
+    if (timer.next != NIL) {
+        m_timers[timer.next].prev = timer.prev;
+    }
+    timer.next = NIL;
+    timer.prev = NIL;
+    timer.bucket = NO_BUCKET;
+}
+
+void TimerWheel::cascade(size_t level) {
+    uint16_t bucket = (uint16_t)(level * SLOT_COUNT + ((m_now >> (level * SLOT_BITS)) & (SLOT_COUNT - 1)));
+    uint8_t index = m_buckets[bucket];
+    m_buckets[bucket] = NIL;
+    while (index != NIL) {
+        uint8_t next = m_timers[index].next;
+        m_timers[index].bucket = NO_BUCKET;
+        place(index);
+        index = next;
+    }
+}
+
+size_t TimerWheel::tick(Fired (&out)[MAX_TIMERS]) {
+    ++m_now;
+
+    // Каскад с верхних уровней: переложенные сверху таймеры успевают спуститься ниже в этот же тик
+    const uint32_t mask = SLOT_COUNT - 1;
+    if ((m_now & mask) == 0) {
+        if (((m_now >> SLOT_BITS) & mask) == 0) {
+            if (((m_now >> (2 * SLOT_BITS)) & mask) == 0) {
+                cascade(3);
+            }
+            cascade(2);
+        }
+        cascade(1);
+    }
+
+    size_t count = 0;
+    uint16_t bucket = (uint16_t)(m_now & mask);
+    uint8_t index = m_buckets[bucket];
+    m_buckets[bucket] = NIL;
+    while (index != NIL) {
+        Timer& timer = m_timers[index];
+        uint8_t next = timer.next;
+        timer.bucket = NO_BUCKET;
+
+        if ((int32_t)(timer.expiry - m_now) <= 0) {
+            out[count++].event = timer.event;
+            if (timer.period > 0) {
+                timer.expiry += timer.period;
+                if ((int32_t)(timer.expiry - m_now) <= 0) {
+                    // Отстали больше чем на период: пропущенные срабатывания не догоняем
+                    timer.expiry = m_now + timer.period;
+                }
+                place(index);
+            } else {
+                timer.id = INVALID_TIMER_ID;
+            }
+        } else {
+            place(index);
+        }
+        index = next;
+    }
+    return count;
+}
+
+void TimerWheel::jumpTo(uint32_t nowMs) {
+    if (nowMs == m_now) return;
+    m_now = nowMs;
+
+    // Границы уровней пропущены - раскладываем активные таймеры заново (их не больше MAX_TIMERS)
+    for (size_t i = 0; i < LEVEL_COUNT * SLOT_COUNT; ++i) {
+        m_buckets[i] = NIL;
+    }
+    for (size_t i = 0; i < MAX_TIMERS; ++i) {
+        if (m_timers[i].id != INVALID_TIMER_ID) {
+            m_timers[i].bucket = NO_BUCKET;
+            place((uint8_t)i);
+        }
+    }
+}
+
+bool TimerWheel::nextExpiryLocked(uint32_t& expiryMs) const {
+    bool found = false;
+    int32_t best = INT32_MAX;
+    for (size_t i = 0; i < MAX_TIMERS; ++i) {
+        const Timer& timer = m_timers[i];
+        if (timer.id == INVALID_TIMER_ID) continue;
+        int32_t delta = (int32_t)(timer.expiry - m_now);
+        if (!found || delta < best) {
+            best = delta;
+            expiryMs = timer.expiry;
+            found = true;
+        }
+    }
+    return found;
+}
+
+int TimerWheel::findIndex(TimerId id) const {
+    if (id == INVALID_TIMER_ID) return -1;
+    size_t index = (id - 1) % MAX_TIMERS;
+    return m_timers[index].id == id ? (int)index : -1;
+}
+
+void TimerWheel::lock() const {
+    #if defined(ESP32_TARGET)
+        taskENTER_CRITICAL(&m_mux);
+    #elif defined(NATIVE_TEST)
+        m_mutex.lock();
+    #endif
+}
+
+void TimerWheel::unlock() const {
+    #if defined(ESP32_TARGET)
+        taskEXIT_CRITICAL(&m_mux);
+    #elif defined(NATIVE_TEST)
+        m_mutex.unlock();
+    #endif
+}
@@ -165,6 +165,30 @@ void test_half_hole_wrong_order() {
     TEST_ASSERT_EQUAL_INT(60, spy.getLastIntPayload());
 }
 
+/**
+ * @brief Тест 5: Маски шире 8 бит (9-й и следующие сенсоры) и маска шире HOLE_MASK_BITS.
+ */
+void test_wide_masks() {
+    std::string cfg =
+        "0b100000000001 70\n"   // S11 и S0
+        "0x0800 72\n"           // Только S11
+        "0x1FFFFFFFF 74\n";     // 33 бита - не помещается ни в одну ширину
+    mockStorage.writeFile("/fingering.cfg", cfg);
+    appFingering.init(&mockStorage);
+
+    appFingering.subscribe(&dispatcher);
+    dispatcher.subscribe(EventType::NOTE_PITCH_SELECTED, &spy);
+
+    TEST_ASSERT_TRUE(appFingering.isKnownMask(0x801));
+    TEST_ASSERT_FALSE(appFingering.isKnownMask(0x01)); // Старшие биты не обрезаются
+    TEST_ASSERT_EQUAL(2, appFingering.knownMasks().size());
+
+    appFingering.handleEvent(Event(EventType::SENSOR_MASK_CHANGED, SensorMaskPayload{0x801}));
+    TEST_ASSERT_EQUAL_INT(70, spy.getLastIntPayload());
+    appFingering.handleEvent(Event(EventType::SENSOR_MASK_CHANGED, SensorMaskPayload{0x800}));
+    TEST_ASSERT_EQUAL_INT(72, spy.getLastIntPayload());
+}
+
 
 int main(int argc, char **argv) {
     UNITY_BEGIN();
@@ -173,6 +197,7 @@ int main(int argc, char **argv) {
     RUN_TEST(test_half_hole_logic);
     RUN_TEST(test_deduplication);
     RUN_TEST(test_half_hole_wrong_order); // <-- Новый тест
+    RUN_TEST(test_wide_masks);
     
     return UNITY_END();
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
  */
 #include <unity.h>
 #include "app/AppLogic.h"
+#include "app/AppFingering.h"
 #include "MockHalStorage.h"
 #include "MockEventHandler.h"
 #include "core/EventDispatcher.h"
@@ -37,6 +38,10 @@ void setUp(void) {
         std::remove("data/settings.cfg.bak");
         std::rename("data/settings.cfg", "data/settings.cfg.bak");
     }
+    if (file_exists("data/fingering.cfg")) {
+        std::remove("data/fingering.cfg.bak");
+        std::rename("data/fingering.cfg", "data/fingering.cfg.bak");
+    }
     
     // Пишем конфиг
     std::string cfg = 
@@ -70,6 +75,10 @@ void tearDown(void) {
     if (file_exists("data/settings.cfg.bak")) {
         std::rename("data/settings.cfg.bak", "data/settings.cfg");
     }
+    std::remove("data/fingering.cfg");
+    if (file_exists("data/fingering.cfg.bak")) {
+        std::rename("data/fingering.cfg.bak", "data/fingering.cfg");
+    }
 }
 
 // ... (тесты mute и mask без изменений) ...
@@ -134,17 +143,733 @@ void test_vibrato_logic() {
     // (Оно могло быть обнаружено несколько раз за секунду)
     TEST_ASSERT_TRUE_MESSAGE(spy.getReceivedCount() > 0, "Vibrato should be detected");
     TEST_ASSERT_EQUAL(EventType::VIBRATO_DETECTED, spy.getLastEventType());
+
+    // Все 50 сэмплов прошли через внутреннюю очередь без потерь
+    TEST_ASSERT_EQUAL_INT(0, appLogic.getSensorQueue().getDroppedCount());
+    TEST_ASSERT_EQUAL_INT(0, appLogic.getSensorQueue().getGapCount());
+    TEST_ASSERT_EQUAL_INT(1, appLogic.getSensorQueue().getHighWaterMark());
     
     // Проверяем, что в payload есть глубина > 0
     // Наш MockEventHandler не сохраняет float payload для Vibrato (нужно доработать мок!)
     // Но сам факт получения события VIBRATO_DETECTED уже говорит об успехе.
 }
 
+/**
+ * @brief Тест 5: Кадр опроса (SENSOR_FRAME) - маска пересчитывается один раз за кадр.
+ */
+void test_sensor_frame_single_mask_update() {
+    // Сенсоры 0 и 1 закрыты, 2 - полузакрыт, Mute (8) открыт
+    SensorFramePayload frame = {};
+    frame.timestampMs = 20;
+    frame.count = 9;
+    frame.values[0] = 500;
+    frame.values[1] = 500;
+    frame.values[2] = 350;
+
+    appLogic.handleEvent(Event(EventType::SENSOR_FRAME, frame));
+
+    // Ровно два события: одна МАСКА (а не три промежуточных) и затем Half-Hole
+    TEST_ASSERT_EQUAL_INT(2, spy.getReceivedCount());
+    TEST_ASSERT_EQUAL(EventType::HALF_HOLE_DETECTED, spy.getLastEventType());
+    TEST_ASSERT_EQUAL_INT(2, spy.getLastIntPayload());
+
+    // Тот же кадр еще раз: состояния не изменились -> событий нет
+    spy.reset();
+    appLogic.handleEvent(Event(EventType::SENSOR_FRAME, frame));
+    TEST_ASSERT_EQUAL_INT(0, spy.getReceivedCount());
+
+    // Mute внутри кадра
+    frame.values[8] = 600;
+    appLogic.handleEvent(Event(EventType::SENSOR_FRAME, frame));
+    TEST_ASSERT_EQUAL(EventType::MUTE_ENABLED, spy.getLastEventType());
+}
+
+/**
+ * @brief Тест 6: Диспетчер отсекает значения чужих сенсоров до очереди AppLogic.
+ */
+void test_sensor_subscription_filter() {
+    // hole_sensor_ids = 0..7, mute_sensor_id = 8
+    TEST_ASSERT_EQUAL_UINT32(0x1FF, appLogic.sensorFilter().idMask);
+
+    appLogic.subscribe(&dispatcher);
+    SubscriberSet set;
+    dispatcher.getSubscribers(set);
+    TEST_ASSERT_TRUE(set.at(EventType::SENSOR_VALUE_CHANGED, 0) == &appLogic);
+    TEST_ASSERT_EQUAL_UINT32(0x1FF, set.filterAt(EventType::SENSOR_VALUE_CHANGED, 0).idMask);
+    TEST_ASSERT_TRUE(set.filterAt(EventType::SENSOR_FRAME, 0).passesAll());
+
+    dispatcher.postEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{12, 900}));
+    TEST_ASSERT_EQUAL_INT(0, spy.getReceivedCount());
+    TEST_ASSERT_EQUAL_UINT32(0, appLogic.getSensorQueue().getHighWaterMark());
+    dispatcher.postEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{8, 600}));
+    TEST_ASSERT_EQUAL(EventType::MUTE_ENABLED, spy.getLastEventType());
+}
+
+void test_history_ring_wraps_in_order() {
+    HistoryRing<uint16_t, 8> ring;
+    ring.setCapacity(100); // Насыщается до MaxCapacity
+    TEST_ASSERT_EQUAL(8, ring.capacity());
+    ring.setCapacity(4);
+    TEST_ASSERT_TRUE(ring.empty());
+
+    for (uint16_t v = 1; v <= 6; ++v) ring.push(v);
+    TEST_ASSERT_TRUE(ring.full());
+    TEST_ASSERT_EQUAL(3, ring.oldest());
+    TEST_ASSERT_EQUAL(6, ring.newest());
+
+    // Вид непрерывный и упорядочен от старого к новому даже после переноса
+    HistoryRing<uint16_t, 8>::View view = ring.view();
+    TEST_ASSERT_EQUAL(4, view.size());
+    for (size_t i = 0; i < view.size(); ++i) {
+        TEST_ASSERT_EQUAL(3 + i, view[i]);
+    }
+}
+
+// Эталон: прежний полный проход analyzeVibrato (амплитуда и пересечения среднего)
+static void fullScanVibratoStats(const SensorHistory::View& history, int& amplitude, int& crossings) {
+    int minVal = 4096;
+    int maxVal = 0;
+    long sum = 0;
+    for (int v : history) {
+        if (v < minVal) minVal = v;
+        if (v > maxVal) maxVal = v;
+        sum += v;
+    }
+    amplitude = maxVal - minVal;
+
+    int avg = sum / history.size();
+    crossings = 0;
+    bool above = (history[0] > avg);
+    for (size_t i = 1; i < history.size(); ++i) {
+        bool nowAbove = (history[i] > avg);
+        if (nowAbove != above) {
+            crossings++;
+            above = nowAbove;
+        }
+    }
+}
+
+/**
+ * @brief Инкрементальная статистика окна совпадает с полным проходом на записанных потоках.
+ */
+void test_vibrato_window_matches_full_scan() {
+    const size_t capacities[] = {7, 50, 128};
+    uint32_t rng = 12345;
+
+    for (size_t capacity : capacities) {
+        for (int stream = 0; stream < 3; ++stream) {
+            SensorHistory window;
+            window.setCapacity(capacity);
+
+            for (int i = 0; i < 600; ++i) {
+                rng = rng * 1664525u + 1013904223u;
+                int noise = (int)((rng >> 16) % 21) - 10;
+                int value;
+                if (stream == 0) {
+                    // Вибрато 4 Гц на 50 Гц, затем ровное закрытое отверстие
+                    value = i < 300 ? 350 + (int)(120 * sin(2 * 3.14159f * 4.0f * i / 50.0f)) + noise : 450 + noise;
+                } else if (stream == 1) {
+                    // Открытие/закрытие ступеньками и медленный дрейф базовой линии
+                    value = ((i / 37) % 2 ? 500 : 100) + i / 4 + noise;
+                } else {
+                    // Широкий диапазон, включая значения выше 4096
+                    value = (int)((rng >> 8) % 6000);
+                }
+                window.push((uint16_t)value);
+
+                // Запрашиваем не на каждом значении: счетчик обязан вести себя и между запросами
+                if (i % 3 == 2 || stream == 0) {
+                    int amplitude, crossings;
+                    fullScanVibratoStats(window.view(), amplitude, crossings);
+                    int minVal = window.minValue() < 4096 ? window.minValue() : 4096;
+                    TEST_ASSERT_EQUAL_INT(amplitude, window.maxValue() - minVal);
+                    TEST_ASSERT_EQUAL_INT(crossings, window.crossings());
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Вибрато с нецелым числом периодов в окне (среднее колеблется от значения к значению):
+ * сетка строится проходом по окну один раз, сдвиги порога меняют сторону O(1) значений.
+ */
+void test_vibrato_window_bounded_rescans() {
+    const float freqs[] = {4.5f, 3.3f};
+    const int noises[] = {0, 8};
+    uint32_t rng = 777;
+
+    for (int k = 0; k < 2; ++k) {
+        SensorHistory window;
+        window.setCapacity(50);
+        const int samples = 5000;
+        for (int i = 0; i < samples; ++i) {
+            rng = rng * 1664525u + 1013904223u;
+            const int noise = noises[k] ? (int)((rng >> 16) % (2 * noises[k] + 1)) - noises[k] : 0;
+            window.push((uint16_t)(450 + (int)(40 * sin(2 * 3.14159f * freqs[k] * i / 50.0f)) + noise));
+            // Как analyzeVibrato: запрос на каждом значении с половины окна
+            if (window.size() < window.capacity() / 2) continue;
+            const int crossings = window.crossings();
+            if (i % 97 == 0) {
+                int amplitude, expected;
+                fullScanVibratoStats(window.view(), amplitude, expected);
+                TEST_ASSERT_EQUAL_INT(expected, crossings);
+            }
+        }
+        TEST_ASSERT_TRUE(window.gridBuilds() <= 2);
+        TEST_ASSERT_TRUE(window.thresholdFlips() <= (uint32_t)samples * 2);
+    }
+}
+
+// Считает только VIBRATO_DETECTED (spy видит и маску/полузакрытие)
+struct VibratoCounter : public IEventHandler {
+    int count = 0;
+    float lastDepth = 0.0f;
+    void handleEvent(const Event& event) override {
+        if (event.type != EventType::VIBRATO_DETECTED) return;
+        ++count;
+        lastDepth = event.payload.vibrato.depth;
+    }
+};
+
+// Поток одного отверстия, сохраненный таблицей (50 Гц): открыто, закрытие, вибрато 3.5 -> 5.5 Гц
+// с нарастающей глубиной и дрейфом, трель 8 Гц, медленная волна 1 Гц, вибрато 5.8 Гц, снятие пальца
+static const uint16_t RECORDED_HOLE_STREAM[] = {
+    121, 122, 126, 121, 121, 122, 123, 117, 116, 126, 122, 121, 124, 123, 126,
+    116, 115, 121, 118, 116, 115, 122, 126, 125, 124, 114, 123, 120, 121, 124,
+    125, 123, 124, 116, 123, 114, 122, 115, 114, 114, 117, 129, 147, 150, 174,
+    181, 191, 205, 219, 225, 242, 249, 268, 274, 289, 294, 316, 319, 337, 352,
+    358, 372, 386, 391, 413, 418, 431, 450, 447, 452, 460, 467, 474, 483, 480,
+    459, 451, 433, 424, 419, 415, 419, 441, 445, 462, 474, 478, 485, 476, 469,
+    450, 434, 417, 420, 423, 426, 449, 464, 473, 485, 485, 482, 471, 448, 437,
+    429, 410, 412, 423, 448, 457, 474, 485, 495, 493, 473, 449, 437, 420, 409,
+    419, 434, 449, 477, 495, 494, 495, 487, 462, 436, 423, 412, 410, 420, 445,
+    476, 493, 499, 494, 484, 462, 442, 424, 414, 415, 421, 444, 471, 493, 507,
+    501, 480, 466, 438, 414, 405, 415, 430, 457, 483, 504, 513, 502, 471, 439,
+    423, 405, 408, 431, 457, 482, 511, 516, 507, 475, 449, 417, 409, 403, 425,
+    455, 492, 509, 523, 502, 473, 449, 420, 404, 406, 438, 468, 501, 523, 515,
+    499, 459, 426, 401, 395, 421, 449, 485, 521, 531, 513, 479, 443, 415, 400,
+    409, 443, 476, 519, 524, 516, 486, 451, 416, 402, 410, 442, 475, 514, 530,
+    520, 495, 442, 406, 394, 409, 445, 485, 518, 530, 517, 480, 437, 406, 398,
+    413, 454, 503, 531, 538, 509, 469, 425, 400, 402, 439, 480, 529, 537, 522,
+    487, 436, 405, 391, 414, 463, 520, 549, 533, 502, 444, 410, 388, 411, 456,
+    511, 522, 485, 431, 411, 453, 499, 534, 503, 447, 407, 441, 491, 527, 506,
+    460, 414, 419, 477, 530, 514, 471, 423, 410, 466, 520, 527, 484, 432, 406,
+    451, 500, 524, 493, 446, 406, 433, 492, 533, 510, 456, 418, 429, 480, 525,
+    521, 471, 422, 411, 465, 522, 529, 478, 427, 415, 443, 506, 523, 495, 447,
+    406, 436, 498, 531, 515, 457, 411, 418, 476, 522, 516, 474, 423, 413, 465,
+    512, 533, 483, 433, 413, 449, 502, 528, 498, 446, 409, 432, 496, 528, 517,
+    462, 419, 421, 474, 524, 517, 473, 419, 413, 459, 466, 482, 491, 497, 518,
+    517, 529, 535, 540, 552, 556, 556, 556, 559, 558, 559, 553, 546, 543, 530,
+    527, 516, 504, 491, 476, 464, 457, 451, 431, 431, 423, 407, 404, 394, 387,
+    389, 388, 384, 375, 386, 381, 389, 396, 398, 403, 424, 425, 434, 454, 455,
+    476, 475, 496, 498, 514, 517, 535, 541, 549, 555, 561, 557, 554, 563, 555,
+    552, 552, 543, 535, 536, 516, 519, 504, 494, 486, 464, 455, 445, 435, 433,
+    417, 411, 406, 397, 391, 388, 388, 377, 381, 388, 390, 386, 390, 401, 414,
+    418, 423, 438, 449, 456, 489, 497, 499, 477, 447, 424, 419, 442, 465, 495,
+    503, 496, 460, 428, 421, 428, 451, 483, 496, 499, 479, 452, 419, 414, 432,
+    465, 488, 502, 502, 465, 439, 420, 413, 434, 472, 496, 506, 489, 465, 428,
+    417, 418, 449, 488, 497, 501, 484, 441, 418, 418, 432, 467, 498, 500, 495,
+    462, 438, 422, 422, 448, 480, 500, 504, 488, 460, 422, 422, 424, 457, 488,
+    505, 497, 479, 445, 424, 413, 439, 469, 497, 502, 458, 454, 440, 433, 417,
+    408, 396, 392, 382, 368, 363, 351, 337, 330, 322, 305, 302, 284, 283, 270,
+    254, 252, 234, 232, 220, 212, 206, 193, 175, 171, 155, 155, 136, 125, 122,
+    111, 100, 96, 80, 68, 57, 51, 41, 26, 19, 10, 1, 2, 0, 0
+};
+
+/**
+ * @brief На записанном потоке AppLogic принимает те же решения о вибрато и глубине, что и
+ * прежний полный проход по истории (на каждом значении).
+ */
+void test_vibrato_decisions_match_full_scan_on_recording() {
+    mockStorage.writeFile("/settings.cfg",
+        "[sensors]\n"
+        "sample_rate_hz = 50\n"
+        "hole_closed_threshold = 400\n"
+        "half_hole_threshold = 300\n"
+        "adaptive_thresholds = false\n"
+        "[app_logic]\n"
+        "mute_sensor_id = 8\n"
+        "hole_sensor_ids = 0, 1, 2, 3, 4, 5, 6, 7\n"
+        "mask_settle_ms = 0\n"
+        "predict_onset_ms = 0\n"
+        "[gestures]\n"
+        "vibrato_freq_min_hz = 2.0\n"
+        "vibrato_freq_max_hz = 6.0\n"
+        "vibrato_amplitude_min = 50\n"
+        "vibrato_detector = zero_crossing\n");
+    configManager.init(&mockStorage);
+    appLogic.init(&configManager, &dispatcher);
+
+    VibratoCounter vibrato;
+    dispatcher.subscribe(EventType::VIBRATO_DETECTED, &vibrato);
+
+    SensorHistory reference; // Только как кольцо значений для полного прохода
+    reference.setCapacity(50);
+    int detections = 0;
+    for (uint16_t value : RECORDED_HOLE_STREAM) {
+        const int before = vibrato.count;
+        appLogic.handleEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{0, value}));
+        reference.push(value);
+
+        float expected = 0.0f;
+        if (reference.size() >= reference.capacity() / 2) {
+            int amplitude, crossings;
+            fullScanVibratoStats(reference.view(), amplitude, crossings);
+            const float freq = ((float)crossings / 2.0f) / ((float)reference.size() / 50.0f);
+            if (amplitude >= 50 && freq >= 2.0f && freq <= 6.0f) {
+                expected = (float)amplitude / 500.0f;
+                if (expected > 1.0f) expected = 1.0f;
+            }
+        }
+        TEST_ASSERT_EQUAL_INT(expected > 0.0f ? 1 : 0, vibrato.count - before);
+        if (expected > 0.0f) {
+            // Глубина в очереди событий - Q1.15 (см. PackedEvent)
+            TEST_ASSERT_FLOAT_WITHIN(1.0f / 65536.0f, expected, vibrato.lastDepth);
+            ++detections;
+        }
+    }
+    // Запись содержит и вибрато, и отказы (трель, волна, ступеньки)
+    TEST_ASSERT_TRUE(detections > 100);
+    TEST_ASSERT_TRUE(detections < (int)(sizeof(RECORDED_HOLE_STREAM) / sizeof(RECORDED_HOLE_STREAM[0])) - 100);
+    dispatcher.unsubscribe(EventType::VIBRATO_DETECTED, &vibrato);
+}
+
+/**
+ * @brief Банк бинов находит частоту и размах синусоиды, сторожевые бины отсекают медленное движение.
+ */
+void test_sliding_dft_bank_frequency() {
+    SlidingDftBank bank;
+    bank.configure(50.0f, 2.0f, 6.0f, 32);
+    TEST_ASSERT_EQUAL(32, bank.windowSize());
+    TEST_ASSERT_EQUAL(SlidingDftBank::MAX_BANDS, bank.bandCount());
+
+    const float freqs[] = {2.5f, 4.0f, 5.5f};
+    for (float freq : freqs) {
+        SlidingDftBank::State state;
+        bank.reset(state);
+        int window[32] = {};
+        for (int n = 0; n < 200; ++n) {
+            int value = 300 + (int)(60 * sin(2 * 3.14159f * freq * n / 50.0f));
+            bank.update(state, value, window[n % 32]);
+            window[n % 32] = value;
+        }
+        SlidingDftBank::Result result = bank.analyze(state, 50);
+        TEST_ASSERT_TRUE(result.detected);
+        TEST_ASSERT_FLOAT_WITHIN(0.4f, freq, result.frequencyHz);
+        TEST_ASSERT_TRUE(result.amplitude > 100 && result.amplitude < 140);
+    }
+
+    // 1 Гц (медленное движение пальца) - ниже полосы
+    SlidingDftBank::State state;
+    bank.reset(state);
+    int window[32] = {};
+    for (int n = 0; n < 200; ++n) {
+        int value = 300 + (int)(60 * sin(2 * 3.14159f * 1.0f * n / 50.0f));
+        bank.update(state, value, window[n % 32]);
+        window[n % 32] = value;
+        TEST_ASSERT_FALSE(bank.analyze(state, 50).detected);
+    }
+}
+
+/**
+ * @brief vibrato_detector = goertzel: ступенька не дает вибрато, начало вибрато - быстрее секундного окна.
+ */
+void test_goertzel_vibrato_onset() {
+    mockStorage.writeFile("/settings.cfg",
+        "[sensors]\n"
+        "sample_rate_hz = 50\n"
+        "hole_closed_threshold = 400\n"
+        "half_hole_threshold = 300\n"
+        "[app_logic]\n"
+        "mute_sensor_id = 8\n"
+        "hole_sensor_ids = 0, 1, 2, 3, 4, 5, 6, 7\n"
+        "[gestures]\n"
+        "vibrato_freq_min_hz = 2.0\n"
+        "vibrato_freq_max_hz = 6.0\n"
+        "vibrato_amplitude_min = 50\n"
+        "vibrato_detector = goertzel\n"
+        "vibrato_window_ms = 640\n");
+    configManager.init(&mockStorage);
+    appLogic.init(&configManager, &dispatcher);
+
+    VibratoCounter vibrato;
+    dispatcher.subscribe(EventType::VIBRATO_DETECTED, &vibrato);
+
+    // Отверстие открыто, затем палец закрывает его (ступенька 150 -> 450) и держит
+    for (int i = 0; i < 100; ++i) {
+        int value = i < 50 ? 150 : 450;
+        appLogic.handleEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{0, value}));
+    }
+    TEST_ASSERT_EQUAL_INT(0, vibrato.count);
+
+    // Вибрато 4 Гц, размах 80 (отверстие остается закрытым)
+    int onset = -1;
+    for (int i = 0; i < 50; ++i) {
+        int value = 450 + (int)(40 * sin(2 * 3.14159f * 4.0f * i / 50.0f));
+        appLogic.handleEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{0, value}));
+        if (onset < 0 && vibrato.count > 0) onset = i;
+    }
+    TEST_ASSERT_TRUE_MESSAGE(onset >= 0, "Vibrato should be detected");
+    TEST_ASSERT_TRUE(onset < 38); // < 0.75 с при окне 1 с у zero-crossing
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 80.0f / 500.0f, vibrato.lastDepth);
+}
+
+/**
+ * @brief Триггер Шмитта и выдержка: дребезг у порога не дает событий, подавленные переходы считаются.
+ */
+void test_hysteresis_and_dwell() {
+    mockStorage.writeFile("/settings.cfg",
+        "[sensors]\n"
+        "sample_rate_hz = 50\n"
+        "mute_threshold = 500\n"
+        "hole_closed_threshold = 400\n"
+        "threshold_hysteresis = 30\n"
+        "state_dwell_samples = 3\n"
+        "[app_logic]\n"
+        "mute_sensor_id = 8\n"
+        "hole_sensor_ids = 0, 1, 2, 3, 4, 5, 6, 7\n"
+        "[gestures]\n"
+        "half_hole_threshold = 300\n"
+        "vibrato_amplitude_min = 10000\n"); // Вибрато не мешает считать события
+    configManager.init(&mockStorage);
+    appLogic.init(&configManager, &dispatcher);
+
+    auto feed = [](int id, int value) {
+        appLogic.handleEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{id, value}));
+    };
+
+    // Закрытие принимается только на третьем значении подряд
+    feed(0, 410);
+    feed(0, 410);
+    TEST_ASSERT_EQUAL_INT(0, spy.getReceivedCount());
+    feed(0, 410);
+    TEST_ASSERT_EQUAL_INT(1, spy.getReceivedCount());
+    TEST_ASSERT_EQUAL(EventType::SENSOR_MASK_CHANGED, spy.getLastEventType());
+
+    // Дребезг у порога (выше 400 - 30) и короткий провал - без событий
+    const int chatter[] = {395, 405, 390, 402, 200, 200, 410};
+    for (int value : chatter) feed(0, value);
+    TEST_ASSERT_EQUAL_INT(1, spy.getReceivedCount());
+
+    // Палец действительно убран
+    for (int i = 0; i < 3; ++i) feed(0, 200);
+    TEST_ASSERT_EQUAL_INT(2, spy.getReceivedCount());
+    TEST_ASSERT_EQUAL_INT(0, spy.getLastIntPayload());
+
+    // Mute: тот же триггер Шмитта (выключается только ниже 470)
+    for (int i = 0; i < 3; ++i) feed(8, 600);
+    TEST_ASSERT_EQUAL(EventType::MUTE_ENABLED, spy.getLastEventType());
+    feed(8, 480);
+    feed(8, 480);
+    feed(8, 480);
+    TEST_ASSERT_EQUAL_INT(3, spy.getReceivedCount());
+
+    // Голые пороги: 8 переходов отверстия и 2 Mute, состоялось 3
+    TEST_ASSERT_EQUAL_UINT32(3, appLogic.getTransitionCount());
+    TEST_ASSERT_EQUAL_UINT32(7, appLogic.getSuppressedTransitionCount());
+}
+
+/**
+ * @brief Выдержка маски: промежуточные маски смены аккорда не публикуются,
+ * известная аппликатура в один бит - без задержки.
+ */
+void test_mask_settle_window() {
+    mockStorage.writeFile("/settings.cfg",
+        "[sensors]\n"
+        "hole_closed_threshold = 400\n"
+        "threshold_hysteresis = 0\n" // ConfigManager::init не сбрасывает ключи прошлых тестов
+        "state_dwell_samples = 1\n"
+        "[app_logic]\n"
+        "mute_sensor_id = 8\n"
+        "hole_sensor_ids = 0, 1, 2, 3, 4, 5, 6, 7\n"
+        "mask_settle_ms = 40\n"
+        "[gestures]\n"
+        "half_hole_threshold = 300\n"
+        "vibrato_amplitude_min = 10000\n");
+    configManager.init(&mockStorage);
+    appLogic.init(&configManager, &dispatcher);
+    appLogic.setKnownFingerings(nullptr);
+    dispatcher.setVirtualClock(true);
+
+    auto feed = [](int id, int value) {
+        appLogic.handleEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{id, value}));
+    };
+
+    // Два пальца закрываются с разницей в 20 мс: маска 0b01 не публикуется
+    feed(0, 450);
+    dispatcher.advanceVirtualTime(20);
+    feed(1, 450);
+    TEST_ASSERT_EQUAL_INT(0, spy.getReceivedCount());
+    dispatcher.advanceVirtualTime(20);
+    feed(0, 450);
+    TEST_ASSERT_EQUAL_INT(0, spy.getReceivedCount());
+    dispatcher.advanceVirtualTime(20);
+    feed(0, 450); // 0b11 простояла 40 мс
+    TEST_ASSERT_EQUAL_INT(1, spy.getReceivedCount());
+    TEST_ASSERT_EQUAL_INT(3, spy.getLastIntPayload());
+
+    const MaskSettleStats& stats = appLogic.getMaskSettleStats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.suppressedMasks);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.heldMasks);
+    TEST_ASSERT_EQUAL_UINT32(40, stats.totalDelayMs);
+    TEST_ASSERT_EQUAL_UINT32(40, stats.maxDelayMs);
+
+    // Известная аппликатура, до которой один бит - сразу
+    mockStorage.writeFile("/fingering.cfg", "0b00000111 64\n0b00000011 62\n");
+    AppFingering fingering;
+    fingering.init(&mockStorage);
+    appLogic.setKnownFingerings(&fingering);
+
+    spy.reset();
+    feed(2, 450);
+    TEST_ASSERT_EQUAL_INT(1, spy.getReceivedCount());
+    TEST_ASSERT_EQUAL_INT(7, spy.getLastIntPayload());
+    TEST_ASSERT_EQUAL_UINT32(1, stats.immediateMasks);
+
+    // Неизвестная маска в один бит выдерживается, а отпущенный палец отменяет ее без события
+    feed(3, 450);
+    feed(3, 100);
+    dispatcher.advanceVirtualTime(100);
+    feed(0, 450);
+    TEST_ASSERT_EQUAL_INT(1, spy.getReceivedCount());
+    TEST_ASSERT_EQUAL_UINT32(2, stats.suppressedMasks);
+}
+
+/**
+ * @brief Предсказание закрытия: нарастающий фронт объявляет CLOSED до порога,
+ * остановка ниже порога исправляет маску.
+ */
+void test_predicted_onset() {
+    mockStorage.writeFile("/settings.cfg",
+        "[sensors]\n"
+        "sample_rate_hz = 50\n"
+        "hole_closed_threshold = 400\n"
+        "threshold_hysteresis = 0\n"
+        "state_dwell_samples = 1\n"
+        "[app_logic]\n"
+        "mute_sensor_id = 8\n"
+        "hole_sensor_ids = 0, 1, 2, 3, 4, 5, 6, 7\n"
+        "mask_settle_ms = 0\n"
+        "predict_onset_ms = 60\n"
+        "[gestures]\n"
+        "half_hole_threshold = 300\n"
+        "vibrato_amplitude_min = 10000\n");
+    configManager.init(&mockStorage);
+    appLogic.init(&configManager, &dispatcher);
+    appLogic.setKnownFingerings(nullptr);
+
+    auto feed = [](int id, int value) {
+        appLogic.handleEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{id, value}));
+    };
+
+    const OnsetPredictionStats& stats = appLogic.getOnsetPredictionStats();
+    TEST_ASSERT_EQUAL_UINT32(60, stats.horizonMs);
+
+    // Фронт EMA (alpha 0.3) к 600: порог 400 пересекается на третьем значении
+    feed(0, 100);
+    feed(0, 100);
+    feed(0, 250); // Наклон и ускорение дают > 400 в пределах трех значений
+    TEST_ASSERT_EQUAL_INT(1, spy.getReceivedCount());
+    TEST_ASSERT_EQUAL_INT(1, spy.getLastIntPayload());
+    feed(0, 355);
+    feed(0, 428); // Подтверждение - без повторного события
+    TEST_ASSERT_EQUAL_INT(1, spy.getReceivedCount());
+    TEST_ASSERT_EQUAL_UINT32(1, stats.confirmed);
+    TEST_ASSERT_EQUAL_UINT32(40, stats.totalLeadMs);
+
+    // Палец завис ниже порога: горизонт истекает, маска исправляется
+    spy.reset();
+    feed(1, 100);
+    feed(1, 100);
+    feed(1, 250);
+    TEST_ASSERT_EQUAL_INT(1, spy.getReceivedCount());
+    TEST_ASSERT_EQUAL_INT(3, spy.getLastIntPayload());
+    feed(1, 270);
+    feed(1, 280);
+    feed(1, 280);
+    TEST_ASSERT_EQUAL_INT(2, spy.getReceivedCount());
+    TEST_ASSERT_EQUAL_INT(1, spy.getLastIntPayload());
+    feed(1, 280); // Без наклона - нового предсказания нет
+    TEST_ASSERT_EQUAL_INT(2, spy.getReceivedCount());
+
+    TEST_ASSERT_EQUAL_UINT32(2, stats.predictions);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.corrected);
+    TEST_ASSERT_TRUE(stats.falsePositiveRate() > 0.49f && stats.falsePositiveRate() < 0.51f);
+}
+
+/**
+ * @brief Ядро кадра: векторный вариант совпадает со скалярным при любом числе полос,
+ * полосы за пределами lanes в результат не попадают. Массивы выровнены по 16 байт (как
+ * полосы AppLogic) - на ESP32-S3 проверяется PIE-вариант; сдвинутые на одну полосу копии
+ * проверяют невыровненный путь.
+ */
+void test_frame_kernel_matches_scalar() {
+    alignas(16) int32_t values[SensorFrameKernel::MAX_LANES + 4];
+    alignas(16) int32_t closed[SensorFrameKernel::MAX_LANES + 4];
+    alignas(16) int32_t half[SensorFrameKernel::MAX_LANES + 4];
+    uint32_t seed = 12345;
+    auto next = [&seed]() {
+        seed = seed * 1103515245u + 12345u;
+        return (int32_t)((seed >> 8) % 1200) - 100;
+    };
+
+    for (int round = 0; round < 200; ++round) {
+        for (size_t i = 0; i < SensorFrameKernel::MAX_LANES + 4; ++i) {
+            values[i] = next();
+            closed[i] = next();
+            half[i] = next();
+        }
+        const size_t lanes = (size_t)round % (SensorFrameKernel::MAX_LANES + 1);
+        const SensorFrameKernel::Bits expected = SensorFrameKernel::classifyScalar(values, closed, half, lanes);
+        const SensorFrameKernel::Bits actual = SensorFrameKernel::classify(values, closed, half, lanes);
+        TEST_ASSERT_EQUAL_HEX32(expected.closed, actual.closed);
+        TEST_ASSERT_EQUAL_HEX32(expected.held, actual.held);
+        TEST_ASSERT_EQUAL_HEX32(0, actual.held >> lanes);
+        TEST_ASSERT_EQUAL_HEX32(actual.closed, actual.closed & actual.held);
+
+        const SensorFrameKernel::Bits shifted = SensorFrameKernel::classify(values + 1, closed + 1, half + 1, lanes);
+        const SensorFrameKernel::Bits shiftedExpected =
+            SensorFrameKernel::classifyScalar(values + 1, closed + 1, half + 1, lanes);
+        TEST_ASSERT_EQUAL_HEX32(shiftedExpected.closed, shifted.closed);
+        TEST_ASSERT_EQUAL_HEX32(shiftedExpected.held, shifted.held);
+    }
+    printf("[Kernel] %s\n", SensorFrameKernel::implementation());
+}
+
+/**
+ * @brief Маска шире 8 бит: 12 игровых сенсоров, бит = позиция в hole_sensor_ids.
+ */
+void test_twelve_hole_mask() {
+    mockStorage.writeFile("/settings.cfg",
+        "[sensors]\n"
+        "mute_threshold = 500\n"
+        "hole_closed_threshold = 400\n"
+        "threshold_hysteresis = 0\n"
+        "state_dwell_samples = 1\n"
+        "[app_logic]\n"
+        "mute_sensor_id = 8\n"
+        "hole_sensor_ids = 0, 1, 2, 3, 4, 5, 6, 7, 9, 10, 11, 12\n"
+        "mask_settle_ms = 0\n"
+        "predict_onset_ms = 0\n"
+        "[gestures]\n"
+        "half_hole_threshold = 300\n"
+        "vibrato_amplitude_min = 10000\n");
+    configManager.init(&mockStorage);
+    appLogic.init(&configManager, &dispatcher);
+
+    // Одиночное значение: ID 12 - позиция 11
+    appLogic.handleEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{12, 450}));
+    TEST_ASSERT_EQUAL_INT(1, spy.getReceivedCount());
+    TEST_ASSERT_EQUAL_INT(0x800, spy.getLastIntPayload());
+
+    // Кадр: ID 0 и 9 (позиция 8) закрыты, ID 12 открыт; Mute (ID 8) в маску не попадает
+    SensorFramePayload frame = {};
+    frame.count = 13;
+    frame.values[0] = 450;
+    frame.values[8] = 450;
+    frame.values[9] = 450;
+    appLogic.handleEvent(Event(EventType::SENSOR_FRAME, frame));
+    TEST_ASSERT_EQUAL_INT(0x101, spy.getLastIntPayload());
+}
+
+/**
+ * @brief Адаптивные пороги: база из калибровки, пороги относительно нее, медленный дрейф базы;
+ * сенсор, закрытый при старте, остается на глобальных порогах.
+ */
+void test_adaptive_baseline() {
+    mockStorage.writeFile("/settings.cfg",
+        "[sensors]\n"
+        "sample_rate_hz = 50\n"
+        "mute_threshold = 500\n"
+        "hole_closed_threshold = 400\n"
+        "threshold_hysteresis = 0\n"
+        "state_dwell_samples = 1\n"
+        "adaptive_thresholds = true\n"
+        "hole_closed_ratio = 0.6\n"
+        "half_hole_ratio = 0.3\n"
+        "baseline_calibration_ms = 200\n" // 10 значений
+        "baseline_tau_ms = 1000\n"
+        "[app_logic]\n"
+        "mute_sensor_id = 8\n"
+        "hole_sensor_ids = 0, 1, 2, 3, 4, 5, 6, 7\n"
+        "mask_settle_ms = 0\n"
+        "predict_onset_ms = 0\n"
+        "[gestures]\n"
+        "half_hole_threshold = 300\n"
+        "vibrato_amplitude_min = 10000\n");
+    configManager.init(&mockStorage);
+    appLogic.init(&configManager, &dispatcher);
+
+    auto feed = [](int id, int value) {
+        appLogic.handleEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{id, value}));
+    };
+
+    // До калибровки - глобальные пороги (размах 333 и база 200 дают 400/300)
+    SensorCalibration cal;
+    TEST_ASSERT_TRUE(appLogic.getSensorCalibration(0, cal));
+    TEST_ASSERT_FALSE(cal.calibrated);
+    TEST_ASSERT_EQUAL_INT(400, cal.closedThreshold);
+    TEST_ASSERT_EQUAL_INT(300, cal.halfThreshold);
+    TEST_ASSERT_FALSE(appLogic.getSensorCalibration(8, cal)); // Mute
+
+    for (int i = 0; i < 10; ++i) {
+        feed(0, 100);
+        feed(1, 350); // Палец на отверстии при старте
+    }
+    appLogic.getSensorCalibration(0, cal);
+    TEST_ASSERT_TRUE(cal.calibrated);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 100.0f, cal.baseline);
+    TEST_ASSERT_EQUAL_INT(300, cal.closedThreshold);
+    TEST_ASSERT_EQUAL_INT(200, cal.halfThreshold);
+
+    appLogic.getSensorCalibration(1, cal);
+    TEST_ASSERT_TRUE(cal.calibrated);
+    TEST_ASSERT_EQUAL_INT(400, cal.closedThreshold);
+
+    // 320: по глобальным порогам - полузакрытие, относительно базы 100 - закрыто
+    spy.reset();
+    feed(0, 320);
+    TEST_ASSERT_EQUAL_INT(0x03, spy.getLastIntPayload()); // ID 1 (350) - HALF_HOLE в маске
+    feed(0, 100);
+    TEST_ASSERT_EQUAL_INT(0x02, spy.getLastIntPayload());
+
+    // Дрейф базы вверх, пока отверстие открыто (постоянная 50 значений)
+    for (int i = 0; i < 250; ++i) feed(0, 150);
+    appLogic.getSensorCalibration(0, cal);
+    TEST_ASSERT_TRUE(cal.baseline > 149.0f && cal.baseline <= 150.0f);
+    TEST_ASSERT_EQUAL_INT(350, cal.closedThreshold);
+
+    // Подход пальца ниже порога полузакрытия базу не тянет
+    for (int i = 0; i < 50; ++i) feed(0, 240);
+    appLogic.getSensorCalibration(0, cal);
+    TEST_ASSERT_TRUE(cal.baseline <= 150.0f);
+
+    spy.reset();
+    feed(0, 320); // Теперь только полузакрытие: маска, затем HALF_HOLE_DETECTED
+    TEST_ASSERT_EQUAL_INT(2, spy.getReceivedCount());
+    TEST_ASSERT_EQUAL(EventType::HALF_HOLE_DETECTED, spy.getLastEventType());
+}
+
 int main(int argc, char **argv) {
     UNITY_BEGIN();
     RUN_TEST(test_mute_logic);
     RUN_TEST(test_mask_logic);
     RUN_TEST(test_half_hole_event_order); // <-- Обновленный тест
     RUN_TEST(test_vibrato_logic);
+    RUN_TEST(test_sensor_frame_single_mask_update);
+    RUN_TEST(test_sensor_subscription_filter);
+    RUN_TEST(test_history_ring_wraps_in_order);
+    RUN_TEST(test_vibrato_window_matches_full_scan);
+    RUN_TEST(test_vibrato_window_bounded_rescans);
+    RUN_TEST(test_vibrato_decisions_match_full_scan_on_recording);
+    RUN_TEST(test_sliding_dft_bank_frequency);
+    RUN_TEST(test_goertzel_vibrato_onset);
+    RUN_TEST(test_hysteresis_and_dwell);
+    RUN_TEST(test_mask_settle_window);
+    RUN_TEST(test_predicted_onset);
+    RUN_TEST(test_frame_kernel_matches_scalar);
+    RUN_TEST(test_twelve_hole_mask);
+    RUN_TEST(test_adaptive_baseline);
     return UNITY_END();
 }
\ No newline at end of file
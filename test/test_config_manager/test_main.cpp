@@ -74,6 +74,21 @@ void test_config_defaults_when_file_missing() {
     TEST_ASSERT_EQUAL_FLOAT(440.0f, config.getBasePitchHz());
     TEST_ASSERT_EQUAL_FLOAT(0.1f, config.getFilterAlpha());
     TEST_ASSERT_EQUAL(500, config.getMuteThreshold());
+    TEST_ASSERT_FALSE(config.getSensorFrameMode());
+    TEST_ASSERT_EQUAL(0, config.getThresholdHysteresis());
+    TEST_ASSERT_EQUAL(1, config.getStateDwellSamples());
+    TEST_ASSERT_FALSE(config.getFusedPipeline());
+    TEST_ASSERT_EQUAL(0, config.getMaskSettleMs());
+    TEST_ASSERT_TRUE(config.getVibratoDetector() == VibratoDetector::ZERO_CROSSING);
+    TEST_ASSERT_EQUAL(640, config.getVibratoWindowMs());
+    TEST_ASSERT_EQUAL(16, config.getRealtimeQueueConfig().capacity);
+    TEST_ASSERT_EQUAL(32, config.getBulkQueueConfig().capacity);
+    TEST_ASSERT_EQUAL(20, config.getAppLogicQueueConfig().capacity);
+    TEST_ASSERT_TRUE(config.getAppLogicQueueConfig().policy == OverflowPolicy::DROP_NEWEST);
+    TEST_ASSERT_EQUAL(10, config.getQueueBlockTimeoutMs());
+    TEST_ASSERT_FALSE(config.getDualCoreDispatch());
+    TEST_ASSERT_EQUAL(1, config.getRealtimeCore());
+    TEST_ASSERT_EQUAL(0, config.getBulkCore());
 }
 
 /**
@@ -91,7 +106,21 @@ void test_config_parse_valid_basic() {
         "led_pin = GPIO_TEST\n"       
         "[sensors]\n"
         "hole_closed_threshold = 800\n"
-        "blink_duration_ms = 100\n"; 
+        "sensor_frame_mode = true\n"
+        "threshold_hysteresis = 25\n"
+        "state_dwell_samples = 2\n"
+        "blink_duration_ms = 100\n"
+        "[gestures]\n"
+        "vibrato_detector = goertzel\n"
+        "vibrato_window_ms = 400\n"
+        "[queues]\n"
+        "bulk_queue_capacity = 48\n"
+        "bulk_queue_policy = coalesce\n"
+        "app_logic_queue_policy = drop_oldest\n"
+        "realtime_queue_policy = bogus\n"
+        "[dispatch]\n"
+        "dual_core_dispatch = true\n"
+        "bulk_core = -1\n"; 
 
     // Это создаст файл "data/settings.cfg" (но настоящий уже в бэкапе)
     mockStorage.writeFile("/settings.cfg", cfg);
@@ -106,6 +135,19 @@ void test_config_parse_valid_basic() {
     TEST_ASSERT_EQUAL_STRING("GPIO_TEST", config.getLedPin().c_str());
     TEST_ASSERT_EQUAL(800, config.getHoleClosedThreshold());
     TEST_ASSERT_EQUAL(100, config.getLedBlinkDurationMs()); 
+    TEST_ASSERT_TRUE(config.getSensorFrameMode());
+    TEST_ASSERT_EQUAL(25, config.getThresholdHysteresis());
+    TEST_ASSERT_EQUAL(2, config.getStateDwellSamples());
+    TEST_ASSERT_TRUE(config.getVibratoDetector() == VibratoDetector::GOERTZEL);
+    TEST_ASSERT_EQUAL(400, config.getVibratoWindowMs());
+    TEST_ASSERT_EQUAL(48, config.getBulkQueueConfig().capacity);
+    TEST_ASSERT_TRUE(config.getBulkQueueConfig().policy == OverflowPolicy::COALESCE);
+    TEST_ASSERT_TRUE(config.getAppLogicQueueConfig().policy == OverflowPolicy::DROP_OLDEST);
+    // Неизвестная политика игнорируется
+    TEST_ASSERT_TRUE(config.getRealtimeQueueConfig().policy == OverflowPolicy::BLOCK_TIMEOUT);
+    TEST_ASSERT_TRUE(config.getDualCoreDispatch());
+    TEST_ASSERT_EQUAL(1, config.getRealtimeCore());
+    TEST_ASSERT_EQUAL(-1, config.getBulkCore());
 }
 
 /**
@@ -118,8 +160,13 @@ void test_config_parse_vectors() {
     std::string cfg = 
         "[sensors]\n"
         "physical_pins = P_ONE, P_TWO, P_THREE\n"
+        "adaptive_thresholds = on\n"
+        "hole_closed_ratio = 0.55\n"
+        "baseline_tau_ms = 8000\n"
         "[app_logic]\n"
-        "hole_sensor_ids = 10, 20, 30, 40";     
+        "hole_sensor_ids = 10, 20, 30, 40\n"
+        "mask_settle_ms = 30\n"
+        "predict_onset_ms = 20";     
 
     mockStorage.writeFile("/settings.cfg", cfg);
     config.init(&mockStorage);
@@ -139,6 +186,11 @@ void test_config_parse_vectors() {
         TEST_ASSERT_EQUAL(10, ids[0]);
         TEST_ASSERT_EQUAL(40, ids[3]);
     }
+    TEST_ASSERT_EQUAL(30, config.getMaskSettleMs());
+    TEST_ASSERT_EQUAL(20, config.getPredictOnsetMs());
+    TEST_ASSERT_TRUE(config.getAdaptiveThresholds());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.55f, config.getHoleClosedRatio());
+    TEST_ASSERT_EQUAL(8000, config.getBaselineTauMs());
 }
 
 /**
@@ -9,11 +9,167 @@
 #include <unity.h>
 #include "core/EventDispatcher.h"
 #include "MockEventHandler.h" // Наш новый универсальный мок
+#include "core/TypedEventBus.h"
+#include "MockHalStorage.h"
+#include "core/IdleMonitor.h"
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// --- Вспомогательные обработчики ---
+
+/**
+ * @brief Запоминает порядок доставки типов событий.
+ */
+class OrderRecorder : public IEventHandler {
+public:
+    std::vector<Event> received;
+    virtual void handleEvent(const Event& event) override {
+        received.push_back(event);
+    }
+};
+
+/**
+ * @brief На SYSTEM_IDLE_TIMEOUT публикует пачку сырых значений сенсоров, а затем ноту.
+ * Эмулирует ситуацию, когда нота встает в очередь за потоком сенсоров.
+ */
+class BurstPublisher : public IEventHandler {
+public:
+    EventDispatcher* dispatcher = nullptr;
+    virtual void handleEvent(const Event& event) override {
+        for (int i = 0; i < 5; ++i) {
+            dispatcher->postEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{i, 100}));
+        }
+        dispatcher->postEvent(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{60}));
+    }
+};
+
+/**
+ * @brief На SYSTEM_IDLE_TIMEOUT публикует несколько значений для одних и тех же сенсоров
+ * (эмуляция отставшего цикла: новые значения приходят раньше, чем доставлены старые).
+ */
+class StaleSensorPublisher : public IEventHandler {
+public:
+    EventDispatcher* dispatcher = nullptr;
+    virtual void handleEvent(const Event& event) override {
+        dispatcher->postEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{3, 100}));
+        dispatcher->postEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{2, 10}));
+        dispatcher->postEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{2, 20}));
+        dispatcher->postEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{2, 30}));
+    }
+};
+
+/**
+ * @brief "Медленный" обработчик: каждое событие обрабатывается ~2 мс.
+ */
+class SlowHandler : public IEventHandler {
+public:
+    std::atomic<int> count{0};
+    virtual void handleEvent(const Event& event) override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        count++;
+    }
+};
+
+/**
+ * @brief Запоминает время (по часам диспетчера) доставки каждого события.
+ */
+class TimeRecorder : public IEventHandler {
+public:
+    EventDispatcher* dispatcher = nullptr;
+    std::vector<uint32_t> times;
+    std::vector<int> pitches;
+    virtual void handleEvent(const Event& event) override {
+        times.push_back(dispatcher->nowMs());
+        if (event.type == EventType::NOTE_PITCH_SELECTED) {
+            pitches.push_back(event.payload.notePitch.pitch);
+        }
+    }
+};
+
+/**
+ * @brief Запоминает поток доставки; SYSTEM_IDLE_TIMEOUT (BULK) ждет, пока не будет
+ * доставлено событие REALTIME (в одном цикле это невозможно - только до таймаута).
+ */
+class LoopProbe : public IEventHandler {
+public:
+    std::atomic<bool> realtimeSeen{false};
+    std::atomic<bool> bulkWaitedForRealtime{false};
+    std::thread::id realtimeThread;
+    std::thread::id bulkThread;
+    virtual void handleEvent(const Event& event) override {
+        if (event.type == EventType::NOTE_PITCH_SELECTED) {
+            realtimeThread = std::this_thread::get_id();
+            realtimeSeen.store(true);
+        } else {
+            bulkThread = std::this_thread::get_id();
+            for (int i = 0; i < 2000 && !realtimeSeen.load(); ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            bulkWaitedForRealtime.store(realtimeSeen.load());
+        }
+    }
+};
+
+/**
+ * @brief Потокобезопасный счетчик доставок (вызывается из двух циклов).
+ */
+class AtomicCounter : public IEventHandler {
+public:
+    std::atomic<int> count{0};
+    virtual void handleEvent(const Event& event) override {
+        count++;
+    }
+};
+
+/**
+ * @brief Отписывается от своего типа прямо из обработчика (выгрузка модуля на лету).
+ */
+class SelfUnsubscriber : public IEventHandler {
+public:
+    EventDispatcher* dispatcher = nullptr;
+    int count = 0;
+    bool unsubscribed = false;
+    virtual void handleEvent(const Event& event) override {
+        count++;
+        unsubscribed = dispatcher->unsubscribe(event.type, this);
+    }
+};
+
+/**
+ * @brief Обработчики типизированной шины: получают конкретные структуры данных.
+ */
+struct TypedMaskHandler {
+    int lastMask = -1;
+    int calls = 0;
+    void onEvent(EventTag<EventType::SENSOR_MASK_CHANGED>, const SensorMaskPayload& p) { lastMask = p.mask; calls++; }
+};
+
+struct TypedNoteHandler {
+    std::vector<int> order; // Нота или -1 для MUTE_ENABLED
+    void onEvent(EventTag<EventType::NOTE_PITCH_SELECTED>, const NotePitchPayload& p) { order.push_back(p.pitch); }
+    void onEvent(EventTag<EventType::MUTE_ENABLED>, const EmptyPayload&) { order.push_back(-1); }
+};
+
+using TestBus = TypedEventBus<
+    TypedRoute<EventType::SENSOR_MASK_CHANGED, TypedMaskHandler>,
+    TypedRoute<EventType::NOTE_PITCH_SELECTED, TypedNoteHandler>,
+    TypedRoute<EventType::MUTE_ENABLED, TypedNoteHandler>
+>;
+
+// Таблица маршрутов и типы данных проверяются при компиляции
+static_assert(TestBus::routeCount<EventType::NOTE_PITCH_SELECTED>() == 1, "One note route");
+static_assert(TestBus::routeCount<EventType::VIBRATO_DETECTED>() == 0, "No vibrato route");
+static_assert(!std::is_convertible<SensorMaskPayload, EventPayload<EventType::VIBRATO_DETECTED>>::value,
+              "Vibrato event must not accept a mask payload");
 
 // --- Глобальные объекты ---
 EventDispatcher dispatcher;
 MockEventHandler handler1;
 MockEventHandler handler2;
+MockEventHandler threadedHandler;
 
 // --- Setup / Teardown (Без extern "C") ---
 void setUp(void) {
@@ -84,6 +240,801 @@ void test_multiple_subscribers() {
     TEST_ASSERT_EQUAL_INT(123, handler2.getLastIntPayload());
 }
 
+/**
+ * @brief Тест 4: Кольцевой буфер сохраняет порядок FIFO и не принимает событие сверх емкости.
+ */
+void test_ring_fifo_and_overflow() {
+    EventRing<Event, 4> ring;
+    Event out(EventType::BLE_CONNECTED);
+
+    for (int i = 0; i < 4; ++i) {
+        TEST_ASSERT_TRUE(ring.tryPush(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{60 + i})));
+    }
+    // Пятое событие не помещается
+    TEST_ASSERT_FALSE_MESSAGE(ring.tryPush(Event(EventType::MUTE_ENABLED)), "Ring should be full");
+    TEST_ASSERT_EQUAL_INT(4, ring.size());
+
+    for (int i = 0; i < 4; ++i) {
+        TEST_ASSERT_TRUE(ring.tryPop(out));
+        TEST_ASSERT_EQUAL_INT(60 + i, out.payload.notePitch.pitch);
+    }
+    TEST_ASSERT_FALSE(ring.tryPop(out));
+
+    // После освобождения буфер снова принимает события (следующий "круг" индексов)
+    TEST_ASSERT_TRUE(ring.tryPush(Event(EventType::MUTE_ENABLED)));
+    TEST_ASSERT_TRUE(ring.tryPop(out));
+    TEST_ASSERT_EQUAL(EventType::MUTE_ENABLED, out.type);
+}
+
+/**
+ * @brief Тест 5: Native threaded-режим. Несколько производителей, один поток-потребитель.
+ * waitIdle() должен вернуть управление только после доставки всех событий.
+ */
+void test_threaded_multi_producer() {
+    const int producers = 4;
+    const int eventsPerProducer = 500;
+
+    // Подписываемся ДО запуска потока (подписки заморожены во время работы цикла)
+    dispatcher.subscribe(EventType::HALF_HOLE_DETECTED, &threadedHandler);
+    // Тест проверяет доставку без потерь, а не таймаут: на одном ядре цикл может
+    // не получать процессор дольше штатных 10 мс, пока работают производители
+    dispatcher.setBlockTimeoutMs(1000);
+    TEST_ASSERT_TRUE(dispatcher.startLoopThread());
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([p, eventsPerProducer]() {
+            for (int i = 0; i < eventsPerProducer; ++i) {
+                dispatcher.postEvent(Event(EventType::HALF_HOLE_DETECTED, HalfHolePayload{p}));
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    dispatcher.waitIdle();
+
+    TEST_ASSERT_EQUAL_INT(producers * eventsPerProducer, threadedHandler.getReceivedCount());
+    TEST_ASSERT_EQUAL_INT(0, dispatcher.pendingCount());
+
+    // Возвращаемся в синхронный режим
+    dispatcher.stopLoopThread();
+    dispatcher.setBlockTimeoutMs(EventQueue<8>::DEFAULT_BLOCK_TIMEOUT_MS);
+}
+
+/**
+ * @brief Тест 6: Таблица подписчиков фиксированного размера и заморозка полос после фазы подписок.
+ */
+void test_subscriptions_frozen_and_bounded() {
+    dispatcher.reset();
+
+    // 1. Список одного типа ограничен MAX_HANDLERS_PER_TYPE
+    for (size_t i = 0; i < EventDispatcher::MAX_HANDLERS_PER_TYPE; ++i) {
+        TEST_ASSERT_TRUE(dispatcher.subscribe(EventType::VIBRATO_DETECTED, &handler1));
+    }
+    TEST_ASSERT_FALSE_MESSAGE(dispatcher.subscribe(EventType::VIBRATO_DETECTED, &handler2), "List should be full");
+
+    // 2. После заморозки смена полос отклоняется, подписки по-прежнему меняются
+    dispatcher.subscribe(EventType::MUTE_DISABLED, &handler1);
+    dispatcher.freezeSubscriptions();
+    TEST_ASSERT_FALSE(dispatcher.setEventLane(EventType::MUTE_DISABLED, EventLane::BULK));
+    TEST_ASSERT_TRUE(dispatcher.subscribe(EventType::MUTE_DISABLED, &handler2));
+
+    dispatcher.postEvent(Event(EventType::MUTE_DISABLED));
+    TEST_ASSERT_EQUAL_INT(1, handler1.getReceivedCount());
+    TEST_ASSERT_EQUAL_INT(1, handler2.getReceivedCount());
+
+    // 3. reset() снимает заморозку
+    dispatcher.reset();
+    TEST_ASSERT_TRUE(dispatcher.setEventLane(EventType::MUTE_DISABLED, EventLane::REALTIME));
+}
+
+/**
+ * @brief Тест 7: Нота (REALTIME) обгоняет ожидающие значения сенсоров (BULK).
+ */
+void test_realtime_lane_preempts_bulk() {
+    OrderRecorder recorder;
+    BurstPublisher publisher;
+    publisher.dispatcher = &dispatcher;
+
+    dispatcher.reset();
+    dispatcher.resetStats();
+    dispatcher.subscribe(EventType::SYSTEM_IDLE_TIMEOUT, &publisher);
+    dispatcher.subscribe(EventType::SENSOR_VALUE_CHANGED, &recorder);
+    dispatcher.subscribe(EventType::NOTE_PITCH_SELECTED, &recorder);
+
+    TEST_ASSERT_EQUAL(EventLane::REALTIME, dispatcher.getEventLane(EventType::NOTE_PITCH_SELECTED));
+    TEST_ASSERT_EQUAL(EventLane::BULK, dispatcher.getEventLane(EventType::SENSOR_VALUE_CHANGED));
+
+    dispatcher.postEvent(Event(EventType::SYSTEM_IDLE_TIMEOUT));
+
+    // Нота опубликована последней, но доставлена первой
+    TEST_ASSERT_EQUAL_INT(6, recorder.received.size());
+    TEST_ASSERT_EQUAL(EventType::NOTE_PITCH_SELECTED, recorder.received[0].type);
+    TEST_ASSERT_EQUAL(EventType::SENSOR_VALUE_CHANGED, recorder.received[1].type);
+
+    TEST_ASSERT_EQUAL_INT(1, dispatcher.getPreemptionCount());
+    TEST_ASSERT_EQUAL_INT(1, dispatcher.getLaneDispatchedCount(EventLane::REALTIME));
+    TEST_ASSERT_EQUAL_INT(6, dispatcher.getLaneDispatchedCount(EventLane::BULK));
+
+    // Переназначение полосы: теперь нота идет в общей очереди FIFO
+    dispatcher.reset();
+    recorder.received.clear();
+    dispatcher.setEventLane(EventType::NOTE_PITCH_SELECTED, EventLane::BULK);
+    dispatcher.subscribe(EventType::SYSTEM_IDLE_TIMEOUT, &publisher);
+    dispatcher.subscribe(EventType::SENSOR_VALUE_CHANGED, &recorder);
+    dispatcher.subscribe(EventType::NOTE_PITCH_SELECTED, &recorder);
+
+    dispatcher.postEvent(Event(EventType::SYSTEM_IDLE_TIMEOUT));
+    TEST_ASSERT_EQUAL(EventType::NOTE_PITCH_SELECTED, recorder.received.back().type);
+
+    dispatcher.reset();
+}
+
+/**
+ * @brief Тест 8: Режим склейки - одна ячейка на сенсор, доставляется самое свежее значение.
+ */
+void test_sensor_value_coalescing() {
+    OrderRecorder recorder;
+    StaleSensorPublisher publisher;
+    publisher.dispatcher = &dispatcher;
+
+    dispatcher.reset();
+    dispatcher.resetStats();
+    dispatcher.setSensorCoalescing(true);
+    dispatcher.subscribe(EventType::SYSTEM_IDLE_TIMEOUT, &publisher);
+    dispatcher.subscribe(EventType::SENSOR_VALUE_CHANGED, &recorder);
+
+    dispatcher.postEvent(Event(EventType::SYSTEM_IDLE_TIMEOUT));
+
+    // Два сенсора -> два события; для сенсора 2 - только последнее значение
+    TEST_ASSERT_EQUAL_INT(2, recorder.received.size());
+    bool sawSensor2 = false;
+    for (const Event& ev : recorder.received) {
+        if (ev.payload.sensorValue.id == 2) {
+            sawSensor2 = true;
+            TEST_ASSERT_EQUAL_INT(30, ev.payload.sensorValue.value);
+        } else {
+            TEST_ASSERT_EQUAL_INT(3, ev.payload.sensorValue.id);
+            TEST_ASSERT_EQUAL_INT(100, ev.payload.sensorValue.value);
+        }
+    }
+    TEST_ASSERT_TRUE(sawSensor2);
+    TEST_ASSERT_EQUAL_INT(2, dispatcher.getCoalescedCount());
+    TEST_ASSERT_EQUAL_INT(0, dispatcher.pendingCount());
+
+    // После доставки ячейка снова пуста: следующее значение не склеивается
+    dispatcher.postEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{2, 40}));
+    TEST_ASSERT_EQUAL_INT(3, recorder.received.size());
+    TEST_ASSERT_EQUAL_INT(2, dispatcher.getCoalescedCount());
+
+    dispatcher.setSensorCoalescing(false);
+    dispatcher.reset();
+}
+
+/**
+ * @brief Тест 9: Гистограммы ожидания в очереди и времени обработчиков (Native Threaded Mode).
+ */
+void test_latency_histograms_threaded() {
+    SlowHandler slow;
+    OrderRecorder recorder;
+    const int events = 5;
+
+    dispatcher.reset();
+    dispatcher.resetLatencyStats();
+    dispatcher.subscribe(EventType::NOTE_PITCH_SELECTED, &slow);     // Подписчик #0
+    dispatcher.subscribe(EventType::NOTE_PITCH_SELECTED, &recorder); // Подписчик #1
+    TEST_ASSERT_TRUE(dispatcher.startLoopThread());
+
+    uint32_t before = EventDispatcher::nowUs();
+    for (int i = 0; i < events; ++i) {
+        dispatcher.postEvent(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{60 + i}));
+    }
+    dispatcher.waitIdle();
+    dispatcher.stopLoopThread();
+
+    // События проштампованы временем публикации
+    TEST_ASSERT_EQUAL_INT(events, recorder.received.size());
+    TEST_ASSERT_TRUE(recorder.received[0].postTimeUs >= before);
+
+    // Время обработчиков - по каждому подписчику отдельно
+    const LatencyHistogram& slowHist = dispatcher.getHandlerHistogram(EventType::NOTE_PITCH_SELECTED, 0);
+    TEST_ASSERT_EQUAL_INT(events, slowHist.totalCount());
+    TEST_ASSERT_TRUE(slowHist.maxUs() >= 2000);
+    TEST_ASSERT_EQUAL_INT(0, slowHist.bucketCount(LatencyHistogram::bucketFor(1000)));
+    TEST_ASSERT_EQUAL_INT(events, dispatcher.getHandlerHistogram(EventType::NOTE_PITCH_SELECTED, 1).totalCount());
+
+    // Последнее событие ждало в очереди, пока "медленный" обработчик разбирал предыдущие
+    const LatencyHistogram& waitHist = dispatcher.getQueueWaitHistogram(EventType::NOTE_PITCH_SELECTED);
+    TEST_ASSERT_EQUAL_INT(events, waitHist.totalCount());
+    TEST_ASSERT_TRUE(waitHist.maxUs() >= 4000);
+
+    dispatcher.resetLatencyStats();
+    TEST_ASSERT_EQUAL_INT(0, waitHist.totalCount());
+    dispatcher.reset();
+}
+
+/**
+ * @brief Тест 10: Типизированная шина - прямая доставка по маршрутам и зеркало в EventDispatcher.
+ */
+void test_typed_event_bus() {
+    TestBus bus;
+    TypedMaskHandler maskHandler;
+    TypedNoteHandler noteHandler;
+    OrderRecorder observer;
+
+    // Без привязанных обработчиков и зеркала publish ничего не делает
+    bus.publish<EventType::SENSOR_MASK_CHANGED>(SensorMaskPayload{1});
+    TEST_ASSERT_EQUAL_INT(0, maskHandler.calls);
+
+    bus.bind(&maskHandler);
+    bus.bind(&noteHandler);
+    bus.publish<EventType::SENSOR_MASK_CHANGED>(SensorMaskPayload{5});
+    bus.publish<EventType::NOTE_PITCH_SELECTED>(NotePitchPayload{62});
+    bus.publish<EventType::MUTE_ENABLED>();
+    // Тип без маршрутов компилируется и игнорируется
+    bus.publish<EventType::VIBRATO_DETECTED>(VibratoPayload{0, 0.5f});
+
+    TEST_ASSERT_EQUAL_INT(1, maskHandler.calls);
+    TEST_ASSERT_EQUAL_INT(5, maskHandler.lastMask);
+    TEST_ASSERT_EQUAL_INT(2, noteHandler.order.size());
+    TEST_ASSERT_EQUAL_INT(62, noteHandler.order[0]);
+    TEST_ASSERT_EQUAL_INT(-1, noteHandler.order[1]);
+
+    // Зеркало: после прямого вызова событие получают обычные подписчики
+    dispatcher.reset();
+    dispatcher.subscribe(EventType::NOTE_PITCH_SELECTED, &observer);
+    bus.setMirror(&dispatcher);
+    bus.publish<EventType::NOTE_PITCH_SELECTED>(NotePitchPayload{64});
+    TEST_ASSERT_EQUAL_INT(64, noteHandler.order.back());
+    TEST_ASSERT_EQUAL_INT(1, observer.received.size());
+    TEST_ASSERT_EQUAL_INT(64, observer.received[0].payload.notePitch.pitch);
+
+    dispatcher.reset();
+}
+
+/**
+ * @brief Тест 11: Политики переполнения, счетчики потерь, high-water mark и пропуски в нумерации.
+ */
+void test_queue_overflow_policies() {
+    EventQueue<8> queue;
+    Event out(EventType::BLE_CONNECTED);
+
+    // Емкость ограничивается хранилищем
+    queue.setCapacity(100);
+    TEST_ASSERT_EQUAL_INT(8, queue.capacity());
+
+    // DROP_NEWEST: лишние события теряются, в очереди остаются первые
+    queue.configure(QueueConfig{3, OverflowPolicy::DROP_NEWEST});
+    for (int i = 0; i < 5; ++i) {
+        queue.push(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{60 + i}), false);
+    }
+    TEST_ASSERT_EQUAL_INT(2, queue.getDroppedCount());
+    TEST_ASSERT_EQUAL_INT(3, queue.getHighWaterMark());
+    while (queue.pop(out)) {}
+    TEST_ASSERT_EQUAL_INT(62, out.payload.notePitch.pitch);
+    // Пропуск виден потребителю по следующему доставленному номеру
+    queue.push(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{70}), false);
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_EQUAL_INT(6, out.seq);
+    TEST_ASSERT_EQUAL_INT(2, queue.getGapCount());
+
+    // DROP_OLDEST: старые вытесняются, доставляются самые свежие
+    queue.reset();
+    queue.setPolicy(OverflowPolicy::DROP_OLDEST);
+    uint32_t evicted = 0;
+    for (int i = 0; i < 5; ++i) {
+        queue.push(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{60 + i}), false, &evicted);
+    }
+    TEST_ASSERT_EQUAL_INT(2, evicted);
+    TEST_ASSERT_EQUAL_INT(2, queue.getEvictedCount());
+    TEST_ASSERT_EQUAL_INT(0, queue.getDroppedCount());
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_EQUAL_INT(62, out.payload.notePitch.pitch);
+    TEST_ASSERT_EQUAL_INT(2, queue.getGapCount());
+
+    // Те же счетчики на полосе диспетчера: BULK на 2 события, пачка из 5 сенсоров
+    OrderRecorder recorder;
+    BurstPublisher publisher;
+    publisher.dispatcher = &dispatcher;
+    dispatcher.reset();
+    dispatcher.resetStats();
+    dispatcher.configureLane(EventLane::BULK, QueueConfig{2, OverflowPolicy::DROP_NEWEST});
+    dispatcher.subscribe(EventType::SYSTEM_IDLE_TIMEOUT, &publisher);
+    dispatcher.subscribe(EventType::SENSOR_VALUE_CHANGED, &recorder);
+
+    dispatcher.postEvent(Event(EventType::SYSTEM_IDLE_TIMEOUT));
+    TEST_ASSERT_EQUAL_INT(2, recorder.received.size());
+    TEST_ASSERT_EQUAL_INT(3, dispatcher.getDroppedCount(EventLane::BULK));
+    TEST_ASSERT_EQUAL_INT(2, dispatcher.getHighWaterMark(EventLane::BULK));
+    TEST_ASSERT_EQUAL_INT(0, dispatcher.pendingCount());
+
+    TEST_ASSERT_TRUE(dispatcher.postEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{0, 1})));
+    TEST_ASSERT_EQUAL_INT(3, dispatcher.getGapCount(EventLane::BULK));
+
+    dispatcher.configureLane(EventLane::BULK, QueueConfig{(int)EventDispatcher::BULK_QUEUE_CAPACITY, OverflowPolicy::BLOCK_TIMEOUT});
+    dispatcher.reset();
+}
+
+/**
+ * @brief Тест 11a: Упаковка событий в 8 байт - без потерь в рабочих диапазонах;
+ * кадры и значения вне диапазонов идут через пул очереди с сохранением порядка FIFO.
+ */
+void test_packed_event_encoding() {
+    TEST_ASSERT_EQUAL_INT(8, sizeof(PackedEvent));
+
+    PackedEvent packed;
+    Event in(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{7, 4095});
+    in.postTimeUs = 123456789;
+    TEST_ASSERT_TRUE(PackedEvent::pack(in, packed));
+    Event out = packed.unpack();
+    TEST_ASSERT_EQUAL(EventType::SENSOR_VALUE_CHANGED, out.type);
+    TEST_ASSERT_EQUAL_INT(7, out.payload.sensorValue.id);
+    TEST_ASSERT_EQUAL_INT(4095, out.payload.sensorValue.value);
+    TEST_ASSERT_EQUAL_UINT32(123456789, out.postTimeUs);
+
+    TEST_ASSERT_TRUE(PackedEvent::pack(Event(EventType::SENSOR_MASK_CHANGED, SensorMaskPayload{0xA5}), packed));
+    TEST_ASSERT_EQUAL_INT(0xA5, packed.unpack().payload.sensorMask.mask);
+    TEST_ASSERT_TRUE(PackedEvent::pack(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{127}), packed));
+    TEST_ASSERT_EQUAL_INT(127, packed.unpack().payload.notePitch.pitch);
+    TEST_ASSERT_TRUE(PackedEvent::pack(Event(EventType::MUTE_ENABLED), packed));
+    TEST_ASSERT_EQUAL(EventType::MUTE_ENABLED, packed.unpack().type);
+
+    // Глубина вибрато - Q1.15: двоичные дроби точно, остальное с шагом 1/32768
+    TEST_ASSERT_TRUE(PackedEvent::pack(Event(EventType::VIBRATO_DETECTED, VibratoPayload{3, 0.25f}), packed));
+    TEST_ASSERT_EQUAL_INT(3, packed.unpack().payload.vibrato.id);
+    TEST_ASSERT_TRUE(0.25f == packed.unpack().payload.vibrato.depth);
+    TEST_ASSERT_TRUE(PackedEvent::pack(Event(EventType::VIBRATO_DETECTED, VibratoPayload{0, 0.37f}), packed));
+    TEST_ASSERT_FLOAT_WITHIN(1.0f / 65536.0f, 0.37f, packed.unpack().payload.vibrato.depth);
+    // Не двоичная дробь квантуется (не отвергается): ближайшее кратное 1/32768
+    TEST_ASSERT_TRUE(0.37f != packed.unpack().payload.vibrato.depth);
+    TEST_ASSERT_TRUE(12124.0f / 32768.0f == packed.unpack().payload.vibrato.depth);
+    TEST_ASSERT_TRUE(PackedEvent::pack(Event(EventType::VIBRATO_DETECTED, VibratoPayload{0, 65535.0f / 32768.0f}), packed));
+    TEST_ASSERT_FALSE(PackedEvent::pack(Event(EventType::VIBRATO_DETECTED, VibratoPayload{0, 2.0f}), packed));
+
+    // Вне диапазонов - не упаковывается
+    TEST_ASSERT_FALSE(PackedEvent::pack(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{300, 1}), packed));
+    TEST_ASSERT_FALSE(PackedEvent::pack(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{1, -1}), packed));
+    TEST_ASSERT_FALSE(PackedEvent::pack(Event(EventType::VIBRATO_DETECTED, VibratoPayload{0, -0.5f}), packed));
+    SensorFramePayload frame = {};
+    frame.timestampMs = 42;
+    frame.count = 3;
+    frame.values[2] = 777;
+    TEST_ASSERT_FALSE(PackedEvent::pack(Event(EventType::SENSOR_FRAME, frame), packed));
+
+    // Очередь: неупакуемые события занимают ячейки пула, порядок не меняется
+    using SmallQueue = EventQueue<8, 2>;
+    SmallQueue queue;
+    queue.configure(QueueConfig{8, OverflowPolicy::DROP_NEWEST});
+    queue.push(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{60}), false);
+    queue.push(Event(EventType::SENSOR_FRAME, frame), false);
+    queue.push(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{1, 70000}), false);
+    TEST_ASSERT_EQUAL_INT(2, queue.wideInUse());
+    // Пул заполнен - кадр обрабатывается политикой очереди
+    TEST_ASSERT_EQUAL(SmallQueue::PushResult::DROPPED, queue.push(Event(EventType::SENSOR_FRAME, frame), false));
+    queue.push(Event(EventType::MUTE_DISABLED), false);
+
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_EQUAL_INT(60, out.payload.notePitch.pitch);
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_EQUAL(EventType::SENSOR_FRAME, out.type);
+    TEST_ASSERT_EQUAL_UINT32(42, out.payload.sensorFrame.timestampMs);
+    TEST_ASSERT_EQUAL_INT(777, out.payload.sensorFrame.values[2]);
+    TEST_ASSERT_EQUAL_INT(2, out.seq);
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_EQUAL_INT(70000, out.payload.sensorValue.value);
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_EQUAL(EventType::MUTE_DISABLED, out.type);
+    TEST_ASSERT_EQUAL_INT(0, queue.wideInUse());
+
+    // DROP_OLDEST освобождает ячейки пула вытесненных кадров
+    queue.configure(QueueConfig{2, OverflowPolicy::DROP_OLDEST});
+    for (int i = 0; i < 5; ++i) {
+        frame.timestampMs = (uint32_t)i;
+        queue.push(Event(EventType::SENSOR_FRAME, frame), false);
+    }
+    TEST_ASSERT_EQUAL_INT(3, queue.getEvictedCount());
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_EQUAL_UINT32(3, out.payload.sensorFrame.timestampMs);
+    TEST_ASSERT_TRUE(queue.pop(out));
+    TEST_ASSERT_EQUAL_UINT32(4, out.payload.sensorFrame.timestampMs);
+    TEST_ASSERT_EQUAL_INT(0, queue.wideInUse());
+}
+
+/**
+ * @brief Тест 12: "Бортовой самописец" - последние события, перезапись по кругу,
+ * двоичный дамп через IHalStorage и декодирование на хосте.
+ */
+void test_flight_recorder_dump() {
+    MockHalStorage storage;
+    OrderRecorder recorder;
+    dispatcher.init();
+    dispatcher.subscribe(EventType::NOTE_PITCH_SELECTED, &recorder);
+
+    // Больше событий, чем вмещает самописец: остаются последние CAPACITY
+    const int total = (int)FlightRecorder::CAPACITY + 10;
+    for (int i = 0; i < total; ++i) {
+        dispatcher.postEvent(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{i}));
+    }
+    dispatcher.postEvent(Event(EventType::VIBRATO_DETECTED, VibratoPayload{3, 0.25f}));
+
+    TEST_ASSERT_EQUAL_UINT32(total + 1, dispatcher.getFlightRecorder().totalRecorded());
+    TEST_ASSERT_TRUE(dispatcher.dumpFlightRecorder(&storage, "/flight_test.bin"));
+
+    std::string blob;
+    TEST_ASSERT_TRUE(storage.readFile("/flight_test.bin", blob));
+    std::remove("data/flight_test.bin");
+    TEST_ASSERT_EQUAL_INT(FlightRecorder::HEADER_SIZE + FlightRecorder::CAPACITY * FlightRecorder::RECORD_SIZE,
+                          blob.size());
+
+    std::vector<FlightRecord> records;
+    uint32_t recorded = 0;
+    TEST_ASSERT_TRUE(FlightRecorder::decode(blob, records, &recorded));
+    TEST_ASSERT_EQUAL_UINT32(total + 1, recorded);
+    TEST_ASSERT_EQUAL_INT(FlightRecorder::CAPACITY, records.size());
+
+    // Номера типов в дампе стабильны (декодер хранит таблицу имен): новые типы - в конце enum
+    TEST_ASSERT_EQUAL_UINT8(8, (uint8_t)blob[FlightRecorder::HEADER_SIZE + 4]);
+    TEST_ASSERT_EQUAL_INT(5, (int)EventType::VIBRATO_DETECTED);
+    TEST_ASSERT_EQUAL_INT(EVENT_TYPE_COUNT - 1, (int)EventType::SENSOR_FRAME);
+
+    // От старой записи к новой
+    TEST_ASSERT_EQUAL(EventType::NOTE_PITCH_SELECTED, records.front().type);
+    TEST_ASSERT_EQUAL_INT(total - (int)FlightRecorder::CAPACITY + 1, records.front().a);
+    TEST_ASSERT_EQUAL(EventType::VIBRATO_DETECTED, records.back().type);
+    TEST_ASSERT_EQUAL_INT(3, records.back().a);
+    TEST_ASSERT_EQUAL_STRING("t=0us wait=0us depth=0 VIBRATO_DETECTED 3 0.25",
+                             FlightRecorder::format(FlightRecord{0, 0, EventType::VIBRATO_DETECTED, 0, 3, records.back().b}).c_str());
+
+    // Поврежденный дамп не декодируется
+    TEST_ASSERT_FALSE(FlightRecorder::decode(blob.substr(0, blob.size() - 1), records));
+
+    dispatcher.reset();
+}
+
+/**
+ * @brief Тест 13: Колесо таймеров на виртуальных часах - однократный, периодический,
+ * отмена, перезапуск и длинная задержка (каскад через уровни) срабатывают в точную мс.
+ */
+void test_timer_wheel_virtual_clock() {
+    TimeRecorder idle;
+    TimeRecorder notes;
+    idle.dispatcher = &dispatcher;
+    notes.dispatcher = &dispatcher;
+    dispatcher.init();
+    dispatcher.setVirtualClock(true);
+    dispatcher.subscribe(EventType::SYSTEM_IDLE_TIMEOUT, &idle);
+    dispatcher.subscribe(EventType::NOTE_PITCH_SELECTED, &notes);
+
+    // Однократный: ровно через 10 мс
+    TimerId once = dispatcher.startTimer(10, Event(EventType::SYSTEM_IDLE_TIMEOUT));
+    TEST_ASSERT_NOT_EQUAL(INVALID_TIMER_ID, once);
+    dispatcher.advanceVirtualTime(9);
+    TEST_ASSERT_EQUAL_INT(0, idle.times.size());
+    dispatcher.advanceVirtualTime(1);
+    TEST_ASSERT_EQUAL_INT(1, idle.times.size());
+    TEST_ASSERT_EQUAL_UINT32(10, idle.times[0]);
+    TEST_ASSERT_FALSE(dispatcher.isTimerActive(once));
+    TEST_ASSERT_FALSE(dispatcher.cancelTimer(once));
+
+    // Периодический: 5 срабатываний за 100 мс, даже если время продвинуто одним шагом
+    TimerId periodic = dispatcher.startTimer(20, Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{1}), 20);
+    dispatcher.advanceVirtualTime(100);
+    TEST_ASSERT_EQUAL_INT(5, notes.pitches.size());
+    TEST_ASSERT_TRUE(dispatcher.cancelTimer(periodic));
+    dispatcher.advanceVirtualTime(100);
+    TEST_ASSERT_EQUAL_INT(5, notes.pitches.size());
+
+    // Отмененный таймер не срабатывает
+    TimerId cancelled = dispatcher.startTimer(5, Event(EventType::SYSTEM_IDLE_TIMEOUT));
+    TEST_ASSERT_TRUE(dispatcher.cancelTimer(cancelled));
+    dispatcher.advanceVirtualTime(10);
+    TEST_ASSERT_EQUAL_INT(1, idle.times.size());
+
+    // Длинная задержка (уровень 2, каскад через 2 границы) - точно в срок
+    uint32_t start = dispatcher.nowMs();
+    TimerId longDelay = dispatcher.startTimer(5000, Event(EventType::SYSTEM_IDLE_TIMEOUT));
+    for (int i = 0; i < 4999; ++i) {
+        dispatcher.advanceVirtualTime(1);
+    }
+    TEST_ASSERT_EQUAL_INT(1, idle.times.size());
+    TEST_ASSERT_TRUE(dispatcher.isTimerActive(longDelay));
+    dispatcher.advanceVirtualTime(1);
+    TEST_ASSERT_EQUAL_INT(2, idle.times.size());
+    TEST_ASSERT_EQUAL_UINT32(start + 5000, idle.times[1]);
+
+    // Перезапуск переносит срок; события таймеров с одним сроком - в порядке запуска
+    TimerId restarted = dispatcher.startTimer(30, Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{2}));
+    dispatcher.advanceVirtualTime(20);
+    TEST_ASSERT_TRUE(dispatcher.restartTimer(restarted, 30));
+    dispatcher.startTimer(40, Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{3}));
+    dispatcher.advanceVirtualTime(20);
+    TEST_ASSERT_EQUAL_INT(5, notes.pitches.size());
+    dispatcher.advanceVirtualTime(10);
+    TEST_ASSERT_EQUAL_INT(6, notes.pitches.size());
+    TEST_ASSERT_EQUAL_INT(2, notes.pitches[5]);
+    dispatcher.advanceVirtualTime(10);
+    TEST_ASSERT_EQUAL_INT(7, notes.pitches.size());
+    TEST_ASSERT_EQUAL_INT(3, notes.pitches[6]);
+
+    // Пул фиксирован: лишний таймер отклоняется
+    for (size_t i = 0; i < TimerWheel::MAX_TIMERS; ++i) {
+        TEST_ASSERT_NOT_EQUAL(INVALID_TIMER_ID, dispatcher.startTimer(1000, Event(EventType::SYSTEM_IDLE_TIMEOUT)));
+    }
+    TEST_ASSERT_EQUAL(INVALID_TIMER_ID, dispatcher.startTimer(1000, Event(EventType::SYSTEM_IDLE_TIMEOUT)));
+
+    dispatcher.init();
+}
+
+/**
+ * @brief Тест 14: Таймаут бездействия - перевзводимый таймер; активность его откладывает.
+ * В конце - реальные часы и поток цикла: спящий цикл просыпается к сроку таймера.
+ */
+void test_idle_monitor_and_threaded_timer() {
+    TimeRecorder idle;
+    idle.dispatcher = &dispatcher;
+    IdleMonitor monitor;
+    dispatcher.init();
+    dispatcher.setVirtualClock(true);
+    dispatcher.subscribe(EventType::SYSTEM_IDLE_TIMEOUT, &idle);
+    monitor.subscribe(&dispatcher);
+    TEST_ASSERT_TRUE(monitor.init(&dispatcher, 1000));
+
+    dispatcher.advanceVirtualTime(900);
+    dispatcher.postEvent(Event(EventType::SENSOR_MASK_CHANGED, SensorMaskPayload{0x0F}));
+    dispatcher.advanceVirtualTime(900);
+    TEST_ASSERT_EQUAL_INT(0, idle.times.size());
+    dispatcher.advanceVirtualTime(100);
+    TEST_ASSERT_EQUAL_INT(1, idle.times.size());
+    TEST_ASSERT_EQUAL_UINT32(1900, idle.times[0]);
+
+    // Активность после таймаута взводит таймер заново
+    dispatcher.postEvent(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{60}));
+    TEST_ASSERT_TRUE(dispatcher.isTimerActive(monitor.getTimerId()));
+    dispatcher.advanceVirtualTime(1000);
+    TEST_ASSERT_EQUAL_INT(2, idle.times.size());
+
+    // Реальные часы: таймер публикует событие без внешних postEvent
+    dispatcher.init();
+    SlowHandler timed;
+    dispatcher.subscribe(EventType::SYSTEM_IDLE_TIMEOUT, &timed);
+    TEST_ASSERT_TRUE(dispatcher.startLoopThread());
+    dispatcher.startTimer(5, Event(EventType::SYSTEM_IDLE_TIMEOUT));
+    for (int i = 0; i < 200 && timed.count.load() == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    dispatcher.stopLoopThread();
+    TEST_ASSERT_EQUAL_INT(1, timed.count.load());
+
+    dispatcher.init();
+}
+
+/**
+ * @brief Тест 15: Два цикла доставки - полосы вычерпываются разными потоками;
+ * занятый обработчик BULK не задерживает REALTIME; тип переводится в другой цикл полосой.
+ */
+void test_dual_loop_dispatch() {
+    LoopProbe probe;
+    OrderRecorder moved;
+    dispatcher.init(DispatchLoopConfig{true, {1, 0}});
+    TEST_ASSERT_EQUAL_INT(2, dispatcher.getLoopCount());
+    TEST_ASSERT_EQUAL_INT(0, dispatcher.getLoopIndex(EventType::NOTE_PITCH_SELECTED));
+    TEST_ASSERT_EQUAL_INT(1, dispatcher.getLoopIndex(EventType::SENSOR_VALUE_CHANGED));
+
+    dispatcher.setEventLane(EventType::VIBRATO_DETECTED, EventLane::REALTIME);
+    TEST_ASSERT_EQUAL_INT(0, dispatcher.getLoopIndex(EventType::VIBRATO_DETECTED));
+    dispatcher.subscribe(EventType::NOTE_PITCH_SELECTED, &probe);
+    dispatcher.subscribe(EventType::SYSTEM_IDLE_TIMEOUT, &probe);
+    dispatcher.subscribe(EventType::VIBRATO_DETECTED, &moved);
+    TEST_ASSERT_TRUE(dispatcher.startLoopThread());
+
+    // BULK занят, пока не доставлена нота: в одном цикле нота стояла бы за ним
+    dispatcher.postEvent(Event(EventType::SYSTEM_IDLE_TIMEOUT));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    dispatcher.postEvent(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{60}));
+    dispatcher.postEvent(Event(EventType::VIBRATO_DETECTED, VibratoPayload{0, 0.5f}));
+    dispatcher.waitIdle();
+    dispatcher.stopLoopThread();
+
+    TEST_ASSERT_TRUE(probe.bulkWaitedForRealtime.load());
+    TEST_ASSERT_TRUE(probe.realtimeThread != probe.bulkThread);
+    TEST_ASSERT_TRUE(probe.realtimeThread != std::this_thread::get_id());
+    TEST_ASSERT_EQUAL_INT(1, moved.received.size());
+    TEST_ASSERT_EQUAL_INT(0, dispatcher.getPreemptionCount());
+    TEST_ASSERT_EQUAL_INT(2, dispatcher.getLaneDispatchedCount(EventLane::REALTIME));
+    TEST_ASSERT_EQUAL_INT(1, dispatcher.getLaneDispatchedCount(EventLane::BULK));
+    TEST_ASSERT_EQUAL_UINT32(3, dispatcher.getFlightRecorder().totalRecorded());
+
+    // Таймеры продвигает цикл BULK
+    SlowHandler timed;
+    dispatcher.init(DispatchLoopConfig{true, {NO_CORE_AFFINITY, NO_CORE_AFFINITY}});
+    dispatcher.subscribe(EventType::MUTE_ENABLED, &timed);
+    TEST_ASSERT_TRUE(dispatcher.startLoopThread());
+    dispatcher.startTimer(5, Event(EventType::MUTE_ENABLED));
+    for (int i = 0; i < 200 && timed.count.load() == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    dispatcher.stopLoopThread();
+    TEST_ASSERT_EQUAL_INT(1, timed.count.load());
+
+    // init() без параметров возвращает один цикл
+    dispatcher.init();
+    TEST_ASSERT_EQUAL_INT(1, dispatcher.getLoopCount());
+}
+
+/**
+ * @brief Тест 16: Отписка и атомарная замена набора подписчиков во время работы.
+ */
+void test_runtime_unsubscribe_and_replace() {
+    dispatcher.init();
+
+    // 1. Отписка: порядок остальных подписчиков сохраняется
+    OrderRecorder first;
+    dispatcher.subscribe(EventType::MUTE_ENABLED, &handler1);
+    dispatcher.subscribe(EventType::MUTE_ENABLED, &first);
+    dispatcher.subscribe(EventType::MUTE_ENABLED, &handler2);
+    TEST_ASSERT_TRUE(dispatcher.unsubscribe(EventType::MUTE_ENABLED, &handler1));
+    TEST_ASSERT_FALSE(dispatcher.unsubscribe(EventType::MUTE_ENABLED, &handler1));
+    dispatcher.postEvent(Event(EventType::MUTE_ENABLED));
+    TEST_ASSERT_EQUAL_INT(0, handler1.getReceivedCount());
+    TEST_ASSERT_EQUAL_INT(1, first.received.size());
+    TEST_ASSERT_EQUAL_INT(1, handler2.getReceivedCount());
+    TEST_ASSERT_EQUAL_INT(2, dispatcher.getSubscriberCount(EventType::MUTE_ENABLED));
+
+    // 2. Отписка из обработчика: текущая доставка идет по прежнему снимку до конца
+    SelfUnsubscriber self;
+    self.dispatcher = &dispatcher;
+    dispatcher.subscribe(EventType::MUTE_DISABLED, &self);
+    dispatcher.subscribe(EventType::MUTE_DISABLED, &handler1);
+    dispatcher.postEvent(Event(EventType::MUTE_DISABLED));
+    dispatcher.postEvent(Event(EventType::MUTE_DISABLED));
+    TEST_ASSERT_TRUE(self.unsubscribed);
+    TEST_ASSERT_EQUAL_INT(1, self.count);
+    TEST_ASSERT_EQUAL_INT(2, handler1.getReceivedCount());
+
+    // 3. Замена набора целиком; старые снимки возвращаются в пул
+    SubscriberSet set;
+    dispatcher.getSubscribers(set);
+    TEST_ASSERT_EQUAL_INT(2, set.removeAll(&handler2) + set.removeAll(&handler1));
+    TEST_ASSERT_TRUE(set.add(EventType::NOTE_PITCH_SELECTED, &handler2));
+    uint32_t generation = dispatcher.getSubscriberGeneration();
+    TEST_ASSERT_TRUE(dispatcher.replaceSubscribers(set));
+    TEST_ASSERT_EQUAL_UINT32(generation + 1, dispatcher.getSubscriberGeneration());
+    dispatcher.postEvent(Event(EventType::MUTE_DISABLED));
+    dispatcher.postEvent(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{62}));
+    TEST_ASSERT_EQUAL_INT(2, handler1.getReceivedCount());
+    TEST_ASSERT_EQUAL_INT(2, handler2.getReceivedCount());
+    TEST_ASSERT_EQUAL(EventType::NOTE_PITCH_SELECTED, handler2.getLastEventType());
+    for (int i = 0; i < 50; ++i) {
+        TEST_ASSERT_TRUE(dispatcher.subscribe(EventType::BLE_CONNECTED, &handler1));
+        TEST_ASSERT_TRUE(dispatcher.unsubscribe(EventType::BLE_CONNECTED, &handler1));
+    }
+
+    // 4. Потоки: подписки меняются под нагрузкой; после unsubscribe() обработчик не вызывается
+    AtomicCounter counter;
+    std::atomic<bool> producing{true};
+    dispatcher.init(DispatchLoopConfig{true, {NO_CORE_AFFINITY, NO_CORE_AFFINITY}});
+    dispatcher.setBlockTimeoutMs(1000);
+    TEST_ASSERT_TRUE(dispatcher.startLoopThread());
+    std::thread producer([&producing] {
+        int value = 0;
+        while (producing.load()) {
+            dispatcher.postEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{1, value++ & 0xFF}));
+            dispatcher.postEvent(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{60}));
+            std::this_thread::yield();
+        }
+    });
+    for (int i = 0; i < 100; ++i) {
+        TEST_ASSERT_TRUE(dispatcher.subscribe(EventType::SENSOR_VALUE_CHANGED, &counter));
+        TEST_ASSERT_TRUE(dispatcher.subscribe(EventType::NOTE_PITCH_SELECTED, &counter));
+        std::this_thread::yield();
+        TEST_ASSERT_EQUAL_INT(2, dispatcher.unsubscribeAll(&counter));
+    }
+    int delivered = counter.count.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    producing.store(false);
+    producer.join();
+    dispatcher.waitIdle();
+    dispatcher.stopLoopThread();
+    TEST_ASSERT_EQUAL_INT(delivered, counter.count.load());
+
+    dispatcher.setBlockTimeoutMs(EventQueue<8>::DEFAULT_BLOCK_TIMEOUT_MS);
+    dispatcher.init();
+}
+
+/**
+ * @brief Тест 17: Фильтры подписки проверяются до вызова обработчика.
+ */
+void test_subscription_filters() {
+    dispatcher.init();
+    OrderRecorder holes;
+    OrderRecorder loud;
+    TEST_ASSERT_TRUE(dispatcher.subscribe(EventType::SENSOR_VALUE_CHANGED, &handler1));
+    TEST_ASSERT_TRUE(dispatcher.subscribe(EventType::SENSOR_VALUE_CHANGED, &holes,
+                                          EventFilter::ids(EventFilter::idBit(1) | EventFilter::idBit(3))));
+    TEST_ASSERT_TRUE(dispatcher.subscribe(EventType::SENSOR_VALUE_CHANGED, &loud, EventFilter::valueRange(500, 1000)));
+    TEST_ASSERT_TRUE(dispatcher.subscribe(EventType::NOTE_PITCH_SELECTED, &loud, EventFilter::valueRange(60, 71)));
+    TEST_ASSERT_TRUE(dispatcher.subscribe(EventType::SENSOR_FRAME, &holes, EventFilter::ids(0)));
+
+    dispatcher.postEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{1, 100}));
+    dispatcher.postEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{2, 600}));
+    dispatcher.postEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{40, 700}));
+    dispatcher.postEvent(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{72}));
+    dispatcher.postEvent(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{64}));
+    SensorFramePayload frame = {};
+    dispatcher.postEvent(Event(EventType::SENSOR_FRAME, frame));
+
+    TEST_ASSERT_EQUAL_INT(3, handler1.getReceivedCount());
+    // ID 1 и кадр (к SENSOR_FRAME фильтр по ID не применяется)
+    TEST_ASSERT_EQUAL_INT(2, holes.received.size());
+    TEST_ASSERT_EQUAL_INT(1, holes.received[0].payload.sensorValue.id);
+    TEST_ASSERT_EQUAL(EventType::SENSOR_FRAME, holes.received[1].type);
+    // Значения 600, 700 (ID >= 32 - фильтра по ID нет) и нота 64
+    TEST_ASSERT_EQUAL_INT(3, loud.received.size());
+    TEST_ASSERT_EQUAL_INT(64, loud.received[2].payload.notePitch.pitch);
+
+    // Отписка сдвигает фильтры вместе с обработчиками
+    TEST_ASSERT_TRUE(dispatcher.unsubscribe(EventType::SENSOR_VALUE_CHANGED, &handler1));
+    SubscriberSet set;
+    dispatcher.getSubscribers(set);
+    TEST_ASSERT_TRUE(set.at(EventType::SENSOR_VALUE_CHANGED, 0) == &holes);
+    TEST_ASSERT_EQUAL_UINT32(EventFilter::idBit(1) | EventFilter::idBit(3),
+                             set.filterAt(EventType::SENSOR_VALUE_CHANGED, 0).idMask);
+    TEST_ASSERT_EQUAL_INT(500, set.filterAt(EventType::SENSOR_VALUE_CHANGED, 1).minValue);
+    dispatcher.postEvent(Event(EventType::SENSOR_VALUE_CHANGED, SensorValuePayload{3, 50}));
+    TEST_ASSERT_EQUAL_INT(3, holes.received.size());
+    TEST_ASSERT_EQUAL_INT(3, loud.received.size());
+
+    TEST_ASSERT_TRUE(EventFilter::all().passesAll());
+    TEST_ASSERT_FALSE(EventFilter::ids(1).passesAll());
+    TEST_ASSERT_EQUAL_UINT32(0, EventFilter::idBit(32));
+    dispatcher.init();
+}
+
+/**
+ * @brief Тест 18: Гистограмма времени обработчика следует за подпиской при сдвиге слотов.
+ */
+void test_handler_histograms_follow_subscription() {
+    dispatcher.init();
+    OrderRecorder first;
+    OrderRecorder middle;
+    OrderRecorder last;
+    OrderRecorder late;
+    const EventType type = EventType::NOTE_PITCH_SELECTED;
+    TEST_ASSERT_TRUE(dispatcher.subscribe(type, &first));
+    TEST_ASSERT_TRUE(dispatcher.subscribe(type, &middle, EventFilter::valueRange(60, 60)));
+    TEST_ASSERT_TRUE(dispatcher.subscribe(type, &last));
+
+    for (int pitch = 60; pitch < 63; ++pitch) {
+        dispatcher.postEvent(Event(type, NotePitchPayload{pitch}));
+    }
+    TEST_ASSERT_EQUAL_INT(3, dispatcher.getHandlerHistogram(type, 0).totalCount());
+    TEST_ASSERT_EQUAL_INT(1, dispatcher.getHandlerHistogram(type, 1).totalCount());
+    TEST_ASSERT_EQUAL_INT(3, dispatcher.getHandlerHistogram(type, 2).totalCount());
+
+    // Отписка сдвигает слоты: статистика остается у своих обработчиков
+    TEST_ASSERT_TRUE(dispatcher.unsubscribe(type, &first));
+    dispatcher.postEvent(Event(type, NotePitchPayload{60}));
+    dispatcher.postEvent(Event(type, NotePitchPayload{61}));
+    TEST_ASSERT_EQUAL_INT(2, dispatcher.getHandlerHistogram(type, 0).totalCount());
+    TEST_ASSERT_EQUAL_INT(5, dispatcher.getHandlerHistogram(type, 1).totalCount());
+
+    // Новая подписка занимает освободившуюся гистограмму и начинает с нуля
+    TEST_ASSERT_TRUE(dispatcher.subscribe(type, &late));
+    dispatcher.postEvent(Event(type, NotePitchPayload{61}));
+    TEST_ASSERT_EQUAL_INT(2, dispatcher.getHandlerHistogram(type, 0).totalCount());
+    TEST_ASSERT_EQUAL_INT(6, dispatcher.getHandlerHistogram(type, 1).totalCount());
+    TEST_ASSERT_EQUAL_INT(1, dispatcher.getHandlerHistogram(type, 2).totalCount());
+
+    // Замена набора с другим обработчиком на том же месте - тоже с нуля
+    SubscriberSet set;
+    set.add(type, &first);
+    set.add(type, &last);
+    TEST_ASSERT_TRUE(dispatcher.replaceSubscribers(set));
+    TEST_ASSERT_EQUAL_INT(0, dispatcher.getHandlerHistogram(type, 0).totalCount());
+    TEST_ASSERT_EQUAL_INT(0, dispatcher.getHandlerHistogram(type, 1).totalCount());
+    dispatcher.init();
+}
+
 // --- Main ---
 
 int main(int argc, char **argv) {
@@ -95,6 +1046,22 @@ int main(int argc, char **argv) {
     RUN_TEST(test_subscribe_and_receive);
     RUN_TEST(test_ignore_unsubscribed);
     RUN_TEST(test_multiple_subscribers);
+    RUN_TEST(test_ring_fifo_and_overflow);
+    RUN_TEST(test_threaded_multi_producer);
+    RUN_TEST(test_subscriptions_frozen_and_bounded);
+    RUN_TEST(test_realtime_lane_preempts_bulk);
+    RUN_TEST(test_sensor_value_coalescing);
+    RUN_TEST(test_latency_histograms_threaded);
+    RUN_TEST(test_typed_event_bus);
+    RUN_TEST(test_queue_overflow_policies);
+    RUN_TEST(test_packed_event_encoding);
+    RUN_TEST(test_flight_recorder_dump);
+    RUN_TEST(test_timer_wheel_virtual_clock);
+    RUN_TEST(test_idle_monitor_and_threaded_timer);
+    RUN_TEST(test_dual_loop_dispatch);
+    RUN_TEST(test_runtime_unsubscribe_and_replace);
+    RUN_TEST(test_subscription_filters);
+    RUN_TEST(test_handler_histograms_follow_subscription);
     
     return UNITY_END();
 }
\ No newline at end of file
@@ -256,6 +256,63 @@ void test_config_reload() {
     TEST_ASSERT_EQUAL_INT(1, mockBle.getAllNotesOffCount());
 }
 
+/**
+ * @brief Тест 6: Кадр опроса (SENSOR_FRAME) проходит всю цепочку.
+ * Два пальца в одном кадре -> сразу конечная нота, без промежуточной.
+ */
+void test_sensor_frame_chain() {
+    TEST_MESSAGE(" ");
+    TEST_MESSAGE("=== TEST 6: Sensor Frame Chain ===");
+    // Сенсоры 0 и 1 закрываются в одном кадре -> Маска 3 -> Нота 62
+    mockSensors.pushMockSensorFrame({500, 500, 0, 0, 0, 0, 0, 0, 0});
+
+    TEST_ASSERT_EQUAL_INT(62, mockBle.getLastNoteOn());
+    // Время кадров без явной метки идет с периодом sample_rate_hz (50 Гц -> 20 мс)
+    const uint32_t frameMs = mockSensors.getLastFrameTimestampMs();
+    mockSensors.pushMockSensorFrame({500, 500, 0, 0, 0, 0, 0, 0, 0});
+    TEST_ASSERT_EQUAL_UINT32(frameMs + 20, mockSensors.getLastFrameTimestampMs());
+    // Промежуточной ноты 60 не было: LED моргнул один раз
+    TEST_ASSERT_EQUAL_INT(1, mockLed.getBlinkOnceCount());
+}
+
+/**
+ * @brief Тест 7: Режим fused_pipeline (logic -> fingering -> midi прямыми вызовами).
+ * Результат тот же, что и через события, и ничего не обрабатывается дважды.
+ */
+void test_fused_pipeline_chain() {
+    TEST_MESSAGE(" ");
+    TEST_MESSAGE("=== TEST 7: Fused Pipeline Chain ===");
+    std::string fused_settings =
+        "[system]\n"
+        "base_pitch_hz = 440.0\n"
+        "[sensors]\n"
+        "mute_threshold = 500\n"
+        "hole_closed_threshold = 400\n"
+        "half_hole_threshold = 300\n"
+        "[app_logic]\n"
+        "mute_sensor_id = 8\n"
+        "hole_sensor_ids = 0, 1, 2\n"
+        "fused_pipeline = true\n";
+    mockStorage.writeFile("/settings.cfg", fused_settings);
+    app.init(&mockStorage, &mockSystem, &mockUsb, &mockSensors, &mockLed, &mockBle, &mockPower);
+    app.startTasks(&mockSensors, &mockLed, &mockBle, &mockPower);
+
+    // Нота, смена ноты, полузакрытие
+    mockSensors.pushMockSensorValue(0, 500);
+    TEST_ASSERT_EQUAL_INT(60, mockBle.getLastNoteOn());
+    mockSensors.pushMockSensorValue(1, 500);
+    TEST_ASSERT_EQUAL_INT(62, mockBle.getLastNoteOn());
+    TEST_ASSERT_EQUAL_INT(60, mockBle.getLastNoteOff());
+    mockSensors.pushMockSensorValue(1, 0);
+    mockSensors.pushMockSensorValue(0, 350);
+    TEST_ASSERT_EQUAL_INT(61, mockBle.getLastNoteOn());
+    TEST_ASSERT_EQUAL_INT(4, mockLed.getBlinkOnceCount());
+
+    // Mute: ровно один "Panic" (AppMidi не получает MUTE_ENABLED еще и через диспетчер)
+    mockSensors.pushMockSensorValue(8, 600);
+    TEST_ASSERT_EQUAL_INT(61, mockBle.getLastNoteOff());
+    TEST_ASSERT_EQUAL_INT(1, mockBle.getAllNotesOffCount());
+}
 
 int main(int argc, char **argv) {
     UNITY_BEGIN();
@@ -264,5 +321,7 @@ int main(int argc, char **argv) {
     RUN_TEST(test_half_hole_chain);
     RUN_TEST(test_vibrato_chain);
     RUN_TEST(test_config_reload);
+    RUN_TEST(test_sensor_frame_chain);
+    RUN_TEST(test_fused_pipeline_chain);
     return UNITY_END();
 }
\ No newline at end of file
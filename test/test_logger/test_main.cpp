@@ -11,6 +11,8 @@
 
 #include "core/Logger.h"
 #include "core/ConfigManager.h"
+#include "core/EventDispatcher.h"
+#include "MockEventHandler.h"
 
 // Моки
 #include "MockHalUsb.h"
@@ -104,6 +106,32 @@ void test_log_formatting() {
     TEST_ASSERT_TRUE_MESSAGE(isdigit(output[0]), "Timestamp missing");
 }
 
+/**
+ * @brief Тест 4: Дамп гистограмм задержек EventDispatcher (печатается при любом log_level).
+ */
+void test_dump_latency_stats() {
+    configManager.setLogLevel(LogLevel::ERROR);
+    Logger::getInstance()->init(&configManager, &mockUsb, &mockSystem);
+
+    EventDispatcher dispatcher;
+    MockEventHandler handler;
+    dispatcher.init();
+    dispatcher.subscribe(EventType::NOTE_PITCH_SELECTED, &handler);
+    dispatcher.postEvent(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{60}));
+    dispatcher.postEvent(Event(EventType::NOTE_PITCH_SELECTED, NotePitchPayload{62}));
+
+    // Две строки: ожидание в очереди и обработчик #0
+    int startCount = mockUsb.getSerialPrintCount();
+    Logger::getInstance()->dumpLatencyStats(dispatcher, true);
+    TEST_ASSERT_EQUAL_INT(startCount + 2, mockUsb.getSerialPrintCount());
+
+    std::string output = mockUsb.getLastSerialLine();
+    TEST_ASSERT_TRUE_MESSAGE(output.find("handler NOTE_PITCH_SELECTED #0 n=2") != std::string::npos, "Handler histogram missing");
+
+    // После сброса выводить нечего
+    Logger::getInstance()->dumpLatencyStats(dispatcher);
+    TEST_ASSERT_EQUAL_INT(startCount + 2, mockUsb.getSerialPrintCount());
+}
 
 int main(int argc, char **argv) {
     UNITY_BEGIN();
@@ -111,6 +139,7 @@ int main(int argc, char **argv) {
     RUN_TEST(test_log_level_filtering);
     RUN_TEST(test_log_level_change_runtime);
     RUN_TEST(test_log_formatting);
+    RUN_TEST(test_dump_latency_stats);
     
     return UNITY_END();
 }
\ No newline at end of file
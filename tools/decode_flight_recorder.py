@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""
+decode_flight_recorder.py
+
+Декодер дампа "бортового самописца" EventDispatcher (/flight.bin) для хоста.
+Формат описан в include/core/FlightRecorder.h (версия 1, little-endian).
+
+Использование:
+    python3 tools/decode_flight_recorder.py flight.bin
+
+Соответствует: docs/modules/core_event_dispatcher.md
+"""
+import struct
+import sys
+
+# Порядок должен совпадать с enum class EventType (include/events.h)
+EVENT_TYPES = [
+    "SENSOR_VALUE_CHANGED",
+    "BLE_CONNECTED",
+    "BLE_DISCONNECTED",
+    "SENSOR_MASK_CHANGED",
+    "HALF_HOLE_DETECTED",
+    "VIBRATO_DETECTED",
+    "MUTE_ENABLED",
+    "MUTE_DISABLED",
+    "NOTE_PITCH_SELECTED",
+    "SYSTEM_IDLE_TIMEOUT",
+    "SENSOR_FRAME",
+]
+
+HEADER = struct.Struct("<4sBBHII")
+RECORD = struct.Struct("<IBBHii")
+FORMAT_VERSION = 1
+
+
+def format_payload(name, a, b):
+    if name == "SENSOR_VALUE_CHANGED":
+        return "id=%d value=%d" % (a, b)
+    if name == "SENSOR_FRAME":
+        return "timestamp=%dms count=%d" % (a & 0xFFFFFFFF, b)
+    if name == "SENSOR_MASK_CHANGED":
+        return "mask=0b{:08b}".format(a & 0xFFFFFFFF)
+    if name == "HALF_HOLE_DETECTED":
+        return "id=%d" % a
+    if name == "VIBRATO_DETECTED":
+        depth = struct.unpack("<f", struct.pack("<i", b))[0]
+        return "id=%d depth=%.2f" % (a, depth)
+    if name == "NOTE_PITCH_SELECTED":
+        return "pitch=%d" % a
+    return ""
+
+
+def decode(blob):
+    if len(blob) < HEADER.size:
+        raise ValueError("file too short")
+    magic, version, record_size, count, total, dump_us = HEADER.unpack_from(blob, 0)
+    if magic != b"EVFR" or version != FORMAT_VERSION or record_size != RECORD.size:
+        raise ValueError("not a flight recorder dump (v%d)" % FORMAT_VERSION)
+    if len(blob) != HEADER.size + count * RECORD.size:
+        raise ValueError("truncated dump")
+
+    records = []
+    for i in range(count):
+        records.append(RECORD.unpack_from(blob, HEADER.size + i * RECORD.size))
+    return total, dump_us, records
+
+
+def main(argv):
+    if len(argv) != 2:
+        print("usage: %s flight.bin" % argv[0], file=sys.stderr)
+        return 2
+    with open(argv[1], "rb") as f:
+        total, dump_us, records = decode(f.read())
+
+    print("# %d of %d events, dump at %d us" % (len(records), total, dump_us))
+    for post_us, type_id, depth, wait_us, a, b in records:
+        name = EVENT_TYPES[type_id] if type_id < len(EVENT_TYPES) else "UNKNOWN(%d)" % type_id
+        age_ms = ((dump_us - post_us) & 0xFFFFFFFF) / 1000.0
+        print("-%9.3fms wait=%5dus depth=%3d %-20s %s" % (age_ms, wait_us, depth, name, format_payload(name, a, b)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))